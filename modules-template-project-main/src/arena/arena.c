@@ -0,0 +1,138 @@
+/*
+ * -----------------------------------------------------------------------------
+ * arena.c
+ *
+ * Arena allocator implementation: a singly linked chain of blocks with a
+ * bump pointer in the current block. Requests larger than the block size
+ * get a dedicated block in the same chain.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#include "arena.h"
+#include <stdlib.h>  // malloc, free
+#include <stdio.h>   // fprintf, stderr
+
+// Header size rounded up so the payload keeps ARENA_ALIGN alignment.
+#define ARENA_HEADER \
+    ((sizeof(arena_block_t) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+// Rounds n up to a multiple of ARENA_ALIGN.
+static size_t arena_round(size_t n) {
+    return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+// Returns the payload start of a block.
+static unsigned char* arena_payload(arena_block_t *block) {
+    return (unsigned char *)block + ARENA_HEADER;
+}
+
+// Sets up an empty arena.
+void arena_init(arena_t *arena, size_t block_size) {
+    if (arena == NULL) {
+        return;
+    }
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->block_size = (block_size > 0) ? arena_round(block_size)
+                                         : ARENA_DEFAULT_BLOCK;
+}
+
+// Allocates a new block with at least size payload bytes at the chain end.
+static arena_block_t* arena_new_block(arena_t *arena, size_t size) {
+    arena_block_t *block;
+    arena_block_t *tail;
+    size_t payload = (size > arena->block_size) ? size : arena->block_size;
+
+    block = (arena_block_t *)malloc(ARENA_HEADER + payload);
+    if (block == NULL) {
+        fprintf(stderr, "arena_new_block: memory allocation failed\n");
+        return NULL;
+    }
+    block->next = NULL;
+    block->size = payload;
+    block->used = 0;
+
+    if (arena->head == NULL) {
+        arena->head = block;
+    } else {
+        tail = (arena->current != NULL) ? arena->current : arena->head;
+        while (tail->next != NULL) {
+            tail = tail->next;
+        }
+        tail->next = block;
+    }
+    return block;
+}
+
+// Bumps size bytes from the current block, moving on to the next free
+// (after a reset) or a new block when it does not fit.
+void* arena_alloc(arena_t *arena, size_t size) {
+    arena_block_t *block;
+    void *ptr;
+
+    if (arena == NULL || size == 0) {
+        return NULL;
+    }
+    size = arena_round(size);
+
+    block = arena->current;
+    while (block != NULL && block->used + size > block->size) {
+        block = block->next;
+    }
+    if (block == NULL) {
+        block = arena_new_block(arena, size);
+        if (block == NULL) {
+            return NULL;
+        }
+    }
+
+    arena->current = block;
+    ptr = arena_payload(block) + block->used;
+    block->used += size;
+    return ptr;
+}
+
+// Rewinds every block; the chain is kept for the next run.
+void arena_reset(arena_t *arena) {
+    arena_block_t *block;
+
+    if (arena == NULL) {
+        return;
+    }
+    for (block = arena->head; block != NULL; block = block->next) {
+        block->used = 0;
+    }
+    arena->current = arena->head;
+}
+
+// Frees the whole chain.
+void arena_free(arena_t *arena) {
+    arena_block_t *block;
+    arena_block_t *next;
+
+    if (arena == NULL) {
+        return;
+    }
+    for (block = arena->head; block != NULL; block = next) {
+        next = block->next;
+        free(block);
+    }
+    arena->head = NULL;
+    arena->current = NULL;
+}
+
+// Sums used payload bytes over the chain.
+size_t arena_used(const arena_t *arena) {
+    const arena_block_t *block;
+    size_t total = 0;
+
+    if (arena == NULL) {
+        return 0;
+    }
+    for (block = arena->head; block != NULL; block = block->next) {
+        total += block->used;
+    }
+    return total;
+}
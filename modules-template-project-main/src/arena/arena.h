@@ -0,0 +1,53 @@
+/*
+ * -----------------------------------------------------------------------------
+ * arena.h
+ *
+ * Arena (bump) allocator for data that lives exactly as long as one file
+ * run: lexemes, tokens and later parser nodes. Allocation is a pointer
+ * bump inside a block; there is no per-object free. arena_reset() rewinds
+ * every block for the next file (memory is kept), arena_free() releases
+ * everything in one pass over the block chain.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>  // size_t
+
+// Default block payload size and allocation alignment.
+#define ARENA_DEFAULT_BLOCK (256 * 1024)
+#define ARENA_ALIGN 16
+
+// One block of arena memory (payload follows the header).
+typedef struct arena_block {
+    struct arena_block *next;  // Next block in the chain.
+    size_t size;               // Payload bytes.
+    size_t used;               // Payload bytes handed out.
+} arena_block_t;
+
+// Arena state.
+typedef struct {
+    arena_block_t *head;     // First block (NULL when empty).
+    arena_block_t *current;  // Block allocations are bumped from.
+    size_t block_size;       // Payload size for new regular blocks.
+} arena_t;
+
+// Initializes an empty arena (block_size 0 selects ARENA_DEFAULT_BLOCK).
+void arena_init(arena_t *arena, size_t block_size);
+
+// Returns ARENA_ALIGN-aligned storage for size bytes, or NULL.
+void* arena_alloc(arena_t *arena, size_t size);
+
+// Rewinds all blocks for reuse; previous allocations become invalid.
+void arena_reset(arena_t *arena);
+
+// Releases every block.
+void arena_free(arena_t *arena);
+
+// Returns total payload bytes currently handed out.
+size_t arena_used(const arena_t *arena);
+
+#endif /* ARENA_H */
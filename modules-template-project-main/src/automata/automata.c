@@ -9,7 +9,10 @@
  * Design:
  *   - ONE function scanner_next_token() recognises each token.
  *   - Maximal munch via last_accept_state + last_accept_pos rollback.
- *   - Keywords are reclassified char-by-char after identifier acceptance.
+ *   - Keywords are reclassified char-by-char after identifier acceptance,
+ *     or (TRIE engine) reached as dedicated states, one per keyword prefix.
+ *   - Lexemes are (offset, length) spans when the token list is attached
+ *     to the stream's resident bytes (tl_set_source); copied otherwise.
  *   - Whitespace is consumed inside the DFA (START + WS → START).
  *   - Unterminated literals emit one error + NONRECOGNIZED token.
  *   - Grouped non-recognized chars emit one error per group.
@@ -20,6 +23,13 @@
 
 #include "automata.h"
 #include "../lang_spec/lang_spec.h"
+#include <stdint.h>  // uint32_t, uint16_t
+#include <stdlib.h>  // malloc, free
+#include <string.h>  // memcpy, memchr
+#include <pthread.h>  // pthread_create, pthread_join, pthread_once
+#ifndef _WIN32
+#include <unistd.h>  // sysconf
+#endif
 
 // Transition matrix:
 // rows = current state, columns = character class, value = next state.
@@ -86,33 +96,204 @@ static token_category_t accept_category(scan_state_t st) {
     }
 }
 
-// Maps one character to a DFA class.
-char_class_t classify_char(int ch) {
+// Class of byte c as a constant expression over the lang_spec.h lists.
+// Test order matches the DFA column priority (newline before whitespace).
+#define CC_OF(c) ( \
+    LS_CH_IS_LETTER(c)     ? CC_LETTER   : \
+    LS_CH_IS_DIGIT(c)      ? CC_DIGIT    : \
+    LS_CH_IS_QUOTE(c)      ? CC_QUOTE    : \
+    LS_CH_IS_OPERATOR(c)   ? CC_OPERATOR : \
+    LS_CH_IS_SPECIAL(c)    ? CC_SPECIAL  : \
+    ((c) == WS_NL)         ? CC_NEWLINE  : \
+    LS_CH_IS_WHITESPACE(c) ? CC_SPACE    : CC_OTHER)
+
+#define CC_ROW4(b)  CC_OF(b), CC_OF((b) + 1), CC_OF((b) + 2), CC_OF((b) + 3)
+#define CC_ROW16(b) CC_ROW4(b), CC_ROW4((b) + 4), CC_ROW4((b) + 8), CC_ROW4((b) + 12)
+
+// Byte -> character class map, filled at compile time.
+static const unsigned char cc_table[256] = {
+    CC_ROW16(0x00), CC_ROW16(0x10), CC_ROW16(0x20), CC_ROW16(0x30),
+    CC_ROW16(0x40), CC_ROW16(0x50), CC_ROW16(0x60), CC_ROW16(0x70),
+    CC_ROW16(0x80), CC_ROW16(0x90), CC_ROW16(0xA0), CC_ROW16(0xB0),
+    CC_ROW16(0xC0), CC_ROW16(0xD0), CC_ROW16(0xE0), CC_ROW16(0xF0)
+};
+
+_Static_assert(CC_COUNT <= 256, "char_class_t must fit in cc_table entries");
+
+// Maps one character (or CS_EOF) to a DFA class with one table load.
+static inline char_class_t cc_lookup(int ch) {
     if (ch == CS_EOF) {
         return CC_EOF;
     }
-    if (ls_is_letter((char)ch)) {
-        return CC_LETTER;
+    return (char_class_t)cc_table[(unsigned char)ch];
+}
+
+// Maps one character to a DFA class.
+char_class_t classify_char(int ch) {
+    return cc_lookup(ch);
+}
+
+// Returns T[st][cc], ST_STOP outside the matrix.
+scan_state_t automata_next_state(scan_state_t st, char_class_t cc) {
+    if ((int)st < 0 || st >= ST_COUNT || (int)cc < 0 || cc >= CC_COUNT) {
+        return ST_STOP;
     }
-    if (ls_is_digit((char)ch)) {
-        return CC_DIGIT;
+    return T[st][cc];
+}
+
+// Returns the category of an accepting state, -1 for any other state.
+int automata_state_category(scan_state_t st) {
+    return is_accepting(st) ? (int)accept_category(st) : -1;
+}
+
+// Fused state x byte table: FT[state][byte] == T[state][cc_table[byte]].
+// EOF is not a byte and keeps using the T[state][CC_EOF] column.
+static unsigned char FT[ST_COUNT][256];
+
+// Bit s set when state s is accepting.
+static uint32_t accept_mask;
+
+// Keyword trie DFA: states [0, ST_COUNT) are the scan states, the rest
+// are keyword prefix nodes (at most one per keyword character). Column 0
+// is EOF, column b + 1 is byte b, so a step is KT[state][ch + 1].
+#define KT_LEN_SUM(arg, kw) + (int)(sizeof(kw) - 1)
+#define KT_STATES (ST_COUNT + 0 LS_KEYWORD_LIST(KT_LEN_SUM, _))
+#define KT_COLS   257
+#define KT_NO_ACCEPT CAT_COUNT  // kt_cat value for non-accepting states.
+#define KT_LIST_ITEM(arg, kw) kw,
+
+static uint16_t KT[KT_STATES][KT_COLS];
+
+// Token category per trie DFA state, KT_NO_ACCEPT when not accepting.
+static unsigned char kt_cat[KT_STATES];
+
+// Fills FT, accept_mask, KT and kt_cat exactly once, whichever thread
+// (scan) gets there first.
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+// 1 when no token can leave an accepting state for a non-accepting one, so
+// the last accepting state is implied by the current state (needed to
+// resume a token from its state alone in the speculative scan).
+static int accept_is_sticky = 0;
+
+_Static_assert(ST_COUNT <= 32, "accept_mask holds one bit per scan state");
+_Static_assert(ST_COUNT <= 256, "FT entries are stored as unsigned char");
+_Static_assert(KT_STATES <= UINT16_MAX, "KT entries are stored as uint16_t");
+_Static_assert(CS_EOF == -1, "KT column 0 is indexed by CS_EOF + 1");
+
+// Expands LS_KEYWORD_LIST into trie states on top of the fused rows. A
+// prefix node keeps identifier behaviour for every byte not on a keyword
+// edge; a node that completes a keyword accepts as CAT_KEYWORD.
+static void build_keyword_trie(void) {
+    static const char *keywords[] = { LS_KEYWORD_LIST(KT_LIST_ITEM, _) };
+    int next_state = ST_COUNT;
+    int st;
+    int b;
+    int k;
+
+    for (st = 0; st < ST_COUNT; st++) {
+        KT[st][0] = (uint16_t)T[st][CC_EOF];
+        for (b = 0; b < 256; b++) {
+            KT[st][b + 1] = FT[st][b];
+        }
+        kt_cat[st] = is_accepting((scan_state_t)st)
+                         ? (unsigned char)accept_category((scan_state_t)st)
+                         : KT_NO_ACCEPT;
     }
-    if (ls_is_quote((char)ch)) {
-        return CC_QUOTE;
+
+    for (k = 0; k < (int)(sizeof(keywords) / sizeof(keywords[0])); k++) {
+        const unsigned char *kw = (const unsigned char *)keywords[k];
+        int node = ST_START;
+        int i;
+
+        for (i = 0; kw[i] != '\0'; i++) {
+            int child = KT[node][kw[i] + 1];
+
+            // Keywords must lex as identifiers for the trie to apply.
+            if (child != ST_IN_IDENT && child < ST_COUNT) {
+                break;
+            }
+            if (child < ST_COUNT) {
+                child = next_state++;
+                memcpy(KT[child], KT[ST_IN_IDENT], sizeof(KT[child]));
+                kt_cat[child] = CAT_IDENTIFIER;
+                KT[node][kw[i] + 1] = (uint16_t)child;
+            }
+            node = child;
+        }
+        if (kw[i] == '\0' && node >= ST_COUNT) {
+            kt_cat[node] = CAT_KEYWORD;
+        }
+    }
+}
+
+// Precomputes the fused transition table, the accepting-state mask and
+// the keyword trie DFA.
+static void build_tables(void) {
+    int st;
+    int b;
+
+    accept_mask = 0;
+    for (st = 0; st < ST_COUNT; st++) {
+        for (b = 0; b < 256; b++) {
+            FT[st][b] = (unsigned char)T[st][cc_table[b]];
+        }
+        if (is_accepting((scan_state_t)st)) {
+            accept_mask |= (uint32_t)1 << st;
+        }
+    }
+    accept_is_sticky = 1;
+    for (st = 0; st < ST_COUNT; st++) {
+        for (b = 0; b < CC_COUNT; b++) {
+            scan_state_t next = T[st][b];
+            if (is_accepting((scan_state_t)st) && next != ST_STOP &&
+                next != ST_ERROR && !is_accepting(next)) {
+                accept_is_sticky = 0;
+            }
+        }
     }
-    if (ls_is_operator((char)ch)) {
-        return CC_OPERATOR;
+    build_keyword_trie();
+}
+
+// Builds the derived tables on first use; safe from concurrent scans.
+void automata_init_tables(void) {
+    pthread_once(&tables_once, build_tables);
+}
+
+// One DFA step: class lookup + matrix (MATRIX) or one table load (FUSED,
+// TRIE). Trie prefix states are numbered from ST_COUNT upwards.
+static inline scan_state_t dfa_step(scan_engine_t engine, scan_state_t state,
+                                    int ch) {
+    if (engine == SCAN_ENGINE_TRIE) {
+        return (scan_state_t)KT[state][ch + 1];
     }
-    if (ls_is_special_char((char)ch)) {
-        return CC_SPECIAL;
+    if (engine == SCAN_ENGINE_FUSED) {
+        if (ch == CS_EOF) {
+            return T[state][CC_EOF];
+        }
+        return (scan_state_t)FT[state][(unsigned char)ch];
+    }
+    return T[state][cc_lookup(ch)];
+}
+
+// Accepting-state test: switch (MATRIX), bitmask (FUSED) or table (TRIE).
+static inline int dfa_accepts(scan_engine_t engine, scan_state_t state) {
+    if (engine == SCAN_ENGINE_TRIE) {
+        return kt_cat[state] != KT_NO_ACCEPT;
     }
-    if ((char)ch == WS_NL) {
-        return CC_NEWLINE;
+    if (engine == SCAN_ENGINE_FUSED) {
+        return (int)((accept_mask >> state) & 1u);
     }
-    if (ls_is_whitespace((char)ch)) {
-        return CC_SPACE;
+    return is_accepting(state);
+}
+
+// Category of an accepting state.
+static inline token_category_t dfa_category(scan_engine_t engine,
+                                            scan_state_t state) {
+    if (engine == SCAN_ENGINE_TRIE) {
+        return (token_category_t)kt_cat[state];
     }
-    return CC_OTHER;
+    return accept_category(state);
 }
 
 // Appends one character to the token buffer with bounds check.
@@ -124,112 +305,199 @@ static void add_char_to_lexeme(char *buf, int *len, int ch) {
     }
 }
 
-// Reports grouped non-recognized lexeme.
-static void report_nonrecognized(logger_t *lg, int line, const char *lexeme) {
-    err_report(logger_get_dest(lg), ERR_NONRECOGNIZED, ERR_STEP_SCANNER,
-               line, lexeme);
+// Reports one lexeme-carrying error. lex need not be NUL-terminated; it is
+// copied into a bounded buffer only on this (rare) error path.
+static void report_lexeme(logger_t *lg, int err_id, int line, const char *lex,
+                          int len) {
+    char text[MAX_LEXEME_LEN];
+    int i;
+
+    for (i = 0; i < len && i < MAX_LEXEME_LEN - 1; i++) {
+        text[i] = lex[i];
+    }
+    text[i] = '\0';
+    err_report(logger_get_dest(lg), err_id, ERR_STEP_SCANNER, line, text);
 }
 
-// Reports unterminated literal.
-static void report_unterminated_literal(logger_t *lg, int line,
-                                        const char *lexeme) {
-    err_report(logger_get_dest(lg), ERR_UNTERMINATED_LIT, ERR_STEP_SCANNER,
-               line, lexeme);
+// Length of the source span [start, cursor), capped like the lexeme buffer.
+static int span_length(const char_stream_t *cs, size_t start) {
+    size_t len = cs_pos(cs) - start;
+
+    if (len > (size_t)(MAX_LEXEME_LEN - 1)) {
+        return MAX_LEXEME_LEN - 1;
+    }
+    return (int)len;
 }
 
+// Destination of emitted tokens: a token list, or one pull-scanner slot.
+typedef struct {
+    token_list_t *list;     // Token list sink (NULL when filling slot).
+    scanner_token_t *slot;  // Pull-scanner slot sink.
+} scan_sink_t;
+
+// Stores one token in a pull-scanner slot: a span view when src is set,
+// else a copy of buf in the slot.
+static void fill_slot(scanner_token_t *slot, const char *src, size_t start,
+                      int len, const char *buf, token_category_t cat,
+                      int line, int col) {
+    int i;
+
+    if (src != NULL) {
+        token_init(&slot->tok, (uint32_t)start, len, TOKEN_FLAG_SOURCE,
+                   cat, line, col);
+        slot->lex.data = src + start;
+        slot->lex.len = len;
+        return;
+    }
+    for (i = 0; i < len; i++) {
+        slot->buf[i] = buf[i];
+    }
+    slot->buf[len] = '\0';
+    token_init(&slot->tok, 0, len, 0, cat, line, col);
+    slot->lex.data = slot->buf;
+    slot->lex.len = len;
+}
+
+// Appends one token: a source span when src is set, else a copy of buf.
+static void emit_token(scan_sink_t *out, const char *src, size_t start,
+                       int len, const char *buf, token_category_t cat,
+                       int line, int col) {
+    if (out->list == NULL) {
+        fill_slot(out->slot, src, start, len, buf, cat, line, col);
+        return;
+    }
+    if (src != NULL) {
+        tl_add_span(out->list, start, len, cat, line, col);
+        return;
+    }
+    tl_add_lexeme(out->list, buf, len, cat, line, col);
+}
+
+// Defensive recovery: consumes one char as a NONRECOGNIZED token.
+static void scan_fallback(char_stream_t *cs, scan_sink_t *out,
+                          logger_t *lg, counter_t *cnt, const char *src) {
+    char fallback[2];
+    int line = cs_line(cs);
+    int col = cs_col(cs);
+    size_t start = cs_pos(cs);
+    int ch = cs_get(cs);
+
+    CNT_IO(cnt, 1);
+    fallback[0] = (char)ch;
+    fallback[1] = '\0';
+    report_lexeme(lg, ERR_NONRECOGNIZED, line, fallback, 1);
+    emit_token(out, src, start, (src != NULL) ? span_length(cs, start) : 1,
+               fallback,
+               CAT_NONRECOGNIZED, line, col);
+}
+
+// Scan position handed across a chunk boundary (speculative scan).
+typedef struct {
+    scan_state_t state;  // DFA state at the boundary (ST_START: no open token).
+    size_t tok_start;    // Open token: first byte offset in the source.
+    int tok_line;        // Open token: 1-based line.
+    int tok_col;         // Open token: 1-based column.
+    int hold;            // 1: stop at end of input, keeping the open token.
+} scan_carry_t;
+
 // Scans one token with the DFA. Returns 1 when a token is emitted, 0 on EOF.
-static int scanner_next_token(char_stream_t *cs, token_list_t *tokens,
-                              logger_t *lg, counter_t *cnt) {
+// With a resident source (src != NULL) the lexeme is tracked as a span of
+// src and no character is copied; otherwise it is accumulated in buf.
+// With carry, scanning resumes the token carried in, and (carry->hold) a
+// token still open at end of input is stored back in carry instead of
+// being emitted.
+static int scanner_next_token(char_stream_t *cs, scan_sink_t *out,
+                              logger_t *lg, counter_t *cnt,
+                              scan_engine_t engine, const char *src,
+                              scan_carry_t *carry) {
     scan_state_t state = ST_START;
     scan_state_t last_accept_state = ST_STOP; // ST_STOP means no accept yet.
     char buf[MAX_LEXEME_LEN];
     int buf_len = 0;
+    size_t tok_start = 0;
     int tok_line = cs_line(cs);
     int tok_col = cs_col(cs);
     int ch;
-    char_class_t cls;
     scan_state_t next;
 
     buf[0] = '\0';
 
+    // Resume the token left open at the end of the previous chunk.
+    if (carry != NULL && carry->state != ST_START) {
+        state = carry->state;
+        if (dfa_accepts(engine, state)) {
+            last_accept_state = state;
+        }
+        tok_start = carry->tok_start;
+        tok_line = carry->tok_line;
+        tok_col = carry->tok_col;
+        carry->state = ST_START;
+    }
+
     while (1) {
         // Defensive check: ST_STOP should never be a current state.
         if (state == ST_STOP) {
             // internal error: force recovery by consuming 1 char
-            char fallback[2];
-            token_t tok;
-            int fb_line = cs_line(cs);
-            int fb_col  = cs_col(cs);
-            ch = cs_get(cs);
-            CNT_IO(cnt, 1);
-            fallback[0] = (char)ch;
-            fallback[1] = '\0';
-            report_nonrecognized(lg, fb_line, fallback);
-            token_init(&tok, fallback, CAT_NONRECOGNIZED, fb_line, fb_col);
-            tl_add(tokens, &tok);
+            scan_fallback(cs, out, lg, cnt, src);
             return 1;  // continue scanning
         }
 
         ch = cs_peek(cs);
         CNT_COMP(cnt, 1);
 
-        cls = classify_char(ch);
+        next = dfa_step(engine, state, ch);
         CNT_COMP(cnt, 1);
 
-        next = T[state][cls];
+        // Chunk end: hand the open token (if any) to the next chunk.
+        if (ch == CS_EOF && carry != NULL && carry->hold) {
+            carry->state = state;
+            carry->tok_start = tok_start;
+            carry->tok_line = tok_line;
+            carry->tok_col = tok_col;
+            return 0;
+        }
 
         // Handle STOP/ERROR transitions.
         if (next == ST_STOP || next == ST_ERROR) {
+            const char *lex = (src != NULL) ? src + tok_start : buf;
+            int lex_len = (src != NULL) ? span_length(cs, tok_start) : buf_len;
+
             if (next == ST_ERROR && state == ST_IN_LITERAL) {
                 // Unterminated literal: exactly one error + one token.
-                report_unterminated_literal(lg, tok_line, buf);
-                {
-                    token_t tok;
-                    token_init(&tok, buf, CAT_NONRECOGNIZED, tok_line, tok_col);
-                    tl_add(tokens, &tok);
-                }
+                report_lexeme(lg, ERR_UNTERMINATED_LIT, tok_line, lex, lex_len);
+                emit_token(out, src, tok_start, lex_len, buf,
+                           CAT_NONRECOGNIZED, tok_line, tok_col);
                 return 1;
             }
 
             if (last_accept_state != ST_STOP) {
                 // Emit token from the last accepting state.
-                token_category_t cat = accept_category(last_accept_state);
-                token_t tok;
+                token_category_t cat = dfa_category(engine, last_accept_state);
 
-                // Reclassify accepted identifiers as keywords.
-                if (cat == CAT_IDENTIFIER && ls_is_keyword(buf)) {
+                // Reclassify accepted identifiers as keywords (the TRIE
+                // engine already ended in a keyword state).
+                if (cat == CAT_IDENTIFIER && engine != SCAN_ENGINE_TRIE &&
+                    ls_is_keyword_n(lex, lex_len)) {
                     cat = CAT_KEYWORD;
                 }
 
-                token_init(&tok, buf, cat, tok_line, tok_col);
-                tl_add(tokens, &tok);
+                emit_token(out, src, tok_start, lex_len, buf, cat,
+                           tok_line, tok_col);
 
                 // One error for one grouped non-recognized token.
                 if (cat == CAT_NONRECOGNIZED) {
-                    report_nonrecognized(lg, tok_line, buf);
+                    report_lexeme(lg, ERR_NONRECOGNIZED, tok_line, lex, lex_len);
                 }
                 return 1;
             }
 
             // EOF reached with no pending token.
-            if (state == ST_START && cls == CC_EOF) {
+            if (state == ST_START && ch == CS_EOF) {
                 return 0;
             }
 
             // Defensive fallback: consume one char as NONRECOGNIZED and continue.
-            {
-                char fallback[2];
-                token_t tok;
-                tok_line = cs_line(cs);
-                tok_col  = cs_col(cs);
-                ch = cs_get(cs);
-                CNT_IO(cnt, 1);
-                fallback[0] = (char)ch;
-                fallback[1] = '\0';
-                report_nonrecognized(lg, tok_line, fallback);
-                token_init(&tok, fallback, CAT_NONRECOGNIZED, tok_line, tok_col);
-                tl_add(tokens, &tok);
-            }
+            scan_fallback(cs, out, lg, cnt, src);
             return 1;
         }
 
@@ -245,27 +513,555 @@ static int scanner_next_token(char_stream_t *cs, token_list_t *tokens,
             // Track source position of first token character.
             tok_line = cs_line(cs);
             tok_col = cs_col(cs);
+            tok_start = cs_pos(cs);
         }
 
         ch = cs_get(cs);
         CNT_IO(cnt, 1);
         CNT_GEN(cnt, 1);
-        add_char_to_lexeme(buf, &buf_len, ch);
+        if (src == NULL) {
+            add_char_to_lexeme(buf, &buf_len, ch);
+        }
 
         state = next;
 
         // Keep last accepting state for maximal munch.
-        if (is_accepting(state)) {
+        if (dfa_accepts(engine, state)) {
             last_accept_state = state;
         }
     }
 }
 
-// Scanner loop until EOF.
+// Scanner loop until EOF, optionally resuming/holding a carried token.
+static void scan_range(char_stream_t *cs, token_list_t *tokens, logger_t *lg,
+                       counter_t *cnt, scan_engine_t engine,
+                       scan_carry_t *carry) {
+    const char *src = NULL;
+    scan_sink_t out;
+
+    out.list = tokens;
+    out.slot = NULL;
+    if (engine != SCAN_ENGINE_MATRIX) {
+        automata_init_tables();
+    }
+    // Zero-copy lexemes when the list is attached to this stream's bytes.
+    if (tl_source(tokens) != NULL && tl_source(tokens) == cs_data(cs, NULL)) {
+        src = tl_source(tokens);
+    }
+    while (scanner_next_token(cs, &out, lg, cnt, engine, src, carry)) {
+        // Continue scanning.
+    }
+}
+
+// Scanner loop until EOF with an explicit engine.
+int automata_scan_engine(char_stream_t *cs, token_list_t *tokens, logger_t *lg,
+                         counter_t *cnt, scan_engine_t engine) {
+    scan_range(cs, tokens, lg, cnt, engine, NULL);
+    return 0;
+}
+
+// Scans one token into tokens (same source rules as automata_scan_engine).
+int automata_scan_next(char_stream_t *cs, token_list_t *tokens, logger_t *lg,
+                       counter_t *cnt, scan_engine_t engine) {
+    scan_sink_t out;
+    const char *src = NULL;
+
+    out.list = tokens;
+    out.slot = NULL;
+    if (engine != SCAN_ENGINE_MATRIX) {
+        automata_init_tables();
+    }
+    if (tl_source(tokens) != NULL && tl_source(tokens) == cs_data(cs, NULL)) {
+        src = tl_source(tokens);
+    }
+    return scanner_next_token(cs, &out, lg, cnt, engine, src, NULL);
+}
+
+// Whole-input scan with the engine, threads, split, messages and counters
+// of one scan context.
+int automata_scan_ctx(char_stream_t *cs, token_list_t *tokens,
+                      scanner_ctx_t *ctx) {
+    counter_t *cnt;
+
+    if (cs == NULL || tokens == NULL || ctx == NULL) {
+        return -1;
+    }
+    cnt = scanner_ctx_counter(ctx);
+    if (ctx->cfg.split == SCAN_SPLIT_SPECULATIVE) {
+        return automata_scan_speculative(cs, tokens, &ctx->lg, cnt,
+                                         ctx->cfg.engine, ctx->cfg.threads);
+    }
+    return automata_scan_parallel(cs, tokens, &ctx->lg, cnt, ctx->cfg.engine,
+                                  ctx->cfg.threads);
+}
+
+// Scanner loop until EOF with the configured SCAN_ENGINE.
 int automata_scan(char_stream_t *cs, token_list_t *tokens, logger_t *lg,
                   counter_t *cnt) {
-    while (scanner_next_token(cs, tokens, lg, cnt)) {
-        // Continue scanning.
+    return automata_scan_engine(cs, tokens, lg, cnt, SCAN_ENGINE);
+}
+
+// Opens the input and an empty lookahead window.
+int scanner_open(scanner_t *sc, const char *filename, logger_t *lg,
+                 counter_t *cnt, scan_engine_t engine) {
+    if (sc == NULL || filename == NULL) {
+        return -1;
+    }
+    if (cs_open(&sc->cs, filename) != 0) {
+        return -1;
+    }
+    if (engine != SCAN_ENGINE_MATRIX) {
+        automata_init_tables();
+    }
+    sc->lg = lg;
+    sc->cnt = cnt;
+    sc->engine = engine;
+    sc->src = cs_data(&sc->cs, NULL);
+    sc->head = 0;
+    sc->count = 0;
+    sc->at_eof = 0;
+    return 0;
+}
+
+// Scans tokens into the window until it holds k of them or input ends.
+static int scanner_fill(scanner_t *sc, int k) {
+    while (sc->count < k && !sc->at_eof) {
+        scan_sink_t out;
+
+        out.list = NULL;
+        out.slot = &sc->ring[(sc->head + sc->count) % SCANNER_RING];
+        if (scanner_next_token(&sc->cs, &out, sc->lg, sc->cnt, sc->engine,
+                               sc->src, NULL)) {
+            sc->count++;
+        } else {
+            sc->at_eof = 1;
+        }
     }
+    return sc->count >= k;
+}
+
+// Returns the k-th upcoming token (k = 1 is the next one) or NULL.
+const scanner_token_t* scanner_peek(scanner_t *sc, int k) {
+    if (sc == NULL || k < 1 || k > SCANNER_LOOKAHEAD) {
+        return NULL;
+    }
+    if (!scanner_fill(sc, k)) {
+        return NULL;
+    }
+    return &sc->ring[(sc->head + k - 1) % SCANNER_RING];
+}
+
+// Consumes and returns the next token, or NULL at end of input.
+const scanner_token_t* scanner_next(scanner_t *sc) {
+    const scanner_token_t *tok;
+
+    if (sc == NULL || !scanner_fill(sc, 1)) {
+        return NULL;
+    }
+    tok = &sc->ring[sc->head];
+    sc->head = (sc->head + 1) % SCANNER_RING;
+    sc->count--;
+    return tok;
+}
+
+// Closes the input; pending tokens are dropped.
+void scanner_close(scanner_t *sc) {
+    if (sc == NULL) {
+        return;
+    }
+    cs_close(&sc->cs);
+    sc->src = NULL;
+    sc->count = 0;
+    sc->at_eof = 1;
+}
+
+// Comparisons made by the final end-of-input probe of a scan (one peek and
+// one step). Every chunk but the last pays it once more than a sequential
+// scan would.
+#define SCAN_EOF_PROBE_COMPS 2
+
+// Copy buffer for replaying captured messages.
+#define SCAN_LOG_COPY_BUF 4096
+
+// States a speculative simulation may start from (TRIE has the most).
+#define SPEC_MAX_STATES KT_STATES
+
+// map_tok value: the open token started before the chunk.
+#define SPEC_TOK_INHERIT ((size_t)-1)
+
+// One slice of the input and its private scan results.
+typedef struct {
+    const char *src;       // Whole resident input.
+    size_t src_len;        // Input length in bytes.
+    size_t begin;          // First byte of the chunk.
+    size_t end;            // One past the last byte.
+    int first_line;        // Line of the first byte.
+    int first_col;         // Column of the first byte.
+    int newlines;          // Newlines inside [begin, end).
+    size_t line_begin;     // Offset after the last newline in the chunk, or
+                           // SPEC_TOK_INHERIT when it has none.
+    scan_engine_t engine;  // DFA engine.
+    scan_carry_t carry;    // Entry state / open token (speculative scan).
+    uint16_t map[SPEC_MAX_STATES];      // Entry state -> exit state.
+    size_t map_tok[SPEC_MAX_STATES];    // Entry state -> open token start.
+    token_list_t tokens;   // Chunk tokens (spans of src).
+    counter_t cnt;         // Chunk operation counts.
+    FILE *log;             // Captured error messages.
+} scan_chunk_t;
+
+// Returns the number of scanner threads to use for a request.
+static int scan_thread_count(int requested) {
+    long n = 1;
+
+    if (requested > 0) {
+        n = requested;
+    } else {
+#if !defined(_WIN32) && defined(_SC_NPROCESSORS_ONLN)
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+    if (n < 1) {
+        n = 1;
+    }
+    if (n > SCAN_MAX_THREADS) {
+        n = SCAN_MAX_THREADS;
+    }
+    return (int)n;
+}
+
+// Counts the newlines of one chunk and remembers where its last line begins.
+static void* chunk_count_lines(void *arg) {
+    scan_chunk_t *chunk = (scan_chunk_t *)arg;
+    const char *p = chunk->src + chunk->begin;
+    const char *end = chunk->src + chunk->end;
+
+    chunk->newlines = 0;
+    chunk->line_begin = SPEC_TOK_INHERIT;
+    while (p < end && (p = memchr(p, WS_NL, (size_t)(end - p))) != NULL) {
+        chunk->newlines++;
+        p++;
+        chunk->line_begin = (size_t)(p - chunk->src);
+    }
+    return NULL;
+}
+
+// Scans one chunk through a view stream into the chunk's own list.
+static void* chunk_scan(void *arg) {
+    scan_chunk_t *chunk = (scan_chunk_t *)arg;
+    char_stream_t cs;
+    logger_t lg;
+
+    if (cs_open_view(&cs, chunk->src, chunk->src_len, chunk->begin,
+                     chunk->end, chunk->first_line, chunk->first_col) != 0) {
+        return NULL;
+    }
+    logger_init_dest(&lg, chunk->log);
+    scan_range(&cs, &chunk->tokens, &lg, &chunk->cnt, chunk->engine,
+               &chunk->carry);
+    cs_close(&cs);
+    return NULL;
+}
+
+// Token-level step used by the speculative simulation: the state after
+// ch has been consumed, following scanner_next_token (a token ending on a
+// STOP/ERROR edge is emitted and ch restarts from ST_START; a dead end
+// consumes ch as a fallback token). *started is set when a token begins
+// at ch.
+static inline scan_state_t lex_step(scan_engine_t engine, scan_state_t state,
+                                    int ch, int *started) {
+    scan_state_t next = dfa_step(engine, state, ch);
+
+    if (next != ST_STOP && next != ST_ERROR) {
+        *started = (state == ST_START && next != ST_START);
+        return next;
+    }
+    if (state != ST_START &&
+        (dfa_accepts(engine, state) ||
+         (state == ST_IN_LITERAL && next == ST_ERROR))) {
+        next = dfa_step(engine, ST_START, ch);
+        if (next != ST_STOP && next != ST_ERROR) {
+            *started = (next != ST_START);
+            return next;
+        }
+    }
+    *started = 0;
+    return ST_START;
+}
+
+// Returns 1 when state can be live between two bytes of a token.
+static int spec_live_state(scan_engine_t engine, int state) {
+    int nstates = (engine == SCAN_ENGINE_TRIE) ? KT_STATES : ST_COUNT;
+
+    return state < nstates && state != ST_STOP && state != ST_ERROR;
+}
+
+// Simulates the chunk from every live entry state at once and records the
+// exit state and open-token start per entry state. The runs are advanced
+// in lockstep until all are back in ST_START, then followed as one.
+static void* chunk_simulate(void *arg) {
+    scan_chunk_t *chunk = (scan_chunk_t *)arg;
+    const unsigned char *src = (const unsigned char *)chunk->src;
+    scan_state_t cur[SPEC_MAX_STATES];
+    size_t tok[SPEC_MAX_STATES];
+    int entry[SPEC_MAX_STATES];
+    int runs = 0;
+    int merged = 0;
+    int started;
+    size_t pos = chunk->begin;
+    int k;
+
+    for (k = 0; k < SPEC_MAX_STATES; k++) {
+        chunk->map[k] = ST_START;
+        chunk->map_tok[k] = SPEC_TOK_INHERIT;
+        if (spec_live_state(chunk->engine, k)) {
+            entry[runs] = k;
+            cur[runs] = (scan_state_t)k;
+            tok[runs] = SPEC_TOK_INHERIT;
+            runs++;
+        }
+    }
+
+    for (; pos < chunk->end && !merged; pos++) {
+        merged = 1;
+        for (k = 0; k < runs; k++) {
+            cur[k] = lex_step(chunk->engine, cur[k], src[pos], &started);
+            if (started) {
+                tok[k] = pos;
+            }
+            merged &= (cur[k] == ST_START);
+        }
+    }
+    // All runs are in ST_START with no open token: follow them as one.
+    for (; pos < chunk->end; pos++) {
+        cur[0] = lex_step(chunk->engine, cur[0], src[pos], &started);
+        if (started) {
+            tok[0] = pos;
+        }
+    }
+
+    for (k = 0; k < runs; k++) {
+        int r = merged ? 0 : k;
+        chunk->map[entry[k]] = (uint16_t)cur[r];
+        chunk->map_tok[entry[k]] = tok[r];
+    }
+    return NULL;
+}
+
+// Runs fn on every chunk: chunk 0 on the calling thread, the rest on new
+// threads (inline if a thread cannot be created).
+static void run_chunks(scan_chunk_t *chunks, int n, void *(*fn)(void *)) {
+    pthread_t threads[SCAN_MAX_THREADS];
+    int started[SCAN_MAX_THREADS];
+    int i;
+
+    for (i = 1; i < n; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, fn, &chunks[i]) == 0);
+        if (!started[i]) {
+            fn(&chunks[i]);
+        }
+    }
+    fn(&chunks[0]);
+    for (i = 1; i < n; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+// Copies captured messages to dest and closes the capture file.
+static void replay_log(FILE *log, FILE *dest) {
+    char buf[SCAN_LOG_COPY_BUF];
+    size_t got;
+
+    rewind(log);
+    while ((got = fread(buf, 1, sizeof(buf), log)) > 0) {
+        fwrite(buf, 1, got, dest);
+    }
+    fclose(log);
+}
+
+// Cuts [start, len) into at most n chunks of at least SCAN_PAR_MIN_CHUNK
+// bytes. With align_newline each chunk ends just after a newline (the last
+// one at len). Returns the number of chunks.
+static int split_chunks(scan_chunk_t *chunks, int n, const char *src,
+                        size_t start, size_t len, int align_newline) {
+    size_t begin = start;
+    int count = 0;
+
+    while (begin < len && count < n) {
+        size_t end = len;
+
+        if (count < n - 1) {
+            size_t target = begin + (len - begin) / (size_t)(n - count);
+
+            if (target < begin + SCAN_PAR_MIN_CHUNK) {
+                target = begin + SCAN_PAR_MIN_CHUNK;
+            }
+            if (!align_newline) {
+                end = (target < len) ? target : len;
+            } else if (target < len) {
+                const char *nl = memchr(src + target, WS_NL, len - target);
+                if (nl != NULL) {
+                    end = (size_t)(nl - src) + 1;
+                }
+            }
+        }
+        chunks[count].src = src;
+        chunks[count].src_len = len;
+        chunks[count].begin = begin;
+        chunks[count].end = end;
+        count++;
+        begin = end;
+    }
+    return count;
+}
+
+// Gives each chunk its first line and column from the newline counts.
+static void place_chunks(scan_chunk_t *chunks, int n, int line, int col) {
+    int i;
+
+    for (i = 0; i < n; i++) {
+        chunks[i].first_line = line;
+        chunks[i].first_col = col;
+        line += chunks[i].newlines;
+        if (chunks[i].line_begin != SPEC_TOK_INHERIT) {
+            col = 1 + (int)(chunks[i].end - chunks[i].line_begin);
+        } else {
+            col += (int)(chunks[i].end - chunks[i].begin);
+        }
+    }
+}
+
+// Line and column of source offset off, which lies in chunks[i].
+static void locate_offset(const scan_chunk_t *chunks, int i, size_t off,
+                          int *line, int *col) {
+    const char *src = chunks[i].src;
+    size_t p = chunks[i].begin;
+    size_t line_begin = chunks[i].begin;
+
+    *line = chunks[i].first_line;
+    for (; p < off; p++) {
+        if (src[p] == WS_NL) {
+            (*line)++;
+            line_begin = p + 1;
+        }
+    }
+    if (line_begin == chunks[i].begin) {
+        *col = chunks[i].first_col + (int)(off - chunks[i].begin);
+    } else {
+        *col = 1 + (int)(off - line_begin);
+    }
+}
+
+// Index of the chunk holding source offset off.
+static int chunk_of(const scan_chunk_t *chunks, int n, size_t off) {
+    int i;
+
+    for (i = n - 1; i > 0 && off < chunks[i].begin; i--) {
+        // Walk back to the owning chunk.
+    }
+    return i;
+}
+
+// Parallel scan driver shared by both split strategies.
+static int scan_chunked(char_stream_t *cs, token_list_t *tokens,
+                        logger_t *lg, counter_t *cnt, scan_engine_t engine,
+                        int nthreads, int speculative) {
+    scan_chunk_t *chunks;
+    const char *src;
+    size_t len;
+    int n;
+    int i;
+
+    src = cs_data(cs, &len);
+    n = scan_thread_count(nthreads);
+    if (n > 1 && len / SCAN_PAR_MIN_CHUNK < (size_t)n) {
+        n = (int)(len / SCAN_PAR_MIN_CHUNK);
+    }
+    // Tables are shared read-only by the workers.
+    automata_init_tables();
+    // Spans are required: chunk lists are merged as plain token copies.
+    if (n <= 1 || src == NULL || tl_source(tokens) != src ||
+        (speculative && !accept_is_sticky)) {
+        return automata_scan_engine(cs, tokens, lg, cnt, engine);
+    }
+
+    chunks = (scan_chunk_t *)malloc((size_t)n * sizeof(scan_chunk_t));
+    if (chunks == NULL) {
+        return automata_scan_engine(cs, tokens, lg, cnt, engine);
+    }
+    n = split_chunks(chunks, n, src, cs_pos(cs), len, !speculative);
+    for (i = 0; i < n; i++) {
+        chunks[i].engine = engine;
+        chunks[i].carry.state = ST_START;
+        chunks[i].carry.hold = (i < n - 1) && speculative;
+        chunks[i].log = tmpfile();
+        if (chunks[i].log == NULL) {
+            while (--i >= 0) {
+                fclose(chunks[i].log);
+            }
+            free(chunks);
+            return automata_scan_engine(cs, tokens, lg, cnt, engine);
+        }
+        tl_init(&chunks[i].tokens);
+        tl_set_source(&chunks[i].tokens, src, len);
+        counter_init(&chunks[i].cnt);
+    }
+
+    run_chunks(chunks, n, chunk_count_lines);
+    place_chunks(chunks, n, cs_line(cs), cs_col(cs));
+
+    if (speculative) {
+        scan_state_t state = ST_START;
+        size_t tok_start = 0;
+
+        run_chunks(chunks, n, chunk_simulate);
+        // Prefix composition of the chunk maps from the true entry state.
+        for (i = 0; i < n; i++) {
+            chunks[i].carry.state = state;
+            if (state != ST_START) {
+                chunks[i].carry.tok_start = tok_start;
+                locate_offset(chunks, chunk_of(chunks, n, tok_start), tok_start,
+                              &chunks[i].carry.tok_line,
+                              &chunks[i].carry.tok_col);
+            }
+            if (chunks[i].map_tok[state] != SPEC_TOK_INHERIT) {
+                tok_start = chunks[i].map_tok[state];
+            }
+            state = (scan_state_t)chunks[i].map[state];
+        }
+    }
+    run_chunks(chunks, n, chunk_scan);
+
+    for (i = 0; i < n; i++) {
+        tl_append(tokens, &chunks[i].tokens);
+        tl_free(&chunks[i].tokens);
+        replay_log(chunks[i].log, logger_get_dest(lg));
+#ifdef COUNTCONFIG
+        if (cnt != NULL) {
+            cnt->comp += chunks[i].cnt.comp;
+            cnt->io += chunks[i].cnt.io;
+            cnt->gen += chunks[i].cnt.gen;
+            if (i < n - 1) {
+                cnt->comp -= SCAN_EOF_PROBE_COMPS;
+            }
+        }
+#endif
+    }
+    free(chunks);
     return 0;
 }
+
+// Parallel scanner split at newlines.
+int automata_scan_parallel(char_stream_t *cs, token_list_t *tokens,
+                           logger_t *lg, counter_t *cnt, scan_engine_t engine,
+                           int nthreads) {
+    return scan_chunked(cs, tokens, lg, cnt, engine, nthreads, 0);
+}
+
+// Parallel scanner split anywhere, stitched by speculative simulation.
+int automata_scan_speculative(char_stream_t *cs, token_list_t *tokens,
+                              logger_t *lg, counter_t *cnt,
+                              scan_engine_t engine, int nthreads) {
+    return scan_chunked(cs, tokens, lg, cnt, engine, nthreads, 1);
+}
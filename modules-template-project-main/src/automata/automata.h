@@ -9,12 +9,40 @@
  *
  * Automata implemented:
  *   - NUMBER:      [0-9]+
- *   - IDENTIFIER:  [A-Za-z][A-Za-z0-9]*  (post-check for keywords)
+ *   - IDENTIFIER:  [A-Za-z][A-Za-z0-9]*  (post-check for keywords, or
+ *                  keyword trie states with the TRIE engine)
  *   - LITERAL:     "...", any char except newline/EOF inside
  *   - OPERATOR:    single char  = > + *
  *   - SPECIALCHAR: single char  ( ) ; { } [ ] ,
  *   - NONRECOGNIZED: consecutive invalid chars grouped into one token
  *
+ * Engines (SCAN_ENGINE, or per call with automata_scan_engine):
+ *   - MATRIX: classify byte -> class, then T[state][class].
+ *   - FUSED:  FT[state][byte] precomputed from T and the class map plus an
+ *             accepting-state bitmask; one dependent load per byte.
+ *   - TRIE:   FUSED extended with one state per keyword prefix, built from
+ *             LS_KEYWORD_LIST; keywords are recognized in the same pass as
+ *             identifiers and there is no keyword post-check.
+ *
+ * Pull API (scanner_t): scanner_open / scanner_next / scanner_peek(k) /
+ * scanner_close hand out one token at a time from a fixed ring of
+ * SCANNER_LOOKAHEAD + 1 slots, so memory is bounded by the lookahead depth
+ * instead of the input size.
+ *
+ * Parallel scan (automata_scan_parallel): a newline never occurs inside a
+ * token (ST_IN_LITERAL ends in error at CC_NEWLINE), so a resident input is
+ * cut right after newlines into chunks that are scanned concurrently, each
+ * with its own line offset, token list, counters and captured messages;
+ * results are concatenated in input order (output identical to one thread).
+ *
+ * Speculative scan (automata_scan_speculative): chunks are cut anywhere, so
+ * it stays correct for any transition matrix (block comments, multi-line
+ * literals). Each chunk is first simulated from every live DFA state,
+ * recording exit state and open-token start per entry state; a prefix
+ * composition of those maps gives each chunk its true entry state, and the
+ * chunks are then scanned concurrently from it. A token crossing a chunk
+ * boundary is emitted by the chunk it ends in.
+ *
  * Team: Compilers P2
  * -----------------------------------------------------------------------------
  */
@@ -27,6 +55,7 @@
 #include "../error_mod/error_mod.h"
 #include "../logger/logger.h"
 #include "../counter/counter.h"
+#include "../scan_ctx/scan_ctx.h"
 
 // Character class indices for transition matrix columns.
 typedef enum {
@@ -57,11 +86,103 @@ typedef enum {
     ST_COUNT       = 10  // number of states
 } scan_state_t;
 
+// scan_engine_t and the SCAN_ENGINE / SCAN_THREADS / SCAN_SPLIT defaults
+// live in scan_ctx.h.
+
+// Smallest chunk handed to a scanner thread, and the thread cap.
+#define SCAN_PAR_MIN_CHUNK (256 * 1024)
+#define SCAN_MAX_THREADS   64
+
+// Pull scanner lookahead depth: largest k accepted by scanner_peek.
+#ifndef SCANNER_LOOKAHEAD
+#define SCANNER_LOOKAHEAD 4
+#endif
+
+// Ring slots: the lookahead window plus the last token handed out.
+#define SCANNER_RING (SCANNER_LOOKAHEAD + 1)
+
+// One pulled token. lex views the mapped input, or buf for streamed input.
+typedef struct {
+    token_t tok;               // Category, line, column, length.
+    lexeme_view_t lex;         // Lexeme bytes (not NUL-terminated for spans).
+    char buf[MAX_LEXEME_LEN];  // Lexeme copy when the input is not resident.
+} scanner_token_t;
+
+// Pull scanner state.
+typedef struct {
+    char_stream_t cs;                    // Owned input stream.
+    logger_t *lg;                        // Error destination.
+    counter_t *cnt;                      // Operation counters (or NULL).
+    scan_engine_t engine;                // DFA engine.
+    const char *src;                     // Resident input bytes, or NULL.
+    scanner_token_t ring[SCANNER_RING];  // Lookahead window.
+    int head;                            // Ring index of the next token.
+    int count;                           // Tokens scanned but not consumed.
+    int at_eof;                          // 1 once input is exhausted.
+} scanner_t;
+
 // Scans complete input and appends all tokens to token_list.
 int automata_scan(char_stream_t *cs, token_list_t *tokens, logger_t *lg,
                   counter_t *cnt);
 
+// Scans complete input with the settings, logger and counters of ctx
+// (automata_scan_speculative for SCAN_SPLIT_SPECULATIVE, else
+// automata_scan_parallel). Reentrant: concurrent scans need separate
+// contexts, streams and token lists.
+int automata_scan_ctx(char_stream_t *cs, token_list_t *tokens,
+                      scanner_ctx_t *ctx);
+
+// Same as automata_scan with an explicit engine.
+int automata_scan_engine(char_stream_t *cs, token_list_t *tokens, logger_t *lg,
+                         counter_t *cnt, scan_engine_t engine);
+
+// Scans one more token into tokens. Returns 1 when a token was appended,
+// 0 at end of input (producer side of the pipeline mode).
+int automata_scan_next(char_stream_t *cs, token_list_t *tokens, logger_t *lg,
+                       counter_t *cnt, scan_engine_t engine);
+
+// Scans complete input with up to nthreads threads (0 = one per online CPU).
+// Needs tokens attached to the stream's resident bytes (tl_set_source);
+// otherwise, or for small inputs, scans sequentially. Messages reach lg in
+// input order. The stream itself is not advanced.
+int automata_scan_parallel(char_stream_t *cs, token_list_t *tokens,
+                           logger_t *lg, counter_t *cnt, scan_engine_t engine,
+                           int nthreads);
+
+// Same contract as automata_scan_parallel, but chunks are cut at arbitrary
+// bytes and stitched by speculative all-states simulation.
+int automata_scan_speculative(char_stream_t *cs, token_list_t *tokens,
+                              logger_t *lg, counter_t *cnt,
+                              scan_engine_t engine, int nthreads);
+
+// Opens filename ("-" reads stdin) for pulling tokens. Returns 0 on success.
+int scanner_open(scanner_t *sc, const char *filename, logger_t *lg,
+                 counter_t *cnt, scan_engine_t engine);
+
+// Consumes the next token. Returns NULL at end of input. The token stays
+// valid until the following scanner_next call.
+const scanner_token_t* scanner_next(scanner_t *sc);
+
+// Returns the k-th upcoming token without consuming it (1 <= k <=
+// SCANNER_LOOKAHEAD), or NULL past end of input.
+const scanner_token_t* scanner_peek(scanner_t *sc, int k);
+
+// Closes the input.
+void scanner_close(scanner_t *sc);
+
+// Builds derived tables (fused DFA, keyword trie DFA) once per process.
+// Safe to call from several threads.
+void automata_init_tables(void);
+
 // Returns the character class for a character.
 char_class_t classify_char(int ch);
 
+// Returns the transition matrix entry T[st][cc] that every engine's tables
+// are derived from (ST_STOP outside the matrix).
+scan_state_t automata_next_state(scan_state_t st, char_class_t cc);
+
+// Returns the token category of accepting state st, or -1 when st is not
+// accepting.
+int automata_state_category(scan_state_t st);
+
 #endif /* AUTOMATA_H */
@@ -0,0 +1,419 @@
+/*
+ * -----------------------------------------------------------------------------
+ * batch.c
+ *
+ * Batch input expansion and work-stealing job pool.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#include "batch.h"
+#include <dirent.h>     // opendir, readdir, closedir
+#include <pthread.h>    // pthread_create, pthread_join, pthread_mutex_*
+#include <stdatomic.h>  // atomic_uint_least64_t
+#include <stdint.h>     // uint64_t
+#include <stdlib.h>     // malloc, realloc, calloc, free, qsort
+#include <string.h>     // strlen, strcmp, memcpy
+#include <sys/stat.h>   // stat, S_ISDIR
+#ifndef _WIN32
+#include <unistd.h>     // sysconf
+#endif
+
+#define BATCH_INIT_CAPACITY 16    // Initial path slots.
+#define BATCH_LINE_MAX      4096  // Longest file list line.
+#define BATCH_CACHE_LINE    64    // Deque padding.
+
+// Packed deque bounds: lo in the high half, hi in the low half.
+#define RANGE_PACK(lo, hi) (((uint64_t)(uint32_t)(lo) << 32) | (uint32_t)(hi))
+#define RANGE_LO(r)        ((int)((r) >> 32))
+#define RANGE_HI(r)        ((int)((r) & 0xFFFFFFFFu))
+
+// One worker's remaining jobs [lo, hi), padded to its own cache line.
+typedef struct {
+    atomic_uint_least64_t range;
+    char pad[BATCH_CACHE_LINE - sizeof(atomic_uint_least64_t)];
+} batch_deque_t;
+
+// Shared pool state.
+typedef struct {
+    batch_deque_t *deques;  // One deque per worker.
+    int nworkers;           // Worker count.
+    int njobs;              // Job count.
+    batch_job_fn fn;        // Job callback.
+    void *ctx;              // Callback context.
+    FILE *out;              // Report destination.
+    pthread_mutex_t lock;   // Guards the ordered report state below.
+    char **reports;         // Finished, not yet printed reports.
+    size_t *lens;           // Report lengths.
+    unsigned char *done;    // 1 once a job has finished.
+    int next_out;           // First job whose report is not printed.
+} batch_pool_t;
+
+// Thread argument.
+typedef struct {
+    batch_pool_t *pool;
+    int id;
+} batch_worker_t;
+
+// Initializes an empty input list.
+void batch_inputs_init(batch_inputs_t *in) {
+    if (in == NULL) {
+        return;
+    }
+    in->paths = NULL;
+    in->count = 0;
+    in->capacity = 0;
+}
+
+// Appends a copy of path.
+static int inputs_push(batch_inputs_t *in, const char *path) {
+    size_t len = strlen(path);
+    char *copy;
+
+    if (in->count == in->capacity) {
+        int cap = (in->capacity == 0) ? BATCH_INIT_CAPACITY : in->capacity * 2;
+        char **grown = (char **)realloc(in->paths, (size_t)cap * sizeof(char *));
+
+        if (grown == NULL) {
+            fprintf(stderr, "batch_collect: memory allocation failed\n");
+            return -1;
+        }
+        in->paths = grown;
+        in->capacity = cap;
+    }
+    copy = (char *)malloc(len + 1);
+    if (copy == NULL) {
+        fprintf(stderr, "batch_collect: memory allocation failed\n");
+        return -1;
+    }
+    memcpy(copy, path, len + 1);
+    in->paths[in->count++] = copy;
+    return 0;
+}
+
+// Returns 1 when path names a directory.
+static int is_directory(const char *path) {
+    struct stat st;
+
+    return (stat(path, &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+// Returns 1 when name ends with BATCH_SOURCE_SUFFIX.
+static int has_source_suffix(const char *name) {
+    size_t len = strlen(name);
+    size_t slen = strlen(BATCH_SOURCE_SUFFIX);
+
+    return (len > slen && strcmp(name + len - slen, BATCH_SOURCE_SUFFIX) == 0);
+}
+
+// qsort comparator for path strings.
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static int collect(batch_inputs_t *in, const char *arg, int depth);
+
+// Adds the source files under dir, entries in name order.
+static int collect_dir(batch_inputs_t *in, const char *dir, int depth) {
+    batch_inputs_t entries;
+    struct dirent *ent;
+    size_t dlen = strlen(dir);
+    size_t sep = (dlen > 0 && dir[dlen - 1] != '/') ? 1 : 0;
+    int status = 0;
+    int i;
+    DIR *d = opendir(dir);
+
+    if (d == NULL) {
+        return -1;
+    }
+    batch_inputs_init(&entries);
+    while ((ent = readdir(d)) != NULL) {
+        // Hidden entries, "." and ".." are skipped.
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        if (inputs_push(&entries, ent->d_name) != 0) {
+            status = -1;
+            break;
+        }
+    }
+    closedir(d);
+    if (entries.count > 0) {
+        qsort(entries.paths, (size_t)entries.count, sizeof(char *),
+              compare_names);
+    }
+
+    for (i = 0; i < entries.count && status == 0; i++) {
+        size_t nlen = strlen(entries.paths[i]);
+        char *path = (char *)malloc(dlen + sep + nlen + 1);
+
+        if (path == NULL) {
+            fprintf(stderr, "batch_collect: memory allocation failed\n");
+            status = -1;
+            break;
+        }
+        memcpy(path, dir, dlen);
+        path[dlen] = '/';
+        memcpy(path + dlen + sep, entries.paths[i], nlen + 1);
+
+        if (is_directory(path)) {
+            status = collect(in, path, depth + 1);
+        } else if (has_source_suffix(path)) {
+            status = inputs_push(in, path);
+        }
+        free(path);
+    }
+    batch_inputs_free(&entries);
+    return status;
+}
+
+// Adds every non-empty, non-comment line of a file list.
+static int collect_list(batch_inputs_t *in, const char *list, int depth) {
+    char line[BATCH_LINE_MAX];
+    int status = 0;
+    FILE *fp = fopen(list, "r");
+
+    if (fp == NULL) {
+        return -1;
+    }
+    while (status == 0 && fgets(line, sizeof(line), fp) != NULL) {
+        size_t len = strlen(line);
+
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' ||
+                           line[len - 1] == ' ' || line[len - 1] == '\t')) {
+            line[--len] = '\0';
+        }
+        if (len == 0 || line[0] == BATCH_LIST_COMMENT) {
+            continue;
+        }
+        status = collect(in, line, depth + 1);
+    }
+    fclose(fp);
+    return status;
+}
+
+// Expands one argument.
+static int collect(batch_inputs_t *in, const char *arg, int depth) {
+    if (depth > BATCH_MAX_DEPTH) {
+        return -1;
+    }
+    if (arg[0] == BATCH_LIST_PREFIX) {
+        return collect_list(in, arg + 1, depth);
+    }
+    if (is_directory(arg)) {
+        return collect_dir(in, arg, depth);
+    }
+    return inputs_push(in, arg);
+}
+
+// Returns 1 for directories and @filelist arguments.
+int batch_is_collection(const char *arg) {
+    if (arg == NULL) {
+        return 0;
+    }
+    return (arg[0] == BATCH_LIST_PREFIX || is_directory(arg));
+}
+
+// Appends the inputs named by arg.
+int batch_collect(batch_inputs_t *in, const char *arg) {
+    if (in == NULL || arg == NULL) {
+        return -1;
+    }
+    return collect(in, arg, 0);
+}
+
+// Frees every path.
+void batch_inputs_free(batch_inputs_t *in) {
+    int i;
+
+    if (in == NULL) {
+        return;
+    }
+    for (i = 0; i < in->count; i++) {
+        free(in->paths[i]);
+    }
+    free(in->paths);
+    batch_inputs_init(in);
+}
+
+// Returns the number of worker threads for a batch.
+int batch_thread_count(int requested, int njobs) {
+    long n = 1;
+
+    if (requested > 0) {
+        n = requested;
+    } else {
+#if !defined(_WIN32) && defined(_SC_NPROCESSORS_ONLN)
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+    if (n > njobs) {
+        n = njobs;
+    }
+    if (n > BATCH_MAX_THREADS) {
+        n = BATCH_MAX_THREADS;
+    }
+    if (n < 1) {
+        n = 1;
+    }
+    return (int)n;
+}
+
+// Takes the front job of dq. Returns -1 when it is empty.
+static int deque_take(batch_deque_t *dq) {
+    uint64_t r = atomic_load(&dq->range);
+
+    while (RANGE_LO(r) < RANGE_HI(r)) {
+        if (atomic_compare_exchange_weak(&dq->range, &r,
+                                         RANGE_PACK(RANGE_LO(r) + 1,
+                                                    RANGE_HI(r)))) {
+            return RANGE_LO(r);
+        }
+    }
+    return -1;
+}
+
+// Steals the back half of another worker's deque into self's (empty) deque
+// and returns its first job. Returns -1 when every deque is empty.
+static int deque_steal(batch_pool_t *pool, int self) {
+    int k;
+
+    for (k = 1; k < pool->nworkers; k++) {
+        batch_deque_t *victim = &pool->deques[(self + k) % pool->nworkers];
+        uint64_t r = atomic_load(&victim->range);
+
+        while (RANGE_LO(r) < RANGE_HI(r)) {
+            int lo = RANGE_LO(r);
+            int hi = RANGE_HI(r);
+            int mid = hi - (hi - lo + 1) / 2;
+
+            if (atomic_compare_exchange_weak(&victim->range, &r,
+                                             RANGE_PACK(lo, mid))) {
+                // Only self refills its empty deque; thieves skip it until then.
+                atomic_store(&pool->deques[self].range,
+                             RANGE_PACK(mid + 1, hi));
+                return mid;
+            }
+        }
+    }
+    return -1;
+}
+
+// Records a finished job and prints every report now in order.
+static void report_done(batch_pool_t *pool, int job, char *report,
+                        size_t len) {
+    pthread_mutex_lock(&pool->lock);
+    pool->reports[job] = report;
+    pool->lens[job] = len;
+    pool->done[job] = 1;
+    while (pool->next_out < pool->njobs && pool->done[pool->next_out]) {
+        int j = pool->next_out;
+
+        if (pool->reports[j] != NULL) {
+            fwrite(pool->reports[j], 1, pool->lens[j], pool->out);
+            free(pool->reports[j]);
+            pool->reports[j] = NULL;
+        }
+        pool->next_out++;
+    }
+    fflush(pool->out);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Worker loop: own jobs first, then steal until nothing is left.
+static void* batch_worker_main(void *arg) {
+    batch_worker_t *w = (batch_worker_t *)arg;
+    batch_pool_t *pool = w->pool;
+    int job;
+
+    for (;;) {
+        job = deque_take(&pool->deques[w->id]);
+        if (job < 0) {
+            job = deque_steal(pool, w->id);
+        }
+        if (job < 0) {
+            break;
+        }
+        {
+            size_t len = 0;
+            char *report = pool->fn(pool->ctx, w->id, job, &len);
+
+            report_done(pool, job, report, len);
+        }
+    }
+    return NULL;
+}
+
+// Runs every job on the pool and prints reports in job order.
+int batch_run(int njobs, int nthreads, batch_job_fn fn, void *ctx, FILE *out) {
+    batch_pool_t pool;
+    batch_worker_t workers[BATCH_MAX_THREADS];
+    pthread_t threads[BATCH_MAX_THREADS];
+    int started[BATCH_MAX_THREADS];
+    int i;
+
+    if (fn == NULL || njobs < 0) {
+        return -1;
+    }
+    if (njobs == 0) {
+        return 0;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (nthreads > BATCH_MAX_THREADS) {
+        nthreads = BATCH_MAX_THREADS;
+    }
+
+    pool.deques = (batch_deque_t *)malloc((size_t)nthreads *
+                                          sizeof(batch_deque_t));
+    pool.reports = (char **)calloc((size_t)njobs, sizeof(char *));
+    pool.lens = (size_t *)calloc((size_t)njobs, sizeof(size_t));
+    pool.done = (unsigned char *)calloc((size_t)njobs, 1);
+    if (pool.deques == NULL || pool.reports == NULL || pool.lens == NULL ||
+        pool.done == NULL) {
+        fprintf(stderr, "batch_run: memory allocation failed\n");
+        free(pool.deques);
+        free(pool.reports);
+        free(pool.lens);
+        free(pool.done);
+        return -1;
+    }
+    pool.nworkers = nthreads;
+    pool.njobs = njobs;
+    pool.fn = fn;
+    pool.ctx = ctx;
+    pool.out = (out != NULL) ? out : stdout;
+    pool.next_out = 0;
+    pthread_mutex_init(&pool.lock, NULL);
+
+    // Contiguous blocks: early reports become printable early.
+    for (i = 0; i < nthreads; i++) {
+        int lo = (int)((long long)njobs * i / nthreads);
+        int hi = (int)((long long)njobs * (i + 1) / nthreads);
+
+        atomic_init(&pool.deques[i].range, RANGE_PACK(lo, hi));
+        workers[i].pool = &pool;
+        workers[i].id = i;
+    }
+
+    // Jobs of a worker that fails to start are stolen by the others.
+    for (i = 1; i < nthreads; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, batch_worker_main,
+                                     &workers[i]) == 0);
+    }
+    batch_worker_main(&workers[0]);
+    for (i = 1; i < nthreads; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    pthread_mutex_destroy(&pool.lock);
+    free(pool.deques);
+    free(pool.reports);
+    free(pool.lens);
+    free(pool.done);
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * -----------------------------------------------------------------------------
+ * batch.h
+ *
+ * Batch mode support: expands command-line inputs (paths, directories,
+ * @filelist) into an ordered file list and runs one job per file on a
+ * work-stealing thread pool.
+ *
+ * Pool: every worker owns a deque holding a contiguous block of job
+ * indices. Owners take jobs from the front; an idle worker steals the back
+ * half of another worker's deque. A deque is one atomic word (lo, hi), so
+ * take and steal are single compare-and-swap operations.
+ *
+ * Job reports are written to the output stream in job order as soon as
+ * every earlier job has finished, so output does not depend on scheduling.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>   // FILE
+#include <stddef.h>  // size_t
+
+// Batch worker threads (compile-time). 0 = one per online CPU.
+#ifndef BATCH_THREADS
+#define BATCH_THREADS 0
+#endif
+
+// Hard limit on batch worker threads.
+#define BATCH_MAX_THREADS 64
+
+// Prefix of an argument naming a file list (one input per line).
+#define BATCH_LIST_PREFIX '@'
+
+// File list comment marker (lines starting with it are skipped).
+#define BATCH_LIST_COMMENT '#'
+
+// Suffix of source files picked up when walking directories.
+#define BATCH_SOURCE_SUFFIX ".c"
+
+// Max nesting of directories and file lists (guards against cycles).
+#define BATCH_MAX_DEPTH 32
+
+// Ordered list of input paths.
+typedef struct {
+    char **paths;  // Owned path strings.
+    int count;     // Number of paths.
+    int capacity;  // Allocated path slots.
+} batch_inputs_t;
+
+// Job callback: runs job on worker (0 <= worker < nthreads) and returns a
+// malloc'd report of *len bytes to print in job order (NULL = nothing).
+typedef char* (*batch_job_fn)(void *ctx, int worker, int job, size_t *len);
+
+// Initializes an empty input list.
+void batch_inputs_init(batch_inputs_t *in);
+
+// Returns 1 when arg expands to several inputs (directory or @filelist).
+int batch_is_collection(const char *arg);
+
+// Appends the inputs named by arg: a directory adds its BATCH_SOURCE_SUFFIX
+// files recursively in name order, "@list" adds every entry of list, and
+// anything else is added as is. Returns 0, or -1 when a directory or list
+// cannot be read.
+int batch_collect(batch_inputs_t *in, const char *arg);
+
+// Frees every path.
+void batch_inputs_free(batch_inputs_t *in);
+
+// Returns worker threads for njobs jobs (requested 0 = online CPUs).
+int batch_thread_count(int requested, int njobs);
+
+// Runs jobs 0..njobs-1 on nthreads workers (the caller is worker 0) and
+// writes their reports to out in job order. Returns 0, or -1 on
+// allocation failure (no job run).
+int batch_run(int njobs, int nthreads, batch_job_fn fn, void *ctx, FILE *out);
+
+#endif /* BATCH_H */
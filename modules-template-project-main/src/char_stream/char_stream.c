@@ -3,7 +3,9 @@
  * char_stream.c
  *
  * Input cursor implementation. Reads file one character at a time,
- * tracking line and column numbers.
+ * tracking line and column numbers. Regular files are memory-mapped so
+ * peek/get are plain pointer reads; pipes and stdin are block-read into
+ * an aligned buffer; stdio is only the portability fallback.
  *
  * Team: Compilers P2
  * -----------------------------------------------------------------------------
@@ -11,35 +13,223 @@
 
 #include "char_stream.h"
 #include <stddef.h>  // NULL
+#include <string.h>  // memmove
+
+#if CS_HAVE_POSIX_IO
+#include <errno.h>     // EINTR
+#include <fcntl.h>     // open
+#include <stdlib.h>    // posix_memalign, free
+#include <sys/stat.h>  // fstat, S_ISREG
+#include <unistd.h>    // read, close, STDIN_FILENO
+#endif
+#if CS_USE_MMAP
+#include <sys/mman.h>  // mmap, munmap, posix_madvise
+#endif
 
 #define CS_FIRST_LINE 1   // Initial line number.
 #define CS_FIRST_COL  1   // Initial column number.
 #define CS_INCREMENT  1   // Per-character line/column increment.
 
+// Resets cursor position and lookahead state.
+static void cs_reset_state(char_stream_t *cs) {
+    cs->mode = CS_MODE_STDIO;
+    cs->fp = NULL;
+    cs->base = NULL;
+    cs->cur = NULL;
+    cs->end = NULL;
+    cs->map_size = 0;
+    cs->owns_map = 0;
+    cs->buf = NULL;
+    cs->fd = -1;
+    cs->owns_fd = 0;
+    cs->at_eof = 0;
+    cs->error = 0;
+    cs->current = 0;
+    cs->line = CS_FIRST_LINE;
+    cs->col = CS_FIRST_COL;
+    cs->has_peek = 0;
+    cs->peek_ch = 0;
+}
+
+// Compares filename with CS_STDIN_NAME.
+int cs_is_stdin_name(const char *filename) {
+    const char *name = CS_STDIN_NAME;
+    int i = 0;
+
+    if (filename == NULL) {
+        return 0;
+    }
+    while (filename[i] != '\0' && filename[i] == name[i]) {
+        i++;
+    }
+    return (filename[i] == '\0' && name[i] == '\0');
+}
+
+#if CS_USE_MMAP
+// Maps a regular file read-only. Returns 0 on success, -1 to fall back.
+static int cs_open_mmap(char_stream_t *cs, int fd, size_t size) {
+    void *map;
+
+    cs->mode = CS_MODE_MMAP;
+    if (size == 0) {
+        // Nothing to map: an empty range reports CS_EOF immediately.
+        return 0;
+    }
+
+    map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        cs->mode = CS_MODE_STDIO;
+        return -1;
+    }
+    posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+
+    cs->map_size = size;
+    cs->owns_map = 1;
+    cs->base = (const unsigned char *)map;
+    cs->cur = cs->base;
+    cs->end = cs->base + size;
+    return 0;
+}
+#endif
+
+#if CS_HAVE_POSIX_IO
+// Tops the buffer up until CS_LOOKAHEAD bytes are ahead of the cursor or
+// input ends. Unread bytes are moved to the buffer front first, so a
+// lookahead window never straddles a refill.
+static void cs_refill(char_stream_t *cs) {
+    size_t keep = (size_t)(cs->end - cs->cur);
+    ssize_t got;
+
+    memmove(cs->buf, cs->cur, keep);
+    cs->cur = cs->buf;
+    cs->end = cs->buf + keep;
+
+    while (!cs->at_eof && (size_t)(cs->end - cs->cur) < CS_LOOKAHEAD) {
+        got = read(cs->fd, (void *)cs->end,
+                   CS_BUF_SIZE - (size_t)(cs->end - cs->buf));
+        if (got > 0) {
+            cs->end += got;
+        } else if (got < 0 && errno == EINTR) {
+            continue;
+        } else {
+            // End of input, or a read error that ends it early.
+            cs->error = (got < 0);
+            cs->at_eof = 1;
+        }
+    }
+}
+
+// Sets up the block-buffered reader on fd. Returns 0 on success.
+static int cs_open_buffered(char_stream_t *cs, int fd, int owns_fd) {
+    void *mem = NULL;
+
+    if (posix_memalign(&mem, CS_BUF_ALIGN, CS_BUF_SIZE) != 0) {
+        return -1;
+    }
+    cs->mode = CS_MODE_BUFFERED;
+    cs->buf = (unsigned char *)mem;
+    cs->fd = fd;
+    cs->owns_fd = owns_fd;
+    cs->cur = cs->buf;
+    cs->end = cs->buf;
+    cs_refill(cs);
+    return 0;
+}
+#endif
+
 // Opens the input file and initializes stream state.
 int cs_open(char_stream_t *cs, const char *filename) {
     if (cs == NULL || filename == NULL) {
         return -1;
     }
 
+    cs_reset_state(cs);
+
+#if CS_HAVE_POSIX_IO
+    if (cs_is_stdin_name(filename)) {
+        return cs_open_buffered(cs, STDIN_FILENO, 0);
+    }
+    {
+        struct stat st;
+        int fd = open(filename, O_RDONLY);
+
+        if (fd < 0) {
+            return -1;
+        }
+#if CS_USE_MMAP
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+            cs_open_mmap(cs, fd, (size_t)st.st_size) == 0) {
+            close(fd);  // The mapping stays valid after the descriptor is closed.
+            return 0;
+        }
+#else
+        (void)st;
+#endif
+        if (cs_open_buffered(cs, fd, 1) != 0) {
+            close(fd);
+            return -1;
+        }
+        return 0;
+    }
+#else
+    if (cs_is_stdin_name(filename)) {
+        cs->fp = stdin;
+        return 0;
+    }
     cs->fp = fopen(filename, "r");
     if (cs->fp == NULL) {
         return -1;
     }
-    cs->current = 0;
-    cs->line = CS_FIRST_LINE;
-    cs->col = CS_FIRST_COL;
-    cs->has_peek = 0;
-    cs->peek_ch = 0;
+    return 0;
+#endif
+}
+
+// Opens a block-buffered stream on an already open descriptor.
+int cs_open_fd(char_stream_t *cs, int fd) {
+    if (cs == NULL || fd < 0) {
+        return -1;
+    }
+
+    cs_reset_state(cs);
+#if CS_HAVE_POSIX_IO
+    return cs_open_buffered(cs, fd, 0);
+#else
+    return -1;
+#endif
+}
+
+// Opens a borrowed view of part of a resident buffer.
+int cs_open_view(char_stream_t *cs, const char *data, size_t len,
+                 size_t begin, size_t end, int first_line, int first_col) {
+    if (cs == NULL || data == NULL || begin > end || end > len) {
+        return -1;
+    }
+
+    cs_reset_state(cs);
+    cs->mode = CS_MODE_MMAP;
+    cs->map_size = len;
+    cs->base = (const unsigned char *)data;
+    cs->cur = cs->base + begin;
+    cs->end = cs->base + end;
+    cs->line = first_line;
+    cs->col = first_col;
     return 0;
 }
 
 // Returns next character without consuming it.
 int cs_peek(char_stream_t *cs) {
-    if (cs == NULL || cs->fp == NULL) {
+    if (cs == NULL) {
         return CS_EOF;
     }
 
+    if (cs->mode != CS_MODE_STDIO) {
+        // MMAP and BUFFERED: the byte ahead is always resident.
+        return (cs->cur < cs->end) ? *cs->cur : CS_EOF;
+    }
+
+    if (cs->fp == NULL) {
+        return CS_EOF;
+    }
     if (cs->has_peek) {
         return cs->peek_ch;
     }
@@ -55,11 +245,24 @@ int cs_peek(char_stream_t *cs) {
 int cs_get(char_stream_t *cs) {
     int ch;
 
-    if (cs == NULL || cs->fp == NULL) {
+    if (cs == NULL) {
         return CS_EOF;
     }
 
-    if (cs->has_peek) {
+    if (cs->mode != CS_MODE_STDIO) {
+        if (cs->cur >= cs->end) {
+            return CS_EOF;
+        }
+        ch = *cs->cur++;
+#if CS_HAVE_POSIX_IO
+        if (cs->mode == CS_MODE_BUFFERED && !cs->at_eof &&
+            (size_t)(cs->end - cs->cur) < CS_LOOKAHEAD) {
+            cs_refill(cs);
+        }
+#endif
+    } else if (cs->fp == NULL) {
+        return CS_EOF;
+    } else if (cs->has_peek) {
         ch = cs->peek_ch;
         cs->has_peek = 0;
     } else {
@@ -97,10 +300,59 @@ int cs_col(const char_stream_t *cs) {
     return cs->col;
 }
 
-// Closes stream file if open.
+// Returns mapped input bytes, or NULL for non-resident streams.
+const char* cs_data(const char_stream_t *cs, size_t *len) {
+    if (cs == NULL || cs->mode != CS_MODE_MMAP || cs->base == NULL) {
+        if (len != NULL) {
+            *len = 0;
+        }
+        return NULL;
+    }
+    if (len != NULL) {
+        *len = cs->map_size;
+    }
+    return (const char *)cs->base;
+}
+
+// Returns offset of the cursor inside the mapped input.
+size_t cs_pos(const char_stream_t *cs) {
+    if (cs == NULL || cs->mode != CS_MODE_MMAP || cs->base == NULL) {
+        return 0;
+    }
+    return (size_t)(cs->cur - cs->base);
+}
+
+// Reports a failed read (BUFFERED flag, stdio error indicator).
+int cs_error(const char_stream_t *cs) {
+    if (cs == NULL) {
+        return 0;
+    }
+    if (cs->mode == CS_MODE_STDIO) {
+        return (cs->fp != NULL && ferror(cs->fp)) ? 1 : 0;
+    }
+    return cs->error;
+}
+
+// Closes stream file, mapping or buffer if open.
 void cs_close(char_stream_t *cs) {
-    if (cs != NULL && cs->fp != NULL) {
+    if (cs == NULL) {
+        return;
+    }
+#if CS_USE_MMAP
+    if (cs->mode == CS_MODE_MMAP && cs->owns_map) {
+        munmap((void *)cs->base, cs->map_size);
+    }
+#endif
+#if CS_HAVE_POSIX_IO
+    if (cs->mode == CS_MODE_BUFFERED) {
+        free(cs->buf);
+        if (cs->owns_fd) {
+            close(cs->fd);
+        }
+    }
+#endif
+    if (cs->fp != NULL && cs->fp != stdin) {
         fclose(cs->fp);
-        cs->fp = NULL;
     }
+    cs_reset_state(cs);
 }
@@ -7,6 +7,15 @@
  * This module only reads characters — it never classifies, skips, or
  * groups them.
  *
+ * Backends:
+ *   - MMAP:     regular files are mapped read-only and exposed as one
+ *               contiguous byte range; peek/get are pointer reads.
+ *   - BUFFERED: pipes, FIFOs, stdin ("-") and anything not mapped are
+ *               read with read() into a large aligned buffer that is
+ *               refilled in place, always keeping CS_LOOKAHEAD bytes
+ *               ahead of the cursor (until EOF).
+ *   - STDIO:    fgetc fallback on platforms without POSIX I/O.
+ *
  * Team: Compilers P2
  * -----------------------------------------------------------------------------
  */
@@ -15,13 +24,53 @@
 #define CHAR_STREAM_H
 
 #include <stdio.h>
+#include <stddef.h>  // size_t
 
 // Sentinel returned at end of file.
 #define CS_EOF (-1)
 
+// Input name that selects standard input.
+#define CS_STDIN_NAME "-"
+
+// Buffered backend sizing: buffer bytes, buffer alignment, lookahead window.
+#define CS_BUF_SIZE   (256 * 1024)
+#define CS_BUF_ALIGN  4096
+#define CS_LOOKAHEAD  64
+
+// POSIX descriptor I/O (open/read) availability for MMAP and BUFFERED.
+#ifdef _WIN32
+#define CS_HAVE_POSIX_IO 0
+#else
+#define CS_HAVE_POSIX_IO 1
+#endif
+
+// mmap backend selection (compile-time). 1 = map regular files,
+// 0 = read regular files through the BUFFERED backend.
+#ifndef CS_USE_MMAP
+#define CS_USE_MMAP CS_HAVE_POSIX_IO
+#endif
+
+// Input backend used by an open stream.
+typedef enum {
+    CS_MODE_STDIO    = 0,  // fgetc-based reading.
+    CS_MODE_MMAP     = 1,  // Whole file mapped in memory.
+    CS_MODE_BUFFERED = 2   // Block reads into a refilled buffer.
+} cs_mode_t;
+
 // Cursor state for input stream.
 typedef struct {
-    FILE *fp;      // Input file handle.
+    cs_mode_t mode;             // Active input backend.
+    FILE *fp;                   // Input file handle (STDIO).
+    const unsigned char *base;  // First mapped byte (MMAP).
+    const unsigned char *cur;   // Next unread byte (MMAP, BUFFERED).
+    const unsigned char *end;   // One past last valid byte (MMAP, BUFFERED).
+    size_t map_size;            // Mapped length in bytes (MMAP).
+    int owns_map;               // 1 when cs_close must unmap base.
+    unsigned char *buf;         // Owned aligned read buffer (BUFFERED).
+    int fd;                     // Read descriptor, -1 when none (BUFFERED).
+    int owns_fd;                // 1 when cs_close must close fd.
+    int at_eof;                 // 1 once read() reported end of input.
+    int error;                  // 1 once read() failed (BUFFERED).
     int current;   // Most recently consumed character.
     int line;      // Current 1-based line number.
     int col;       // Current 1-based column number.
@@ -29,9 +78,22 @@ typedef struct {
     int peek_ch;   // Buffered lookahead character.
 } char_stream_t;
 
-// Opens and initializes stream from filename.
+// Returns 1 when filename selects standard input (CS_STDIN_NAME), else 0.
+int cs_is_stdin_name(const char *filename);
+
+// Opens and initializes stream from filename ("-" reads stdin).
 int cs_open(char_stream_t *cs, const char *filename);
 
+// Opens a buffered stream on an open descriptor (not closed by cs_close).
+int cs_open_fd(char_stream_t *cs, int fd);
+
+// Opens a view over bytes [begin, end) of a resident buffer of len bytes,
+// starting at line first_line, column first_col. The buffer is borrowed. cs_data and
+// cs_pos stay relative to the whole buffer, so span offsets from several
+// views of one buffer are interchangeable.
+int cs_open_view(char_stream_t *cs, const char *data, size_t len,
+                 size_t begin, size_t end, int first_line, int first_col);
+
 // Returns next character without consuming it.
 int cs_peek(char_stream_t *cs);
 
@@ -44,6 +106,17 @@ int cs_line(const char_stream_t *cs);
 // Returns current column.
 int cs_col(const char_stream_t *cs);
 
+// Returns the whole input as one resident byte range (MMAP), or NULL when
+// the stream is not memory-resident. Stores the length in *len if given.
+const char* cs_data(const char_stream_t *cs, size_t *len);
+
+// Returns the byte offset of the next unread character (MMAP), else 0.
+size_t cs_pos(const char_stream_t *cs);
+
+// Returns 1 when reading the input failed, so the characters returned
+// before CS_EOF are only a prefix of it; else 0.
+int cs_error(const char_stream_t *cs);
+
 // Closes input file if open.
 void cs_close(char_stream_t *cs);
 
@@ -0,0 +1,876 @@
+/*
+ * -----------------------------------------------------------------------------
+ * daemon.c
+ *
+ * Scan server: the calling thread polls the listening socket and every idle
+ * connection and reads whatever arrives into the connection's buffer
+ * (client sockets are non-blocking). Only a connection holding a whole
+ * request (its line and any INLINE payload) is queued, and a fixed pool of
+ * workers serves one request of it at a time before handing it back. A
+ * worker therefore never waits for a client: an idle or slow connection
+ * holds no worker. Replies are assembled in memory streams and sent with
+ * one header line.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#include "daemon.h"
+#include <stdio.h>   // FILE, fprintf, snprintf
+#include <stdlib.h>  // malloc, realloc, free, strtol
+#include <string.h>  // strcmp, strchr, strlen, memset
+
+#if DAEMON_SUPPORTED
+
+#include "../automata/automata.h"
+#include "../out_writer/out_writer.h"
+#include "../arena/arena.h"
+#include "../batch/batch.h"  // batch_thread_count
+#include <errno.h>       // errno, EINTR, EAGAIN, ENOENT, ECONNREFUSED
+#include <fcntl.h>       // fcntl, O_NONBLOCK
+#include <poll.h>        // poll
+#include <pthread.h>     // pthread_*
+#include <signal.h>      // signal, SIGPIPE
+#include <sys/socket.h>  // socket, bind, listen, accept, connect
+#include <sys/stat.h>    // lstat, S_ISSOCK
+#include <sys/un.h>      // sockaddr_un
+#include <unistd.h>      // read, write, pipe, close, unlink
+
+// Output filename buffer for SCAN requests: holds any request path plus
+// SCN_SUFFIX, so the name is never truncated (to the input's own name).
+#define DAEMON_NAME_BUF (DAEMON_LINE_MAX + sizeof(SCN_SUFFIX))
+
+// Warm per-worker scan state, kept across requests.
+typedef struct {
+    char_stream_t cs;     // Input of the current request.
+    token_list_t tokens;  // Tokens of the current request.
+    arena_t arena;        // Token/lexeme storage, reset per request.
+    scanner_ctx_t ctx;    // Settings, destinations and counters.
+} daemon_worker_t;
+
+// Memory stream collecting one reply section.
+typedef struct {
+    FILE *fp;     // Write side.
+    char *data;   // Bytes written (valid after fclose).
+    size_t len;   // Byte count.
+} daemon_buf_t;
+
+// One client connection. The poller reads requests into its own buffer,
+// so the connection can move between the poller and any worker between
+// requests.
+typedef struct daemon_conn {
+    int fd;                    // Socket (non-blocking).
+    char *in;                  // Received bytes not consumed yet.
+    size_t in_len;             // Bytes in in.
+    size_t in_cap;             // Allocated in bytes: DAEMON_LINE_MAX, or a
+                               // whole INLINE request while one arrives.
+    struct daemon_conn *next;  // Next in the request queue / return list.
+} daemon_conn_t;
+
+struct daemon_thread;
+
+// Shared server state.
+typedef struct {
+    scanner_config_t cfg;          // Settings of every scan.
+    struct daemon_thread *threads;  // Worker pool.
+    int nthreads;                  // Worker count.
+    pthread_mutex_t lock;          // Guards lists, counts, stopping.
+    pthread_cond_t not_empty;      // A request was queued / stopping.
+    daemon_conn_t *q_head;         // Connections with a request (FIFO).
+    daemon_conn_t *q_tail;         // Last queued connection.
+    daemon_conn_t *returned;       // Served, going back to the poller.
+    int nconns;                    // Open connections.
+    int wake[2];                   // Pipe that wakes the poller.
+    int stopping;                  // 1 after SHUTDOWN.
+} daemon_server_t;
+
+// One pool thread.
+typedef struct daemon_thread {
+    daemon_server_t *srv;   // Owning server.
+    daemon_worker_t state;  // Warm scan state.
+    pthread_t thread;       // Thread handle.
+    int started;            // 1 when thread is running.
+} daemon_thread_t;
+
+// Sends all len bytes (waiting while the socket buffer is full). Returns
+// 0, or -1 once the peer is gone.
+static int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd out = {fd, POLLOUT, 0};
+
+            if (poll(&out, 1, -1) < 0 && errno != EINTR) {
+                return -1;
+            }
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Sends "OK <tokens> <msg_bytes> <out_bytes>" and both sections.
+static int send_ok(int fd, int tokens, const daemon_buf_t *msg,
+                   const daemon_buf_t *out) {
+    char head[96];
+    int n = snprintf(head, sizeof(head), "OK %d %lu %lu\n", tokens,
+                     (unsigned long)msg->len, (unsigned long)out->len);
+
+    if (send_all(fd, head, (size_t)n) != 0 ||
+        send_all(fd, msg->data, msg->len) != 0 ||
+        send_all(fd, out->data, out->len) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Sends "ERR <code> <message>: <context>".
+static int send_err(int fd, int err_id, const char *context) {
+    char line[DAEMON_LINE_MAX + 96];
+    int n = snprintf(line, sizeof(line), "ERR %d %s: %s\n", err_id,
+                     err_get_message(err_id), context);
+
+    if (n < 0 || (size_t)n >= sizeof(line)) {
+        n = (int)sizeof(line) - 1;
+        line[n - 1] = '\n';
+    }
+    return send_all(fd, line, (size_t)n);
+}
+
+// Opens an empty reply section.
+static int buf_open(daemon_buf_t *b) {
+    b->data = NULL;
+    b->len = 0;
+    b->fp = open_memstream(&b->data, &b->len);
+    return (b->fp != NULL) ? 0 : -1;
+}
+
+// Finishes writing a section (data and len become final).
+static void buf_close(daemon_buf_t *b) {
+    if (b->fp != NULL) {
+        fclose(b->fp);
+        b->fp = NULL;
+    }
+}
+
+// Releases a section.
+static void buf_free(daemon_buf_t *b) {
+    buf_close(b);
+    free(b->data);
+    b->data = NULL;
+}
+
+// Splits a request line in place into its keyword (line) and argument
+// (returned; empty when there is none). A trailing '\r' is dropped.
+static char* split_request(char *line) {
+    size_t len = strlen(line);
+    char *arg;
+
+    if (len > 0 && line[len - 1] == '\r') {
+        line[--len] = '\0';
+    }
+    arg = strchr(line, ' ');
+    if (arg != NULL) {
+        *arg++ = '\0';
+    } else {
+        arg = line + len;
+    }
+    return arg;
+}
+
+// Returns the payload length of an INLINE argument, or -1 when it is not
+// a length in [0, DAEMON_INLINE_MAX].
+static long inline_length(const char *arg) {
+    char *end;
+    long len = strtol(arg, &end, 10);
+
+    if (end == arg || *end != '\0' || len < 0 || len > DAEMON_INLINE_MAX) {
+        return -1;
+    }
+    return len;
+}
+
+// Returns the byte count of the first buffered request (its line plus any
+// INLINE payload), or 0 while its line is incomplete. A line too long and
+// a bad INLINE length count as the line alone: the worker answers them.
+static size_t conn_request_size(const daemon_conn_t *c) {
+    char line[DAEMON_LINE_MAX];
+    const char *nl = (const char *)memchr(c->in, '\n', c->in_len);
+    size_t len;
+    char *arg;
+    long payload;
+
+    if (nl == NULL) {
+        return (c->in_len >= DAEMON_LINE_MAX - 1) ? c->in_len : 0;
+    }
+    len = (size_t)(nl - c->in);
+    if (len >= DAEMON_LINE_MAX - 1) {
+        return len + 1;
+    }
+    memcpy(line, c->in, len);
+    line[len] = '\0';
+    arg = split_request(line);
+    if (strcmp(line, DAEMON_CMD_INLINE) != 0 ||
+        (payload = inline_length(arg)) < 0) {
+        return len + 1;
+    }
+    return len + 1 + (size_t)payload;
+}
+
+// Returns 1 when a whole request is buffered.
+static int conn_ready(const daemon_conn_t *c) {
+    size_t size = conn_request_size(c);
+
+    return size > 0 && c->in_len >= size;
+}
+
+// Reads what the socket holds into the connection buffer, growing it to
+// fit a pending INLINE request. Returns 1 while the connection is open
+// (also when nothing was available), 0 at end of stream or on an error.
+static int conn_fill(daemon_conn_t *c) {
+    size_t size = conn_request_size(c);
+
+    if (size > c->in_cap) {
+        char *grown = (char *)realloc(c->in, size);
+
+        if (grown == NULL) {
+            fprintf(stderr, "conn_fill: memory allocation failed\n");
+            return 0;
+        }
+        c->in = grown;
+        c->in_cap = size;
+    }
+    for (;;) {
+        ssize_t n = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 1;
+        }
+        if (n <= 0) {
+            return 0;
+        }
+        c->in_len += (size_t)n;
+        return 1;
+    }
+}
+
+// Drops the first n buffered bytes; a buffer grown for an INLINE payload
+// shrinks back once the rest fits DAEMON_LINE_MAX.
+static void conn_consume(daemon_conn_t *c, size_t n) {
+    memmove(c->in, c->in + n, c->in_len - n);
+    c->in_len -= n;
+    if (c->in_cap > DAEMON_LINE_MAX && c->in_len <= DAEMON_LINE_MAX) {
+        char *shrunk = (char *)realloc(c->in, DAEMON_LINE_MAX);
+
+        if (shrunk != NULL) {
+            c->in = shrunk;
+            c->in_cap = DAEMON_LINE_MAX;
+        }
+    }
+}
+
+// Takes the request line of a ready connection into line (DAEMON_LINE_MAX
+// bytes; the newline is dropped). Returns 0, or -1 for a line of
+// DAEMON_LINE_MAX - 1 bytes or more.
+static int conn_take_line(daemon_conn_t *c, char *line) {
+    char *nl = (char *)memchr(c->in, '\n', c->in_len);
+    size_t len;
+
+    if (nl == NULL) {
+        return -1;
+    }
+    len = (size_t)(nl - c->in);
+    if (len >= DAEMON_LINE_MAX - 1) {
+        return -1;
+    }
+    memcpy(line, c->in, len);
+    line[len] = '\0';
+    conn_consume(c, len + 1);
+    return 0;
+}
+
+// Wakes the poller (the pipe is non-blocking: a full pipe already will).
+static void wake_poller(daemon_server_t *srv) {
+    ssize_t n = write(srv->wake[1], "w", 1);
+
+    (void)n;
+}
+
+// Closes and releases a connection.
+static void conn_close(daemon_server_t *srv, daemon_conn_t *c) {
+    close(c->fd);
+    free(c->in);
+    free(c);
+    pthread_mutex_lock(&srv->lock);
+    srv->nconns--;
+    pthread_mutex_unlock(&srv->lock);
+    // Below DAEMON_MAX_CONNS again: the poller accepts again.
+    wake_poller(srv);
+}
+
+// Appends c to the request queue and wakes a worker (lock held).
+static void queue_push(daemon_server_t *srv, daemon_conn_t *c) {
+    c->next = NULL;
+    if (srv->q_tail != NULL) {
+        srv->q_tail->next = c;
+    } else {
+        srv->q_head = c;
+    }
+    srv->q_tail = c;
+    pthread_cond_signal(&srv->not_empty);
+}
+
+// Scans the worker's open stream; messages go to msg, console lines to out.
+static void scan_stream(daemon_worker_t *w, const scanner_config_t *cfg,
+                        FILE *msg, FILE *out) {
+    const char *source;
+    size_t source_len;
+
+    scanner_ctx_init(&w->ctx, cfg, out);
+    logger_init_dest(&w->ctx.lg, msg);
+    arena_reset(&w->arena);
+    tl_init_arena(&w->tokens, &w->arena);
+    source = cs_data(&w->cs, &source_len);
+    tl_set_source(&w->tokens, source, source_len);
+    automata_scan_ctx(&w->cs, &w->tokens, &w->ctx);
+}
+
+// TOKENS / INLINE: replies with messages and the token stream of the
+// worker's open stream (input name for errors).
+static int serve_tokens(daemon_server_t *srv, daemon_worker_t *w, int fd,
+                        const char *name) {
+    daemon_buf_t msg;
+    daemon_buf_t out;
+    int status = -1;
+
+    if (buf_open(&msg) != 0 || buf_open(&out) != 0) {
+        if (msg.fp != NULL) {
+            buf_free(&msg);
+        }
+        cs_close(&w->cs);
+        return send_err(fd, ERR_INTERNAL, "reply buffer");
+    }
+    scan_stream(w, &srv->cfg, msg.fp, out.fp);
+    // A failed read leaves only a prefix of the tokens.
+    if (cs_error(&w->cs)) {
+        status = send_err(fd, ERR_FILE_READ, name);
+    } else {
+        ow_write_token_stream_ctx(&w->tokens, out.fp, &w->ctx);
+        buf_close(&msg);
+        buf_close(&out);
+        status = send_ok(fd, tl_count(&w->tokens), &msg, &out);
+    }
+
+    tl_free(&w->tokens);
+    cs_close(&w->cs);
+    buf_free(&msg);
+    buf_free(&out);
+    return status;
+}
+
+// SCAN: writes <path>scn like the command-line driver and replies with
+// the messages and console report.
+static int serve_scan(daemon_server_t *srv, daemon_worker_t *w, int fd,
+                      const char *path) {
+    char output_filename[DAEMON_NAME_BUF];
+    daemon_buf_t msg;
+    daemon_buf_t out;
+    ow_session_t session;
+    int in_session = 0;
+    int read_failed;
+    int write_status;
+    int status;
+
+    if (strlen(path) + strlen(SCN_SUFFIX) >= sizeof(output_filename)) {
+        return send_err(fd, ERR_FILE_OUTPUT, path);
+    }
+    if (cs_is_stdin_name(path) || cs_open(&w->cs, path) != 0) {
+        return send_err(fd, ERR_FILE_OPEN, path);
+    }
+    ow_build_output_filename(path, output_filename,
+                             (int)sizeof(output_filename));
+    if (srv->cfg.debug == DEBUG_ON) {
+        // Messages share the output session, as with scanner_main.
+        if (ow_session_open(&session, output_filename) != 0) {
+            cs_close(&w->cs);
+            return send_err(fd, ERR_FILE_OUTPUT, output_filename);
+        }
+        in_session = 1;
+    }
+    if (buf_open(&msg) != 0 || buf_open(&out) != 0) {
+        if (msg.fp != NULL) {
+            buf_free(&msg);
+        }
+        if (in_session) {
+            ow_session_close(&session);
+        }
+        cs_close(&w->cs);
+        return send_err(fd, ERR_INTERNAL, "reply buffer");
+    }
+
+    fprintf(out.fp, "Scanning: %s\n", path);
+    scan_stream(w, &srv->cfg,
+                in_session ? ow_session_file(&session) : msg.fp, out.fp);
+    // A failed read leaves only a prefix of the tokens: nothing is written,
+    // and a session file already holding messages is removed.
+    read_failed = cs_error(&w->cs);
+    write_status = 0;
+    if (in_session) {
+        if (!read_failed) {
+            write_status = ow_session_write_tokens(&session, &w->tokens,
+                                                   &w->ctx);
+        }
+        if (ow_session_close(&session) != 0) {
+            write_status = -1;
+        }
+        if (read_failed) {
+            remove(output_filename);
+        }
+    } else if (!read_failed) {
+        write_status = ow_write_token_file_ctx(&w->tokens, output_filename,
+                                               &w->ctx);
+    }
+    if (read_failed) {
+        status = send_err(fd, ERR_FILE_READ, path);
+    } else if (write_status != 0) {
+        status = send_err(fd, ERR_FILE_OUTPUT, output_filename);
+    } else {
+        fprintf(out.fp, "Output written to: %s\n", output_filename);
+        fprintf(out.fp, "Tokens found: %d\n", tl_count(&w->tokens));
+#ifdef COUNTCONFIG
+        if (w->ctx.cfg.count) {
+            counter_print(&w->ctx.cnt, out.fp, "daemon_scan", 0);
+        }
+#endif
+        buf_close(&msg);
+        buf_close(&out);
+        status = send_ok(fd, tl_count(&w->tokens), &msg, &out);
+    }
+
+    tl_free(&w->tokens);
+    cs_close(&w->cs);
+    buf_free(&msg);
+    buf_free(&out);
+    return status;
+}
+
+// INLINE: scans the len payload bytes buffered after the request line.
+static int serve_inline(daemon_server_t *srv, daemon_worker_t *w,
+                        daemon_conn_t *c, const char *arg) {
+    long len = inline_length(arg);
+    int status;
+
+    if (len < 0) {
+        send_err(c->fd, ERR_INTERNAL, "bad INLINE length");
+        return -1;  // The payload cannot be skipped reliably.
+    }
+    if (cs_open_view(&w->cs, c->in, (size_t)len, 0, (size_t)len, 1,
+                     1) != 0) {
+        conn_consume(c, (size_t)len);
+        return send_err(c->fd, ERR_INTERNAL, "inline view");
+    }
+    status = serve_tokens(srv, w, c->fd, DAEMON_CMD_INLINE);
+    conn_consume(c, (size_t)len);
+    return status;
+}
+
+// Fills addr with socket_path. Returns -1 when the path does not fit
+// sun_path (it would be truncated to a different path).
+static int socket_address(struct sockaddr_un *addr, const char *socket_path) {
+    size_t len = strlen(socket_path);
+
+    if (len >= sizeof(addr->sun_path)) {
+        return -1;
+    }
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, socket_path, len + 1);
+    return 0;
+}
+
+// Marks the server stopping and wakes the workers and the poller. Requests
+// being served finish; queued ones are dropped.
+static void daemon_stop(daemon_server_t *srv) {
+    pthread_mutex_lock(&srv->lock);
+    srv->stopping = 1;
+    pthread_cond_broadcast(&srv->not_empty);
+    pthread_mutex_unlock(&srv->lock);
+    wake_poller(srv);
+}
+
+// Serves the buffered request of c. Returns 1 when the connection stays
+// open for further requests, 0 after QUIT, SHUTDOWN, a bad request or a
+// failed reply.
+static int serve_request(daemon_server_t *srv, daemon_thread_t *t,
+                         daemon_conn_t *c) {
+    char line[DAEMON_LINE_MAX];
+    char *arg;
+    int status;
+
+    if (conn_take_line(c, line) != 0) {
+        send_err(c->fd, ERR_INTERNAL, "request line too long");
+        return 0;
+    }
+    arg = split_request(line);
+
+    if (strcmp(line, DAEMON_CMD_QUIT) == 0) {
+        return 0;
+    } else if (strcmp(line, DAEMON_CMD_SHUTDOWN) == 0) {
+        send_all(c->fd, "OK 0 0 0\n", strlen("OK 0 0 0\n"));
+        daemon_stop(srv);
+        return 0;
+    } else if (strcmp(line, DAEMON_CMD_SCAN) == 0) {
+        status = serve_scan(srv, &t->state, c->fd, arg);
+    } else if (strcmp(line, DAEMON_CMD_TOKENS) == 0) {
+        if (cs_is_stdin_name(arg) ||
+            cs_open(&t->state.cs, arg) != 0) {
+            status = send_err(c->fd, ERR_FILE_OPEN, arg);
+        } else {
+            status = serve_tokens(srv, &t->state, c->fd, arg);
+        }
+    } else if (strcmp(line, DAEMON_CMD_INLINE) == 0) {
+        status = serve_inline(srv, &t->state, c, arg);
+    } else {
+        status = send_err(c->fd, ERR_INTERNAL, "unknown request");
+    }
+    return (status == 0) ? 1 : 0;
+}
+
+// Pool thread: serves one queued request at a time until the server stops.
+// Afterwards a connection with another whole request buffered is queued
+// again, any other open one goes back to the poller to read more.
+static void* daemon_worker_main(void *arg) {
+    daemon_thread_t *t = (daemon_thread_t *)arg;
+    daemon_server_t *srv = t->srv;
+
+    for (;;) {
+        daemon_conn_t *c;
+        int serve;
+        int keep;
+
+        pthread_mutex_lock(&srv->lock);
+        while (srv->q_head == NULL && !srv->stopping) {
+            pthread_cond_wait(&srv->not_empty, &srv->lock);
+        }
+        c = srv->q_head;
+        if (c == NULL) {
+            pthread_mutex_unlock(&srv->lock);
+            break;
+        }
+        srv->q_head = c->next;
+        if (srv->q_head == NULL) {
+            srv->q_tail = NULL;
+        }
+        // Connections still queued at shutdown are closed unanswered.
+        serve = !srv->stopping;
+        pthread_mutex_unlock(&srv->lock);
+
+        keep = serve && serve_request(srv, t, c);
+
+        pthread_mutex_lock(&srv->lock);
+        if (keep && !srv->stopping) {
+            if (conn_ready(c)) {
+                queue_push(srv, c);
+            } else {
+                c->next = srv->returned;
+                srv->returned = c;
+                wake_poller(srv);
+            }
+            c = NULL;
+        }
+        pthread_mutex_unlock(&srv->lock);
+        if (c != NULL) {
+            conn_close(srv, c);
+        }
+    }
+    return NULL;
+}
+
+// Makes socket_path free for bind. Only the socket of an earlier server
+// that is gone (connect is refused) is removed; any other file, or the
+// socket of a running server, is left alone. Returns 0 when the path is
+// free.
+static int clear_stale_socket(const struct sockaddr_un *addr) {
+    struct stat st;
+    int fd;
+    int refused;
+
+    if (lstat(addr->sun_path, &st) != 0) {
+        return (errno == ENOENT) ? 0 : -1;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        fprintf(stderr, "daemon_serve: %s exists and is not a socket\n",
+                addr->sun_path);
+        return -1;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    refused = (connect(fd, (const struct sockaddr *)addr,
+                       sizeof(*addr)) != 0 && errno == ECONNREFUSED);
+    close(fd);
+    if (!refused) {
+        fprintf(stderr, "daemon_serve: %s is in use\n", addr->sun_path);
+        return -1;
+    }
+    return unlink(addr->sun_path);
+}
+
+// Creates, binds and listens on the socket. Returns the fd or -1.
+static int open_listener(const char *socket_path) {
+    struct sockaddr_un addr;
+    int fd;
+
+    if (socket_address(&addr, socket_path) != 0) {
+        fprintf(stderr, "daemon_serve: socket path too long: %s\n",
+                socket_path);
+        return -1;
+    }
+    if (clear_stale_socket(&addr) != 0) {
+        return -1;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, DAEMON_BACKLOG) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Empties the wake pipe.
+static void drain_wake(int fd) {
+    char sink[64];
+
+    while (read(fd, sink, sizeof(sink)) > 0) {
+    }
+}
+
+// Accepts one connection into the idle set. Returns -1 when accept failed
+// for good.
+static int accept_conn(daemon_server_t *srv, int listen_fd,
+                       daemon_conn_t **idle, int *n_idle) {
+    daemon_conn_t *c;
+    int fd = accept(listen_fd, NULL, NULL);
+
+    if (fd < 0) {
+        return (errno == EINTR || errno == ECONNABORTED) ? 0 : -1;
+    }
+    c = (daemon_conn_t *)malloc(sizeof(daemon_conn_t));
+    if (c != NULL) {
+        c->in = (char *)malloc(DAEMON_LINE_MAX);
+    }
+    if (c == NULL || c->in == NULL) {
+        fprintf(stderr, "daemon_serve: memory allocation failed\n");
+        free(c);
+        close(fd);
+        return 0;
+    }
+    // The poller reads whatever has arrived and never waits for the rest.
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    c->fd = fd;
+    c->in_len = 0;
+    c->in_cap = DAEMON_LINE_MAX;
+    c->next = NULL;
+    idle[(*n_idle)++] = c;
+    pthread_mutex_lock(&srv->lock);
+    srv->nconns++;
+    pthread_mutex_unlock(&srv->lock);
+    return 0;
+}
+
+// Poll loop: accepts connections (up to DAEMON_MAX_CONNS), reads input of
+// idle connections and queues those holding a whole request, until the
+// server stops or polling fails.
+static void poll_connections(daemon_server_t *srv, int listen_fd,
+                             daemon_conn_t **idle, int *n_idle) {
+    struct pollfd pfd[DAEMON_MAX_CONNS + 2];
+
+    for (;;) {
+        int stopping;
+        int full;
+        int kept = 0;
+        int i;
+
+        pthread_mutex_lock(&srv->lock);
+        while (srv->returned != NULL) {
+            idle[(*n_idle)++] = srv->returned;
+            srv->returned = srv->returned->next;
+        }
+        stopping = srv->stopping;
+        full = (srv->nconns >= DAEMON_MAX_CONNS);
+        pthread_mutex_unlock(&srv->lock);
+        if (stopping) {
+            return;
+        }
+
+        // Further connects wait in the listen backlog while full.
+        pfd[0].fd = srv->wake[0];
+        pfd[0].events = POLLIN;
+        pfd[1].fd = full ? -1 : listen_fd;
+        pfd[1].events = POLLIN;
+        for (i = 0; i < *n_idle; i++) {
+            pfd[i + 2].fd = idle[i]->fd;
+            pfd[i + 2].events = POLLIN;
+        }
+        if (poll(pfd, (nfds_t)(*n_idle + 2), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (pfd[0].revents != 0) {
+            drain_wake(srv->wake[0]);
+        }
+
+        // A partial request stays idle until the rest arrives; a peer
+        // hanging up mid-request is closed here.
+        for (i = 0; i < *n_idle; i++) {
+            daemon_conn_t *c = idle[i];
+
+            if (pfd[i + 2].revents == 0) {
+                idle[kept++] = c;
+            } else if (!conn_fill(c)) {
+                conn_close(srv, c);
+            } else if (conn_ready(c)) {
+                pthread_mutex_lock(&srv->lock);
+                queue_push(srv, c);
+                pthread_mutex_unlock(&srv->lock);
+            } else {
+                idle[kept++] = c;
+            }
+        }
+        *n_idle = kept;
+
+        if (pfd[1].revents != 0 &&
+            accept_conn(srv, listen_fd, idle, n_idle) != 0) {
+            return;
+        }
+    }
+}
+
+// Runs the server until SHUTDOWN.
+int daemon_serve(const char *socket_path, const scanner_config_t *cfg) {
+    daemon_server_t srv;
+    daemon_conn_t *idle[DAEMON_MAX_CONNS];
+    int n_idle = 0;
+    int listen_fd;
+    int i;
+
+    if (socket_path == NULL) {
+        return -1;
+    }
+    // A client hanging up mid-reply must not kill the server.
+    signal(SIGPIPE, SIG_IGN);
+    listen_fd = open_listener(socket_path);
+    if (listen_fd < 0) {
+        return -1;
+    }
+    if (pipe(srv.wake) != 0) {
+        close(listen_fd);
+        unlink(socket_path);
+        return -1;
+    }
+    fcntl(srv.wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(srv.wake[1], F_SETFL, O_NONBLOCK);
+
+    if (cfg != NULL) {
+        srv.cfg = *cfg;
+    } else {
+        scanner_config_default(&srv.cfg);
+    }
+    // Requests are the unit of parallelism: one thread per scan.
+    srv.cfg.threads = 1;
+    srv.cfg.pipeline = 0;
+    srv.nthreads = batch_thread_count(DAEMON_THREADS, BATCH_MAX_THREADS);
+    srv.threads = (daemon_thread_t *)calloc((size_t)srv.nthreads,
+                                            sizeof(daemon_thread_t));
+    if (srv.threads == NULL) {
+        fprintf(stderr, "daemon_serve: memory allocation failed\n");
+        close(srv.wake[0]);
+        close(srv.wake[1]);
+        close(listen_fd);
+        unlink(socket_path);
+        return -1;
+    }
+    srv.q_head = NULL;
+    srv.q_tail = NULL;
+    srv.returned = NULL;
+    srv.nconns = 0;
+    srv.stopping = 0;
+    pthread_mutex_init(&srv.lock, NULL);
+    pthread_cond_init(&srv.not_empty, NULL);
+    automata_init_tables();
+
+    for (i = 0; i < srv.nthreads; i++) {
+        daemon_thread_t *t = &srv.threads[i];
+
+        t->srv = &srv;
+        arena_init(&t->state.arena, 0);
+        t->started = (pthread_create(&t->thread, NULL, daemon_worker_main,
+                                     t) == 0);
+    }
+
+    fprintf(stdout, "Listening on: %s\n", socket_path);
+    fflush(stdout);
+
+    poll_connections(&srv, listen_fd, idle, &n_idle);
+
+    // Stop the pool (also when polling failed on its own); connections
+    // the workers handed back are closed with the idle ones.
+    daemon_stop(&srv);
+    pthread_mutex_lock(&srv.lock);
+    while (srv.returned != NULL) {
+        idle[n_idle++] = srv.returned;
+        srv.returned = srv.returned->next;
+    }
+    pthread_mutex_unlock(&srv.lock);
+    for (i = 0; i < n_idle; i++) {
+        conn_close(&srv, idle[i]);
+    }
+
+    close(listen_fd);
+    unlink(socket_path);
+    for (i = 0; i < srv.nthreads; i++) {
+        daemon_thread_t *t = &srv.threads[i];
+
+        if (t->started) {
+            pthread_join(t->thread, NULL);
+        }
+        arena_free(&t->state.arena);
+    }
+    close(srv.wake[0]);
+    close(srv.wake[1]);
+    pthread_cond_destroy(&srv.not_empty);
+    pthread_mutex_destroy(&srv.lock);
+    free(srv.threads);
+    return 0;
+}
+
+#else
+
+// Unix domain sockets are unavailable on this platform.
+int daemon_serve(const char *socket_path, const scanner_config_t *cfg) {
+    (void)socket_path;
+    (void)cfg;
+    fprintf(stderr, "daemon mode needs Unix domain sockets\n");
+    return -1;
+}
+
+#endif /* DAEMON_SUPPORTED */
@@ -0,0 +1,74 @@
+/*
+ * -----------------------------------------------------------------------------
+ * daemon.h
+ *
+ * Persistent scan server. Listens on a local Unix domain socket and serves
+ * requests on a fixed pool of worker threads, one request at a time: a
+ * request reaches a worker only once all of it (line and INLINE payload)
+ * has arrived, so a client that keeps its connection open or sends slowly
+ * never delays another. Every worker keeps its arena and token list warm
+ * between requests, and the DFA tables are built once per process.
+ *
+ * Protocol (one request per line, any number per connection):
+ *   SCAN <path>        scan path and write <path>scn as scanner_main does
+ *   TOKENS <path>      scan path and return its token stream
+ *   INLINE <len>       followed by len source bytes; return their tokens
+ *   QUIT               close this connection
+ *   SHUTDOWN           stop the server
+ *
+ * Replies:
+ *   OK <tokens> <msg_bytes> <out_bytes>\n  then msg_bytes of scanner
+ *       messages and out_bytes of output (.cscn text for TOKENS/INLINE,
+ *       console report for SCAN)
+ *   ERR <code> <message>\n                 code from error_mod
+ *
+ * Paths are resolved against the server's working directory.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "../scan_ctx/scan_ctx.h"
+
+// Command-line switch that starts the server: scanner_main --serve <socket>.
+#define DAEMON_OPTION "--serve"
+
+// Unix domain sockets are not available on the Windows (UCRT64) build.
+#ifdef _WIN32
+#define DAEMON_SUPPORTED 0
+#else
+#define DAEMON_SUPPORTED 1
+#endif
+
+// Server worker threads (compile-time). 0 = one per online CPU.
+#ifndef DAEMON_THREADS
+#define DAEMON_THREADS 0
+#endif
+
+// Open connections (idle ones cost a poll slot, not a worker), and
+// pending connects beyond them.
+#define DAEMON_MAX_CONNS 256
+#define DAEMON_BACKLOG   64
+
+// Longest request line and largest INLINE payload.
+#define DAEMON_LINE_MAX   4096
+#define DAEMON_INLINE_MAX (64L * 1024 * 1024)
+
+// Request keywords.
+#define DAEMON_CMD_SCAN     "SCAN"
+#define DAEMON_CMD_TOKENS   "TOKENS"
+#define DAEMON_CMD_INLINE   "INLINE"
+#define DAEMON_CMD_QUIT     "QUIT"
+#define DAEMON_CMD_SHUTDOWN "SHUTDOWN"
+
+// Serves requests on socket_path with settings cfg (NULL = defaults) until
+// a SHUTDOWN request. Returns 0, or -1 when the socket cannot be set up
+// (path longer than sun_path, an existing file that is not a socket, or
+// the socket of a server that still accepts connections) or the platform
+// has no Unix domain sockets. Only a stale socket is replaced.
+int daemon_serve(const char *socket_path, const scanner_config_t *cfg);
+
+#endif /* DAEMON_H */
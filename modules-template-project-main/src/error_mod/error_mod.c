@@ -18,6 +18,7 @@ const char* err_get_message(int err_id) {
         case ERR_UNTERMINATED_LIT: return ERR_MSG_UNTERMINATED_LIT;
         case ERR_NONRECOGNIZED:    return ERR_MSG_NONRECOGNIZED;
         case ERR_INTERNAL:         return ERR_MSG_INTERNAL;
+        case ERR_FILE_READ:        return ERR_MSG_FILE_READ;
         default:                   return ERR_MSG_INTERNAL;
     }
 }
@@ -33,10 +34,15 @@ void err_report(FILE *dest, int err_id, const char *step, int line,
         step = ERR_STEP_SCANNER;
     }
     if (context != NULL) {
-        fprintf(dest, "[ERROR %d][%s] Line %d: %s: %s\n",
-                err_id, step, line, msg, context);
+        fprintf(dest, ERR_FMT_CONTEXT, err_id, step, line, msg, context);
     } else {
-        fprintf(dest, "[ERROR %d][%s] Line %d: %s\n",
-                err_id, step, line, msg);
+        fprintf(dest, ERR_FMT, err_id, step, line, msg);
     }
 }
+
+// Prints one formatted error message through a scan context.
+void err_report_ctx(const scanner_ctx_t *ctx, int err_id, const char *step,
+                    int line, const char *context) {
+    err_report((ctx != NULL) ? logger_get_dest(&ctx->lg) : stdout, err_id,
+               step, line, context);
+}
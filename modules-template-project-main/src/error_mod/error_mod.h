@@ -15,6 +15,7 @@
 #define ERROR_MOD_H
 
 #include <stdio.h>
+#include "../scan_ctx/scan_ctx.h"
 
 // Step/phase identifiers.
 #define ERR_STEP_SCANNER  "SCANNER"
@@ -28,6 +29,8 @@
 #define ERR_UNTERMINATED_LIT   3    // unterminated literal
 #define ERR_NONRECOGNIZED      4    // non-recognized character(s)
 #define ERR_INTERNAL           5    // internal / unexpected error
+#define ERR_FILE_READ          6    // input read failed (input truncated)
+#define ERR_ID_COUNT           7    // number of error IDs
 
 // Error message templates.
 #define ERR_MSG_FILE_OPEN        "Cannot open input file"
@@ -35,11 +38,20 @@
 #define ERR_MSG_UNTERMINATED_LIT "Unterminated literal"
 #define ERR_MSG_NONRECOGNIZED    "Non-recognized character(s)"
 #define ERR_MSG_INTERNAL         "Internal error"
+#define ERR_MSG_FILE_READ        "Cannot read input file"
+
+// Report line formats: id, step, line, message [, context].
+#define ERR_FMT_CONTEXT "[ERROR %d][%s] Line %d: %s: %s\n"
+#define ERR_FMT         "[ERROR %d][%s] Line %d: %s\n"
 
 // Formats and writes one error message.
 void err_report(FILE *dest, int err_id, const char *step, int line,
                 const char *context);
 
+// Same as err_report, written to the message destination of ctx.
+void err_report_ctx(const scanner_ctx_t *ctx, int err_id, const char *step,
+                    int line, const char *context);
+
 // Returns the template message for an error ID.
 const char* err_get_message(int err_id);
 
@@ -0,0 +1,135 @@
+/*
+ * -----------------------------------------------------------------------------
+ * incremental.c
+ *
+ * Incremental rescan implementation: locates the damaged lines, rescans
+ * them through a char_stream view of the new source and splices the result
+ * into the token list.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#include "incremental.h"
+#include "../automata/automata.h"
+#include "../char_stream/char_stream.h"
+
+#include <string.h>  // memchr
+
+// Counts newlines in the n bytes at p.
+static int count_newlines(const char *p, size_t n) {
+    const char *end = p + n;
+    const char *nl;
+    int lines = 0;
+
+    while (p < end && (nl = memchr(p, WS_NL, (size_t)(end - p))) != NULL) {
+        lines++;
+        p = nl + 1;
+    }
+    return lines;
+}
+
+// Returns the index of the first token at or after source offset (tokens
+// are in source order).
+static int first_token_at(const token_list_t *tokens, size_t offset) {
+    int lo = 0;
+    int hi = tl_count(tokens);
+
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+
+        if (tl_get(tokens, mid)->lexeme < offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Rescans the lines touched by edit and splices them into tokens.
+int inc_rescan(token_list_t *tokens, const char *source, size_t len,
+               const inc_edit_t *edit, scanner_ctx_t *ctx,
+               inc_result_t *res) {
+    const char *old;
+    const char *nl;
+    size_t old_len;
+    size_t start;
+    size_t end;
+    size_t old_end;
+    int64_t offset_delta;
+    token_list_t fresh;
+    char_stream_t cs;
+    int first;
+    int last;
+    int line;
+    int line_delta;
+
+    if (tokens == NULL || source == NULL || edit == NULL || ctx == NULL) {
+        return -1;
+    }
+    old = tl_source(tokens);
+    old_len = tokens->source_len;
+    if (old == NULL || len > (size_t)TOKEN_HANDLE_MAX ||
+        edit->offset > old_len || edit->removed > old_len - edit->offset ||
+        edit->offset > len || edit->inserted > len - edit->offset ||
+        old_len - edit->removed != len - edit->inserted) {
+        return -1;
+    }
+
+    // Damaged lines: from the start of the line holding the edit to the
+    // first newline after it. Bytes before offset are the same in both
+    // sources; bytes after the edit are shifted by offset_delta.
+    start = edit->offset;
+    while (start > 0 && source[start - 1] != WS_NL) {
+        start--;
+    }
+    end = edit->offset + edit->inserted;
+    nl = (const char *)memchr(source + end, WS_NL, len - end);
+    end = (nl != NULL) ? (size_t)(nl - source) : len;
+    old_end = end - edit->inserted + edit->removed;
+    offset_delta = (int64_t)edit->inserted - (int64_t)edit->removed;
+
+    first = first_token_at(tokens, start);
+    last = first_token_at(tokens, old_end);
+
+    // Line of start: counted from the closest earlier token, or from the
+    // top of the file.
+    if (first > 0) {
+        const token_t *prev = tl_get(tokens, first - 1);
+
+        line = token_line(prev) +
+               count_newlines(source + prev->lexeme, start - prev->lexeme);
+    } else {
+        line = 1 + count_newlines(source, start);
+    }
+    line_delta = count_newlines(source + edit->offset, edit->inserted) -
+                 count_newlines(old + edit->offset, edit->removed);
+
+    tl_init(&fresh);
+    tl_set_source(&fresh, source, len);
+    if (cs_open_view(&cs, source, len, start, end, line, 1) != 0) {
+        return -1;
+    }
+    automata_scan_engine(&cs, &fresh, &ctx->lg, scanner_ctx_counter(ctx),
+                         ctx->cfg.engine);
+    cs_close(&cs);
+
+    tl_shift(tokens, last, offset_delta, line_delta);
+    if (tl_splice(tokens, first, last - first, &fresh) != 0) {
+        tl_shift(tokens, last, -offset_delta, -line_delta);
+        tl_free(&fresh);
+        return -1;
+    }
+    tl_set_source(tokens, source, len);
+
+    if (res != NULL) {
+        res->first = first;
+        res->removed = last - first;
+        res->added = tl_count(&fresh);
+        res->first_line = line;
+        res->line_delta = line_delta;
+    }
+    tl_free(&fresh);
+    return 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * -----------------------------------------------------------------------------
+ * incremental.h
+ *
+ * Incremental rescanning for editors: applies one text edit to a token
+ * list that was scanned from a resident source, instead of rescanning the
+ * whole file.
+ *
+ * No token of this language spans a newline, and the DFA is back in its
+ * start state after every newline. An edit can therefore only change the
+ * tokens of the lines it touches: those lines are rescanned from the new
+ * source and spliced in place of their old tokens (tl_splice). Tokens after
+ * them keep their category, column and length; only their source offsets
+ * and line numbers are shifted. The DFA runs over O(edit) bytes; the rest
+ * is a linear update of the later tokens.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "../token_list/token_list.h"
+#include "../scan_ctx/scan_ctx.h"
+
+#include <stddef.h>  // size_t
+
+// One edit: old source bytes [offset, offset + removed) were replaced by
+// the new source bytes [offset, offset + inserted).
+typedef struct {
+    size_t offset;    // First changed byte (same in old and new source).
+    size_t removed;   // Bytes removed from the old source.
+    size_t inserted;  // Bytes inserted in the new source.
+} inc_edit_t;
+
+// What an incremental rescan changed in the token list.
+typedef struct {
+    int first;       // Index of the first replaced token.
+    int removed;     // Old tokens replaced.
+    int added;       // New tokens spliced in.
+    int first_line;  // First rescanned line (1-based).
+    int line_delta;  // Line count change (negative when lines were removed).
+} inc_result_t;
+
+// Applies edit to tokens. tokens must hold span tokens of the old source
+// (tl_set_source), which must still be readable; source/len is the whole
+// new source, which tokens is attached to afterwards. Messages, engine and
+// counters come from ctx; messages cover the rescanned lines only. res may
+// be NULL. Returns 0, or -1 (tokens unchanged) on an invalid edit or a
+// list without its source.
+int inc_rescan(token_list_t *tokens, const char *source, size_t len,
+               const inc_edit_t *edit, scanner_ctx_t *ctx,
+               inc_result_t *res);
+
+#endif /* INCREMENTAL_H */
@@ -0,0 +1,130 @@
+/*
+ * -----------------------------------------------------------------------------
+ * kw_hash_gen.c
+ *
+ * Build-time generator for the keyword perfect hash. Reads LS_KEYWORD_LIST
+ * from lang_spec.h, searches hash multipliers and the smallest power-of-two
+ * table with no collisions, and writes ls_kw_hash.h (table + parameters).
+ * Rebuilt and rerun whenever lang_spec.h changes.
+ *
+ * Usage: kw_hash_gen <output-header>
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#include "lang_spec.h"
+#include <stdio.h>
+#include <string.h>
+
+#define GEN_LIST_ITEM(arg, kw) kw,
+#define GEN_MAX_MULT  256   // Multipliers tried per table size: [1, GEN_MAX_MULT).
+#define GEN_MAX_SCALE 8     // Largest table size, as a multiple of NUM_KEYWORDS.
+
+// Keyword table from the lang_spec list.
+static const char *keywords[] = {
+    LS_KEYWORD_LIST(GEN_LIST_ITEM, _)
+};
+
+#define GEN_NUM_KEYWORDS ((int)(sizeof(keywords) / sizeof(keywords[0])))
+
+// Returns keyword hash slot for the given parameters.
+static unsigned gen_hash(const char *kw, unsigned a, unsigned b, unsigned mask) {
+    size_t len = strlen(kw);
+    return LS_KW_HASH((unsigned char)kw[0], (unsigned char)kw[len - 1],
+                      len, a, b, mask);
+}
+
+// Returns 1 when (a, b, size) maps every keyword to a distinct slot.
+static int gen_try(unsigned a, unsigned b, unsigned size, int *slots) {
+    int k;
+
+    for (k = 0; k < (int)size; k++) {
+        slots[k] = -1;
+    }
+    for (k = 0; k < GEN_NUM_KEYWORDS; k++) {
+        unsigned h = gen_hash(keywords[k], a, b, size - 1);
+        if (slots[h] >= 0) {
+            return 0;
+        }
+        slots[h] = k;
+    }
+    return 1;
+}
+
+// Writes the generated header.
+static int gen_write(const char *path, unsigned a, unsigned b, unsigned size,
+                     const int *slots) {
+    FILE *out = fopen(path, "w");
+    size_t max_len = 0;
+    int k;
+
+    if (out == NULL) {
+        fprintf(stderr, "kw_hash_gen: cannot open %s\n", path);
+        return 1;
+    }
+    for (k = 0; k < GEN_NUM_KEYWORDS; k++) {
+        if (strlen(keywords[k]) > max_len) {
+            max_len = strlen(keywords[k]);
+        }
+    }
+
+    fprintf(out, "/* Generated by kw_hash_gen from lang_spec.h. Do not edit. */\n\n");
+    fprintf(out, "#ifndef LS_KW_HASH_H\n#define LS_KW_HASH_H\n\n");
+    fprintf(out, "#define LS_KW_HASH_A    %uu\n", a);
+    fprintf(out, "#define LS_KW_HASH_B    %uu\n", b);
+    fprintf(out, "#define LS_KW_HASH_SIZE %u\n", size);
+    fprintf(out, "#define LS_KW_HASH_MASK (LS_KW_HASH_SIZE - 1u)\n");
+    fprintf(out, "#define LS_KW_MAX_LEN   %u\n", (unsigned)max_len);
+    fprintf(out, "#define LS_KW_COUNT     %d\n\n", GEN_NUM_KEYWORDS);
+
+    fprintf(out, "// Keyword per slot (\"\" when empty).\n");
+    fprintf(out, "static const char *const ls_kw_table[LS_KW_HASH_SIZE] = {\n");
+    for (k = 0; k < (int)size; k++) {
+        fprintf(out, "    \"%s\",\n", (slots[k] >= 0) ? keywords[slots[k]] : "");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "// Keyword length per slot (0 when empty).\n");
+    fprintf(out, "static const unsigned char ls_kw_len[LS_KW_HASH_SIZE] = {\n");
+    for (k = 0; k < (int)size; k++) {
+        fprintf(out, "    %u,\n",
+                (slots[k] >= 0) ? (unsigned)strlen(keywords[slots[k]]) : 0u);
+    }
+    fprintf(out, "};\n\n#endif /* LS_KW_HASH_H */\n");
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "kw_hash_gen: cannot write %s\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+// Searches hash parameters and writes the table.
+int main(int argc, char *argv[]) {
+    int slots[GEN_MAX_SCALE * GEN_NUM_KEYWORDS * 2];
+    unsigned size = 1;
+    unsigned a;
+    unsigned b;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <output-header>\n", argv[0]);
+        return 1;
+    }
+
+    while (size < (unsigned)GEN_NUM_KEYWORDS) {
+        size <<= 1;
+    }
+    for (; size <= (unsigned)(GEN_MAX_SCALE * GEN_NUM_KEYWORDS); size <<= 1) {
+        for (a = 1; a < GEN_MAX_MULT; a++) {
+            for (b = 0; b < GEN_MAX_MULT; b++) {
+                if (gen_try(a, b, size, slots)) {
+                    return gen_write(argv[1], a, b, size, slots);
+                }
+            }
+        }
+    }
+
+    fprintf(stderr, "kw_hash_gen: no collision-free hash for the keyword list\n");
+    return 1;
+}
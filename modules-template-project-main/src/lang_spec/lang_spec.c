@@ -4,14 +4,16 @@
  *
  * Implementation of language specification helpers.
  * All language-dependent logic is concentrated here.
- * Character-by-character keyword matching is used (no string library for
- * recognition in the input stream, per handout requirement).
+ * Keywords are found through a generated perfect hash (ls_kw_hash.h) and
+ * confirmed character by character (no string library for recognition in
+ * the input stream, per handout requirement).
  *
  * Team: Compilers P2
  * -----------------------------------------------------------------------------
  */
 
 #include "lang_spec.h"
+#include "ls_kw_hash.h"  // Generated by kw_hash_gen.
 #include <stddef.h>  // NULL
 
 // Category name lookup table.
@@ -25,28 +27,29 @@ static const char *category_names[CAT_COUNT] = {
     CAT_NAME_NONRECOGNIZED
 };
 
-// Keyword table.
-static const char *keywords[NUM_KEYWORDS] = {
-    KW_IF,
-    KW_ELSE,
-    KW_WHILE,
-    KW_RETURN,
-    KW_INT,
-    KW_CHAR,
-    KW_VOID
-};
+// List expanders: one initializer / one count per list entry.
+#define LS_LIST_ITEM(arg, v)  v,
+#define LS_LIST_COUNT(arg, v) + 1
 
 // Operator table.
 static const char operators[NUM_OPERATORS] = {
-    OP_ASSIGN, OP_GT, OP_PLUS, OP_STAR
+    LS_OPERATOR_LIST(LS_LIST_ITEM, _)
 };
 
 // Special-character table.
 static const char specials[NUM_SPECIALS] = {
-    SC_LPAREN, SC_RPAREN, SC_SEMICOLON, SC_LBRACE,
-    SC_RBRACE, SC_LBRACKET, SC_RBRACKET, SC_COMMA
+    LS_SPECIAL_LIST(LS_LIST_ITEM, _)
 };
 
+_Static_assert(NUM_KEYWORDS == 0 LS_KEYWORD_LIST(LS_LIST_COUNT, _),
+               "NUM_KEYWORDS must match LS_KEYWORD_LIST");
+_Static_assert(NUM_KEYWORDS == LS_KW_COUNT,
+               "ls_kw_hash.h is out of date with LS_KEYWORD_LIST");
+_Static_assert(NUM_OPERATORS == 0 LS_OPERATOR_LIST(LS_LIST_COUNT, _),
+               "NUM_OPERATORS must match LS_OPERATOR_LIST");
+_Static_assert(NUM_SPECIALS == 0 LS_SPECIAL_LIST(LS_LIST_COUNT, _),
+               "NUM_SPECIALS must match LS_SPECIAL_LIST");
+
 // Returns category display name.
 const char* ls_get_category_name(token_category_t cat) {
     if (cat >= 0 && cat < CAT_COUNT) {
@@ -55,33 +58,41 @@ const char* ls_get_category_name(token_category_t cat) {
     return CAT_NAME_NONRECOGNIZED;
 }
 
-// Compares two null-terminated strings char by char.
-static int str_equal_charwise(const char *a, const char *b) {
-    if (a == NULL || b == NULL) {
+// Returns 1 when lexeme matches a keyword exactly.
+int ls_is_keyword(const char *lexeme) {
+    int len = 0;
+
+    if (lexeme == NULL) {
         return 0;
     }
-    int i = 0;
-    while (a[i] != '\0' && b[i] != '\0') {
-        if (a[i] != b[i]) {
-            return 0;
-        }
-        i++;
+    while (lexeme[len] != '\0' && len <= LS_KW_MAX_LEN) {
+        len++;
     }
-    return (a[i] == '\0' && b[i] == '\0');
+    return ls_is_keyword_n(lexeme, len);
 }
 
-// Returns 1 when lexeme matches a keyword exactly.
-int ls_is_keyword(const char *lexeme) {
-    int k;
-    if (lexeme == NULL) {
+// Returns 1 when the length-delimited lexeme matches a keyword exactly:
+// one hash probe, then one char-by-char compare against that slot.
+int ls_is_keyword_n(const char *lexeme, int len) {
+    const char *kw;
+    unsigned h;
+    int i;
+
+    if (lexeme == NULL || len <= 0 || len > LS_KW_MAX_LEN) {
         return 0;
     }
-    for (k = 0; k < NUM_KEYWORDS; k++) {
-        if (str_equal_charwise(lexeme, keywords[k])) {
-            return 1;
+    h = LS_KW_HASH((unsigned char)lexeme[0], (unsigned char)lexeme[len - 1],
+                   len, LS_KW_HASH_A, LS_KW_HASH_B, LS_KW_HASH_MASK);
+    if (ls_kw_len[h] != len) {
+        return 0;
+    }
+    kw = ls_kw_table[h];
+    for (i = 0; i < len; i++) {
+        if (kw[i] != lexeme[i]) {
+            return 0;
         }
     }
-    return 0;
+    return 1;
 }
 
 // Returns 1 for supported operators.
@@ -108,20 +119,20 @@ int ls_is_special_char(char ch) {
 
 // Returns 1 for whitespace delimiters.
 int ls_is_whitespace(char ch) {
-    return (ch == WS_SPACE || ch == WS_TAB || ch == WS_CR || ch == WS_NL);
+    return LS_CH_IS_WHITESPACE(ch);
 }
 
 // Returns 1 for [A-Za-z].
 int ls_is_letter(char ch) {
-    return ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z'));
+    return LS_CH_IS_LETTER(ch);
 }
 
 // Returns 1 for [0-9].
 int ls_is_digit(char ch) {
-    return (ch >= '0' && ch <= '9');
+    return LS_CH_IS_DIGIT(ch);
 }
 
 // Returns 1 for literal quote delimiter.
 int ls_is_quote(char ch) {
-    return (ch == LIT_QUOTE);
+    return LS_CH_IS_QUOTE(ch);
 }
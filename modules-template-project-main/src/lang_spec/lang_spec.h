@@ -55,6 +55,17 @@ typedef enum {
 #define KW_CHAR   "char"
 #define KW_VOID   "void"
 
+// Keyword list. X(arg, kw) is expanded once per keyword. The keyword hash
+// table (ls_kw_hash.h) is generated from this list at build time.
+#define LS_KEYWORD_LIST(X, arg) \
+    X(arg, KW_IF) X(arg, KW_ELSE) X(arg, KW_WHILE) X(arg, KW_RETURN) \
+    X(arg, KW_INT) X(arg, KW_CHAR) X(arg, KW_VOID)
+
+// Keyword perfect hash over (first byte, last byte, length). The generator
+// picks LS_KW_HASH_A/B and a power-of-two table size with no collisions.
+#define LS_KW_HASH(first, last, len, a, b, mask) \
+    (((unsigned)(first) * (a) + (unsigned)(last) * (b) + (unsigned)(len)) & (mask))
+
 // Operators.
 #define OP_ASSIGN '='
 #define OP_GT     '>'
@@ -62,6 +73,10 @@ typedef enum {
 #define OP_STAR   '*'
 #define NUM_OPERATORS 4
 
+// Operator list. X(arg, ch) is expanded once per operator.
+#define LS_OPERATOR_LIST(X, arg) \
+    X(arg, OP_ASSIGN) X(arg, OP_GT) X(arg, OP_PLUS) X(arg, OP_STAR)
+
 // Special characters.
 #define SC_LPAREN    '('
 #define SC_RPAREN    ')'
@@ -73,6 +88,12 @@ typedef enum {
 #define SC_COMMA     ','
 #define NUM_SPECIALS 8
 
+// Special-character list. X(arg, ch) is expanded once per character.
+#define LS_SPECIAL_LIST(X, arg) \
+    X(arg, SC_LPAREN) X(arg, SC_RPAREN) X(arg, SC_SEMICOLON) \
+    X(arg, SC_LBRACE) X(arg, SC_RBRACE) X(arg, SC_LBRACKET) \
+    X(arg, SC_RBRACKET) X(arg, SC_COMMA)
+
 // Literal delimiters.
 #define LIT_QUOTE '"'
 
@@ -82,12 +103,30 @@ typedef enum {
 #define WS_CR     '\r'
 #define WS_NL     '\n'
 
+// Whitespace list. X(arg, ch) is expanded once per character.
+#define LS_WHITESPACE_LIST(X, arg) \
+    X(arg, WS_SPACE) X(arg, WS_TAB) X(arg, WS_CR) X(arg, WS_NL)
+
+// Constant-expression character predicates built from the lists above.
+// They can size and fill compile-time tables (e.g. the scanner class map).
+#define LS_CH_EQ_OR(c, v) ((c) == (v)) ||
+#define LS_CH_IS_LETTER(c) \
+    (((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z'))
+#define LS_CH_IS_DIGIT(c)      ((c) >= '0' && (c) <= '9')
+#define LS_CH_IS_QUOTE(c)      ((c) == LIT_QUOTE)
+#define LS_CH_IS_OPERATOR(c)   (LS_OPERATOR_LIST(LS_CH_EQ_OR, c) 0)
+#define LS_CH_IS_SPECIAL(c)    (LS_SPECIAL_LIST(LS_CH_EQ_OR, c) 0)
+#define LS_CH_IS_WHITESPACE(c) (LS_WHITESPACE_LIST(LS_CH_EQ_OR, c) 0)
+
 // Max lexeme length.
 #define MAX_LEXEME_LEN 1024
 
 // Scanner output suffix.
 #define SCN_SUFFIX "scn"
 
+// Binary token file suffix (token_io).
+#define CTOK_SUFFIX "tok"
+
 // Debug count output suffix.
 #define DBGCNT_SUFFIX "dbgcnt"
 
@@ -99,6 +138,9 @@ const char* ls_get_category_name(token_category_t cat);
 // Returns 1 for exact keyword matches.
 int ls_is_keyword(const char *lexeme);
 
+// Returns 1 when the len bytes at lexeme (not NUL-terminated) are a keyword.
+int ls_is_keyword_n(const char *lexeme, int len);
+
 // Returns 1 for operators.
 int ls_is_operator(char ch);
 
@@ -24,6 +24,14 @@ void logger_init(logger_t *lg, FILE *outfile) {
     }
 }
 
+// Uses dest as the destination unconditionally.
+void logger_init_dest(logger_t *lg, FILE *dest) {
+    if (lg == NULL) {
+        return;
+    }
+    lg->dest = (dest != NULL) ? dest : stdout;
+}
+
 // Returns current destination stream.
 FILE* logger_get_dest(const logger_t *lg) {
     if (lg == NULL || lg->dest == NULL) {
@@ -35,6 +35,10 @@ typedef struct {
 // Initializes logger destination.
 void logger_init(logger_t *lg, FILE *outfile);
 
+// Routes messages to dest regardless of DEBUG_FLAG (used to capture a
+// worker's messages and replay them in order).
+void logger_init_dest(logger_t *lg, FILE *dest);
+
 // Returns current destination stream.
 FILE* logger_get_dest(const logger_t *lg);
 
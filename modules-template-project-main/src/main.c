@@ -6,6 +6,9 @@
  * This is the driver that orchestrates the scanner pipeline.
  *
  * Usage: ./scanner <input.c>
+ *        ./scanner -          (reads stdin, writes stdin.cscn)
+ *        ./scanner <input.c | dir | @list>...   (batch mode)
+ *        ./scanner --serve <socket>             (daemon mode)
  *
  * Steps:
  *   1. Parse command-line arguments.
@@ -15,6 +18,28 @@
  *   5. (Future hook) Call the parser with the in-memory token list.
  *   6. Clean up resources.
  *
+ * Batch mode (several inputs, a directory or an @list file): inputs are
+ * expanded in order and scanned on a work-stealing pool (batch module).
+ * Every worker reuses its own stream, token list, arena, logger and
+ * counter; each file's console report is captured and printed in input
+ * order, so output does not depend on thread timing.
+ *
+ * Token cache (cfg.cache_dir): a resident input whose bytes and language
+ * spec match a stored entry replays the stored tokens and messages; the
+ * DFA does not run. Misses scan as usual and store their result.
+ *
+ * Streaming (cfg.stream): every finished source line is written while the
+ * scan runs and its tokens are dropped, so the whole token list never
+ * exists; the token cache and the .ctok file, which need it, are skipped.
+ *
+ * Write-if-changed (cfg.keep_unchanged): an output file whose contents
+ * would not change keeps its bytes and mtime, so watchers of the .cscn
+ * files see only real changes; pipeline and streaming writes are off.
+ *
+ * Binary tokens (cfg.ctok): the token list is also written to
+ * "<input>tok" (token_io module), which later phases map instead of
+ * re-lexing the .cscn.
+ *
  * Team: Compilers P2
  * -----------------------------------------------------------------------------
  */
@@ -23,21 +48,48 @@
 
 FILE* ofile = NULL; // Output handler used by template modules.
 
+// Per-worker scanner state, reused from one file to the next.
+typedef struct {
+    char_stream_t cs;     // Input stream of the current file.
+    token_list_t tokens;  // Tokens of the current file.
+    arena_t arena;        // Token/lexeme storage, reset per file.
+    scanner_ctx_t ctx;    // Settings, destinations and counters of the file.
+    token_cache_t cache;  // Token cache handle (disabled without cache_dir).
+    FILE *report;         // Captured console report (batch mode).
+} scan_worker_t;
+
+// Batch job context.
+typedef struct {
+    const batch_inputs_t *inputs;  // Files to scan, in report order.
+    const scanner_config_t *cfg;   // Settings shared by every file.
+    scan_worker_t *workers;        // One state per pool worker.
+    int *results;                  // Per-file run_scanner result.
+} scan_batch_t;
+
 // Prints CLI usage.
 static void print_usage(const char *prog_name) {
-    fprintf(stderr, "Usage: %s <input.c>\n", prog_name);
+    fprintf(stderr, "Usage: %s <input.c | - | dir | @list>...\n", prog_name);
+    fprintf(stderr, "       %s %s <socket>\n", prog_name, DAEMON_OPTION);
 }
 
 #ifdef COUNTCONFIG
-// Routes count summary to stdout, .cscn, or .cdbgcnt according to flags.
+// Returns 1 when the count summary goes into the .cscn file itself.
+static int count_in_output(const scanner_ctx_t *ctx) {
+    return ctx->cfg.count && ctx->cfg.countout == COUNTOUT_OUT &&
+           ctx->cfg.countfile != COUNTFILE_DBGCNT;
+}
+
+// Routes count summary to the console, .cscn, or .cdbgcnt according to the
+// context settings. A .cscn summary of an output session is written by
+// run_scanner before the session closes.
 static void write_count_summary(const char *input_filename,
                                 const char *output_filename,
-                                const counter_t *cnt) {
-    FILE *dest = stdout;
+                                const scanner_ctx_t *ctx) {
+    FILE *dest = ctx->out;
     char count_filename[MAX_FILENAME_BUF];
 
-    if (COUNTOUT == COUNTOUT_OUT) {
-        if (COUNTFILE == COUNTFILE_DBGCNT) {
+    if (ctx->cfg.countout == COUNTOUT_OUT) {
+        if (ctx->cfg.countfile == COUNTFILE_DBGCNT) {
             ow_build_count_filename(input_filename, count_filename,
                                     MAX_FILENAME_BUF);
             dest = fopen(count_filename, "w");
@@ -45,111 +97,428 @@ static void write_count_summary(const char *input_filename,
             dest = fopen(output_filename, "a");
         }
         if (dest == NULL) {
-            dest = stdout;
+            dest = ctx->out;
         }
     }
 
-    counter_print(cnt, dest, "run_scanner", 0);
+    counter_print(&ctx->cnt, dest, "run_scanner", 0);
 
-    if (dest != stdout) {
+    if (dest != ctx->out) {
         fclose(dest);
     }
 }
 #endif
 
-// Orchestrates scanner execution for one input file.
-static int run_scanner(const char *input_filename) {
-    char_stream_t cs;
-    token_list_t tokens;
-    logger_t lg;
-    counter_t cnt;
-    FILE *debug_out = NULL;
+// Returns 1 when every output name run_scanner builds from base with
+// settings cfg fits MAX_FILENAME_BUF. A truncated name could be the input
+// itself, which the writer would then empty while it is still mapped.
+static int output_names_fit(const char *base, const scanner_config_t *cfg) {
+    size_t len = strlen(base);
+
+    if (len + strlen(SCN_SUFFIX) >= MAX_FILENAME_BUF) {
+        return 0;
+    }
+    if (cfg->ctok && len + strlen(CTOK_SUFFIX) >= MAX_FILENAME_BUF) {
+        return 0;
+    }
+#ifdef COUNTCONFIG
+    if (cfg->count && cfg->countout == COUNTOUT_OUT &&
+        cfg->countfile == COUNTFILE_DBGCNT &&
+        len + strlen(DBGCNT_SUFFIX) >= MAX_FILENAME_BUF) {
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+// Prepares reusable worker state for scans with settings cfg.
+static void worker_init(scan_worker_t *w, const scanner_config_t *cfg,
+                        FILE *report) {
+    arena_init(&w->arena, 0);
+    tc_open(&w->cache, cfg->cache_dir);
+    w->report = report;
+}
+
+// Releases worker state.
+static void worker_free(scan_worker_t *w) {
+    arena_free(&w->arena);
+    tc_close(&w->cache);
+    if (w->report != NULL) {
+        fclose(w->report);
+    }
+}
+
+// Orchestrates scanner execution for one input file on worker state w,
+// with settings cfg. Console lines go to out.
+static int run_scanner(const char *input_filename,
+                       const scanner_config_t *cfg, scan_worker_t *w,
+                       FILE *out) {
+    scanner_ctx_t *ctx = &w->ctx;
+    ow_session_t session;
+    int in_session = 0;
+    FILE *capture = NULL;
+    FILE *msg_dest;
+    tc_key_t key;
     char output_filename[MAX_FILENAME_BUF];
-    int result;
+    const char *output_base;
+    const char *source;
+    size_t source_len;
+    int result = 0;
+    int write_status = 0;
+    int hit = 0;
+    int written = 0;
+    int streamed = 0;
+    int token_count;
 
     if (input_filename == NULL) {
         return ERR_FILE_OPEN;
     }
 
+    // Streamed stdin has no name of its own to derive outputs from.
+    output_base = input_filename;
+    if (cs_is_stdin_name(input_filename)) {
+        output_base = STDIN_OUTPUT_BASE;
+    }
+
     // Initialize subsystems.
-    counter_init(&cnt);
-    tl_init(&tokens);
+    // Per-file allocations (tokens, copied lexemes) come from the worker's
+    // arena, emptied for every file.
+    scanner_ctx_init(ctx, cfg, out);
+    // Inputs of any length reach here (directory walks, @lists): one whose
+    // output names do not fit is refused, not scanned.
+    if (!output_names_fit(output_base, &ctx->cfg)) {
+        err_report_ctx(ctx, ERR_FILE_OPEN, ERR_STEP_DRIVER, 0, input_filename);
+        return ERR_FILE_OPEN;
+    }
+    arena_reset(&w->arena);
+    tl_init_arena(&w->tokens, &w->arena);
+    // Streaming recycles token storage per line: heap blocks can be
+    // released, arena blocks could not.
+    // Write-if-changed compares the whole output before writing any of it.
+    streamed = (ctx->cfg.stream && ctx->cfg.debug != DEBUG_ON &&
+                !ctx->cfg.keep_unchanged);
+    if (streamed) {
+        tl_init(&w->tokens);
+    }
 
     // Build output filename: input.c -> input.cscn.
-    ow_build_output_filename(input_filename, output_filename, MAX_FILENAME_BUF);
+    ow_build_output_filename(output_base, output_filename, MAX_FILENAME_BUF);
 
-    // Initialize logger destination.
-    if (DEBUG_FLAG == DEBUG_ON) {
-        debug_out = fopen(output_filename, "w");
-        if (debug_out == NULL) {
-            tl_free(&tokens);
+    // Messages share the output file in DEBUG mode: one output session
+    // (one open, one buffer) carries messages, then tokens.
+    if (ctx->cfg.debug == DEBUG_ON) {
+        if (ow_session_open(&session, output_filename) != 0) {
+            tl_free(&w->tokens);
             return ERR_FILE_OUTPUT;
         }
-        logger_init(&lg, debug_out);
-    } else {
-        logger_init(&lg, stdout);
+        in_session = 1;
+        logger_init_dest(&ctx->lg, ow_session_file(&session));
     }
 
     // Open input file.
-    if (cs_open(&cs, input_filename) != 0) {
-        err_report(logger_get_dest(&lg), ERR_FILE_OPEN, ERR_STEP_DRIVER,
-                   0, input_filename);
-        if (debug_out != NULL) {
-            fclose(debug_out);
+    if (cs_open(&w->cs, input_filename) != 0) {
+        err_report_ctx(ctx, ERR_FILE_OPEN, ERR_STEP_DRIVER, 0, input_filename);
+        if (in_session) {
+            ow_session_close(&session);
         }
-        tl_free(&tokens);
+        tl_free(&w->tokens);
         return ERR_FILE_OPEN;
     }
 
-    fprintf(stdout, "Scanning: %s\n", input_filename);
+    fprintf(ctx->out, "Scanning: %s\n", input_filename);
 
-    // Run scanner.
-    result = automata_scan(&cs, &tokens, &lg, &cnt);
+    // Resident input: lexemes become spans of it (stream kept open until
+    // the token list is released).
+    source = cs_data(&w->cs, &source_len);
+    tl_set_source(&w->tokens, source, source_len);
 
-    // Close input stream.
-    cs_close(&cs);
+    // Token cache: only resident inputs can be hashed up front, and counted
+    // scans always run so that the counts measure real work. A miss
+    // captures its messages so they can be stored with the tokens.
+    msg_dest = logger_get_dest(&ctx->lg);
+    if (w->cache.enabled && source != NULL && !ctx->cfg.count && !streamed) {
+        tc_key(&w->cache, &key, source, source_len);
+        hit = (tc_load(&w->cache, &key, &w->tokens, &w->arena, msg_dest,
+                       &result) == 0);
+        if (!hit) {
+            capture = tc_capture_begin(&w->cache);
+            if (capture != NULL) {
+                logger_init_dest(&ctx->lg, capture);
+            }
+        }
+    }
 
-    if (debug_out != NULL) {
-        fclose(debug_out);
-        debug_out = NULL;
-        logger_init(&lg, stdout);
+    // Run scanner (cache hits already hold their tokens).
+    // Pipeline mode streams tokens to the writer while scanning; DEBUG mode
+    // keeps the sequential path because messages share the output file.
+    if (streamed) {
+        result = pipeline_stream(&w->cs, &w->tokens, ctx, output_filename,
+                                 &write_status, &token_count);
+        written = 1;
+    } else if (!hit && ctx->cfg.pipeline && ctx->cfg.debug != DEBUG_ON &&
+               !ctx->cfg.keep_unchanged) {
+        result = pipeline_run(&w->cs, &w->tokens, ctx, output_filename,
+                              &write_status);
+        written = 1;
+    } else if (!hit) {
+        // Large resident inputs are split across cfg.threads (at newlines,
+        // or anywhere with speculative stitching).
+        result = automata_scan_ctx(&w->cs, &w->tokens, ctx);
     }
 
-    // Write token file.
-    if (ow_write_token_file_mode(&tokens, output_filename,
-                                 (DEBUG_FLAG == DEBUG_ON)) != 0) {
-        err_report(logger_get_dest(&lg), ERR_FILE_OUTPUT, ERR_STEP_DRIVER,
-                   0, output_filename);
-        tl_free(&tokens);
+    if (capture != NULL) {
+        logger_init_dest(&ctx->lg, msg_dest);
+        tc_capture_end(&w->cache, msg_dest);
+        if (result == 0 && !cs_error(&w->cs)) {
+            tc_store(&w->cache, &key, &w->tokens, result);
+        }
+    }
+
+    // A failed read ends the input early: the tokens are only a prefix, so
+    // they are not written (a streamed file is removed) and the scan fails.
+    if (cs_error(&w->cs)) {
+        err_report_ctx(ctx, ERR_FILE_READ, ERR_STEP_DRIVER, 0,
+                       input_filename);
+        if (in_session) {
+            ow_session_close(&session);
+            logger_init_dest(&ctx->lg, ctx->out);
+        } else if (written) {
+            remove(output_filename);
+        }
+        tl_free(&w->tokens);
+        cs_close(&w->cs);
+        return ERR_FILE_READ;
+    }
+
+    if (!written && in_session) {
+        // Token lines (and a count summary) follow the messages; closing is
+        // the final flush.
+        write_status = ow_session_write_tokens(&session, &w->tokens, ctx);
+#ifdef COUNTCONFIG
+        if (write_status == 0 && count_in_output(ctx)) {
+            counter_print(&ctx->cnt, ow_session_file(&session),
+                          "run_scanner", 0);
+        }
+#endif
+        if (ow_session_close(&session) != 0) {
+            write_status = -1;
+        }
+        logger_init_dest(&ctx->lg, ctx->out);
+    } else if (!written) {
+        // Write token file.
+        write_status = ow_write_token_file_ctx(&w->tokens, output_filename,
+                                               ctx);
+    }
+
+    if (write_status != 0) {
+        err_report_ctx(ctx, ERR_FILE_OUTPUT, ERR_STEP_DRIVER, 0,
+                       output_filename);
+        tl_free(&w->tokens);
+        cs_close(&w->cs);
         return ERR_FILE_OUTPUT;
     }
 
-    fprintf(stdout, "Output written to: %s\n", output_filename);
-    fprintf(stdout, "Tokens found: %d\n", tl_count(&tokens));
+    fprintf(ctx->out, "Output written to: %s\n", output_filename);
+    if (!streamed) {
+        token_count = tl_count(&w->tokens);
+    }
+
+    if (ctx->cfg.ctok && !streamed) {
+        char ctok_filename[MAX_FILENAME_BUF];
+
+        tio_build_filename(output_base, ctok_filename, MAX_FILENAME_BUF);
+        if (tio_write(&w->tokens, ctok_filename) != 0) {
+            err_report_ctx(ctx, ERR_FILE_OUTPUT, ERR_STEP_DRIVER, 0,
+                           ctok_filename);
+            tl_free(&w->tokens);
+            cs_close(&w->cs);
+            return ERR_FILE_OUTPUT;
+        }
+        fprintf(ctx->out, "Output written to: %s\n", ctok_filename);
+    }
+    fprintf(ctx->out, "Tokens found: %d\n", token_count);
 
 #ifdef COUNTCONFIG
-    write_count_summary(input_filename, output_filename, &cnt);
+    if (ctx->cfg.count && !(in_session && count_in_output(ctx))) {
+        write_count_summary(output_base, output_filename, ctx);
+    }
 #endif
 
-    // Future hook: parser can consume the in-memory token list here.
-    // Clean up.
-    tl_free(&tokens);
+    // Future hook: parser can consume the in-memory token list here
+    // (tl_get + token_category/token_line/token_col, tl_lexeme for text).
+    // Clean up (input last: span lexemes point into it).
+    tl_free(&w->tokens);
+    cs_close(&w->cs);
 
     return result;
 }
 
+// Batch job: scans one file and returns its captured console report.
+static char* scan_batch_job(void *ctx, int worker, int job, size_t *len) {
+    scan_batch_t *b = (scan_batch_t *)ctx;
+    scan_worker_t *w = &b->workers[worker];
+    FILE *out = (w->report != NULL) ? w->report : stdout;
+    char *text = NULL;
+    long end;
+
+    // The capture file is rewound, not truncated: only the first end bytes
+    // belong to this file.
+    if (w->report != NULL) {
+        rewind(w->report);
+    }
+    b->results[job] = run_scanner(b->inputs->paths[job], b->cfg, w, out);
+    *len = 0;
+    if (w->report == NULL) {
+        return NULL;
+    }
+
+    fflush(w->report);
+    end = ftell(w->report);
+    if (end > 0) {
+        text = (char *)malloc((size_t)end);
+        if (text == NULL) {
+            fprintf(stderr, "scan_batch_job: memory allocation failed\n");
+            return NULL;
+        }
+        rewind(w->report);
+        *len = fread(text, 1, (size_t)end, w->report);
+    }
+    return text;
+}
+
+// Scans every input on a work-stealing pool. Files are the unit of
+// parallelism, so each one is scanned on its worker thread alone. Returns
+// the first non-zero per-file result in input order, else 0, or
+// ERR_INTERNAL when the pool could not be set up (nothing scanned).
+static int run_batch(const batch_inputs_t *inputs,
+                     const scanner_config_t *cfg) {
+    scanner_config_t file_cfg = *cfg;
+    scan_batch_t b;
+    int nthreads = batch_thread_count(BATCH_THREADS, inputs->count);
+    int run_threads = nthreads;
+    int failed = 0;
+    int result = 0;
+    int i;
+
+    file_cfg.threads = 1;
+    file_cfg.pipeline = 0;
+    b.inputs = inputs;
+    b.cfg = &file_cfg;
+    b.workers = (scan_worker_t *)malloc((size_t)nthreads *
+                                        sizeof(scan_worker_t));
+    b.results = (int *)calloc((size_t)inputs->count, sizeof(int));
+    if (b.workers == NULL || b.results == NULL) {
+        fprintf(stderr, "run_batch: memory allocation failed\n");
+        free(b.workers);
+        free(b.results);
+        return ERR_FILE_OPEN;
+    }
+    // Every worker captures its reports so batch_run prints them in input
+    // order. Without a capture file for each worker the batch runs on one
+    // thread, whose reports go straight to stdout already in order.
+    for (i = 0; i < nthreads; i++) {
+        worker_init(&b.workers[i], &file_cfg, NULL);
+        if (nthreads > 1) {
+            b.workers[i].report = tmpfile();
+            if (b.workers[i].report == NULL) {
+                run_threads = 1;
+            }
+        }
+    }
+    if (run_threads == 1 && nthreads > 1) {
+        fprintf(stderr, "run_batch: no report capture file, "
+                        "scanning on one thread\n");
+        for (i = 0; i < nthreads; i++) {
+            if (b.workers[i].report != NULL) {
+                fclose(b.workers[i].report);
+                b.workers[i].report = NULL;
+            }
+        }
+    }
+
+    if (batch_run(inputs->count, run_threads, scan_batch_job, &b,
+                  stdout) != 0) {
+        err_report(stdout, ERR_INTERNAL, ERR_STEP_DRIVER, 0, "batch");
+        for (i = 0; i < nthreads; i++) {
+            worker_free(&b.workers[i]);
+        }
+        free(b.workers);
+        free(b.results);
+        return ERR_INTERNAL;
+    }
+
+    for (i = 0; i < inputs->count; i++) {
+        if (b.results[i] != 0) {
+            failed++;
+            if (result == 0) {
+                result = b.results[i];
+            }
+        }
+    }
+    fprintf(stdout, "Files scanned: %d (%d failed)\n", inputs->count, failed);
+
+    for (i = 0; i < nthreads; i++) {
+        worker_free(&b.workers[i]);
+    }
+    free(b.workers);
+    free(b.results);
+    return result;
+}
+
 // Entry point wrapper.
 int main(int argc, char *argv[]) {
-    int result;
+    batch_inputs_t inputs;
+    scanner_config_t cfg;
+    scan_worker_t single;
+    int result = 0;
+    int i;
 
+    // ofile only serves the template modules; scans use scanner_ctx_t.
     ofile = stdout;
+    scanner_config_default(&cfg);
 
     if (argc < MIN_ARGS) {
         print_usage(argv[0]);
         return ERR_FILE_OPEN;
     }
 
-    result = run_scanner(argv[ARG_INPUT_FILE]);
+    // Long-running server: requests arrive on a Unix socket.
+    if (strcmp(argv[ARG_INPUT_FILE], DAEMON_OPTION) == 0) {
+        if (argc != DAEMON_ARGS) {
+            print_usage(argv[0]);
+            return ERR_FILE_OPEN;
+        }
+        if (daemon_serve(argv[ARG_SOCKET], &cfg) != 0) {
+            err_report(stdout, ERR_FILE_OUTPUT, ERR_STEP_DRIVER, 0,
+                       argv[ARG_SOCKET]);
+            return ERR_FILE_OUTPUT;
+        }
+        return 0;
+    }
+
+    // One plain file: scanned alone with every intra-file mode available.
+    if (argc == MIN_ARGS && !batch_is_collection(argv[ARG_INPUT_FILE])) {
+        worker_init(&single, &cfg, NULL);
+        result = run_scanner(argv[ARG_INPUT_FILE], &cfg, &single, stdout);
+        worker_free(&single);
+        return result;
+    }
+
+    batch_inputs_init(&inputs);
+    for (i = ARG_INPUT_FILE; i < argc; i++) {
+        if (batch_collect(&inputs, argv[i]) != 0) {
+            err_report(stdout, ERR_FILE_OPEN, ERR_STEP_DRIVER, 0, argv[i]);
+            result = ERR_FILE_OPEN;
+        }
+    }
+    if (inputs.count > 0) {
+        int batch_result = run_batch(&inputs, &cfg);
+
+        if (result == 0) {
+            result = batch_result;
+        }
+    }
+    batch_inputs_free(&inputs);
 
     return result;
 }
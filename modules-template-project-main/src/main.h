@@ -2,17 +2,25 @@
 #define MAIN_H
  
 #include <stdio.h>
+#include <stdlib.h>  // malloc, calloc, free
+#include <string.h>  // strcmp
 #include "./utils_files.h"
 #include "./module_args/module_args.h"
 #include "./module_2/module_2.h"
 
 // Scanner module includes.
 #include "./lang_spec/lang_spec.h"
+#include "./arena/arena.h"
 #include "./char_stream/char_stream.h"
 #include "./token/token.h"
 #include "./token_list/token_list.h"
 #include "./automata/automata.h"
 #include "./out_writer/out_writer.h"
+#include "./pipeline/pipeline.h"
+#include "./batch/batch.h"
+#include "./token_cache/token_cache.h"
+#include "./token_io/token_io.h"
+#include "./daemon/daemon.h"
 #include "./error_mod/error_mod.h"
 #include "./logger/logger.h"
 #include "./counter/counter.h"
@@ -26,6 +34,13 @@
 // argv index of input file.
 #define ARG_INPUT_FILE 1
 
+// Daemon mode: program, DAEMON_OPTION, socket path.
+#define DAEMON_ARGS 3
+#define ARG_SOCKET  2
+
+// Output base name used when the input is stdin ("-"): stdin.cscn.
+#define STDIN_OUTPUT_BASE "stdin.c"
+
 // Max filename buffer size used by driver.
 #define MAX_FILENAME_BUF 512
 
@@ -3,7 +3,8 @@
  * out_writer.c
  *
  * Output writer implementation. Builds the .cscn filename and writes
- * the formatted token list, respecting the OUTFORMAT setting.
+ * the formatted token list, respecting the OUTFORMAT setting. Tokens are
+ * formatted into the stream buffer and written a buffer at a time.
  *
  * Team: Compilers P2
  * -----------------------------------------------------------------------------
@@ -11,9 +12,26 @@
 
 #include "out_writer.h"
 #include "../lang_spec/lang_spec.h"
-#include <stdio.h>
+#include <stdio.h>   // FILE, rename, remove
+#include <stdlib.h>  // malloc, free
+#include <string.h>  // memcpy, memcmp, strlen
+#if OW_HAVE_POSIX_IO
+#include <errno.h>     // errno, EINTR
+#include <fcntl.h>     // open
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // read, write, pwrite, lseek, close
+#endif
+#include <pthread.h>
+#include <stdatomic.h>  // atomic_uint
+#ifdef _WIN32
+#include <process.h>    // _getpid
+#define ow_getpid() _getpid()
+#else
+#define ow_getpid() getpid()
+#endif
 
-// Internal helper to print one token.
+// Serial number of temporary output files written by this process.
+static atomic_uint ow_serial;
 
 // Builds "<input>scn". Example: example.c -> example.cscn.
 void ow_build_output_filename(const char *input_filename, char *output_buf,
@@ -67,80 +85,822 @@ void ow_build_count_filename(const char *input_filename, char *output_buf,
     output_buf[i] = '\0';
 }
 
-// Writes token as <lexeme, CATEGORY>.
-static void write_token_formatted(FILE *fp, const token_t *tok) {
-    const char *cat_name = ls_get_category_name(tok->category);
-    fprintf(fp, "%c%s%c %s%c", TOK_FMT_OPEN, tok->lexeme, TOK_FMT_SEP,
-            cat_name, TOK_FMT_CLOSE);
+// Compare mode: reads the next buffered-length bytes of the file in
+// OW_CMP_CHUNK pieces and flags the stream on the first difference.
+static void compare_buffer(ow_stream_t *ws) {
+    char chunk[OW_CMP_CHUNK];
+    size_t done = 0;
+
+    while (done < ws->len && !ws->error) {
+        size_t want = ws->len - done;
+        size_t got = 0;
+
+        if (want > sizeof(chunk)) {
+            want = sizeof(chunk);
+        }
+#if OW_HAVE_POSIX_IO
+        while (got < want) {
+            ssize_t n = read(ws->fd, chunk + got, want - got);
+
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            got += (size_t)n;
+        }
+#else
+        got = fread(chunk, 1, want, ws->fp);
+#endif
+        if (got != want || memcmp(chunk, ws->buf + done, want) != 0) {
+            ws->error = 1;
+        }
+        done += want;
+    }
+}
+
+// Writes the buffered bytes to the stream's file and empties the buffer.
+static void flush_buffer(ow_stream_t *ws) {
+    if (ws->len == 0) {
+        return;
+    }
+    if (ws->compare) {
+        compare_buffer(ws);
+        ws->len = 0;
+        return;
+    }
+#if OW_HAVE_POSIX_IO
+    if (ws->fd >= 0) {
+        size_t done = 0;
+
+        while (done < ws->len) {
+            ssize_t n = (ws->pos < 0)
+                ? write(ws->fd, ws->buf + done, ws->len - done)
+                : pwrite(ws->fd, ws->buf + done, ws->len - done,
+                         (off_t)(ws->pos + (int64_t)done));
+
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                ws->error = 1;
+                break;
+            }
+            done += (size_t)n;
+        }
+        if (ws->pos >= 0) {
+            ws->pos += (int64_t)done;
+        }
+        ws->len = 0;
+        return;
+    }
+#endif
+    if (fwrite(ws->buf, 1, ws->len, ws->fp) != ws->len) {
+        ws->error = 1;
+    }
+    ws->len = 0;
+}
+
+// Sets up line state and category table of a stream writing to fp or fd
+// (no buffer yet).
+static void stream_setup(ow_stream_t *ws, FILE *fp, int fd, int owned,
+                         int format) {
+    int c;
+
+    ws->fp = fp;
+    ws->fd = fd;
+    ws->pos = -1;
+    ws->owned = owned;
+    ws->error = 0;
+    ws->compare = 0;
+    ws->format = format;
+    ws->current_line = -1;
+    ws->first_on_line = 1;
+    ws->len = 0;
+    for (c = 0; c <= CAT_COUNT; c++) {
+        ws->cat_name[c] = ls_get_category_name((token_category_t)c);
+        ws->cat_len[c] = strlen(ws->cat_name[c]);
+    }
+    ws->buf = NULL;
+}
+
+// Sets up a stream writing to fp or fd with its own buffer.
+static int stream_init(ow_stream_t *ws, FILE *fp, int fd, int owned,
+                       int format) {
+    stream_setup(ws, fp, fd, owned, format);
+    ws->buf = (char *)malloc(OW_BUF_SIZE);
+    if (ws->buf == NULL) {
+        fprintf(stderr, "stream_init: memory allocation failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Opens the output file for incremental writing in format.
+static int stream_open(ow_stream_t *ws, const char *output_filename,
+                       int append_mode, int format) {
+    if (ws == NULL) {
+        return -1;
+    }
+    ws->fp = NULL;
+    ws->fd = -1;
+    ws->buf = NULL;
+    if (output_filename == NULL) {
+        return -1;
+    }
+#if OW_HAVE_POSIX_IO
+    {
+        int flags = O_WRONLY | O_CREAT | (append_mode ? O_APPEND : O_TRUNC);
+        int fd = open(output_filename, flags, 0666);
+
+        if (fd < 0) {
+            return -1;
+        }
+        if (stream_init(ws, NULL, fd, 1, format) != 0) {
+            close(fd);
+            ws->fd = -1;
+            return -1;
+        }
+    }
+#else
+    {
+        // Text mode, as the file has always been written.
+        FILE *fp = fopen(output_filename, append_mode ? "a" : "w");
+
+        if (fp == NULL) {
+            return -1;
+        }
+        if (stream_init(ws, fp, -1, 1, format) != 0) {
+            fclose(fp);
+            ws->fp = NULL;
+            return -1;
+        }
+    }
+#endif
+    return 0;
+}
+
+// Opens the output file in the compile-time OUTFORMAT.
+int ow_stream_open(ow_stream_t *ws, const char *output_filename,
+                   int append_mode) {
+    return stream_open(ws, output_filename, append_mode, OUTFORMAT);
+}
+
+// Opens the output file with the settings of ctx.
+int ow_stream_open_ctx(ow_stream_t *ws, const char *output_filename,
+                       const scanner_ctx_t *ctx) {
+    if (ctx == NULL) {
+        return -1;
+    }
+    return stream_open(ws, output_filename, (ctx->cfg.debug == DEBUG_ON),
+                       ctx->cfg.outformat);
+}
+
+// Formats value in decimal at p. Returns the end of the digits.
+static char* put_int(char *p, int value) {
+    char digits[16];
+    unsigned int v = (unsigned int)value;
+    int n = 0;
+
+    if (value < 0) {
+        *p++ = '-';
+        v = 0u - v;
+    }
+    do {
+        digits[n++] = (char)('0' + v % 10u);
+        v /= 10u;
+    } while (v != 0u);
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+// Ends the open output line at p. DEBUG adds an extra separator line.
+static char* put_line_end(const ow_stream_t *ws, char *p) {
+    *p++ = '\n';
+    if (ws->format == OUTFORMAT_DEBUG) {
+        *p++ = '\n';
+    }
+    return p;
+}
+
+// Writes one token as <lexeme, CATEGORY> in the configured format.
+void ow_stream_token(ow_stream_t *ws, const token_t *tok, lexeme_view_t lex) {
+    int cat;
+    size_t lex_len;
+    char *p;
+
+    if (ws == NULL || ws->buf == NULL || tok == NULL) {
+        return;
+    }
+
+    cat = token_category(tok);
+    if (cat < 0 || cat >= CAT_COUNT) {
+        cat = CAT_COUNT;
+    }
+    lex_len = (lex.len > 0) ? (size_t)lex.len : 0;
+    // Room for: line end, DEBUG line number, separator, delimiters.
+    if (ws->len + lex_len + ws->cat_len[cat] + 32 > OW_BUF_SIZE) {
+        flush_buffer(ws);
+    }
+    p = ws->buf + ws->len;
+
+    if (token_line(tok) != ws->current_line) {
+        // Start a new output line for a new source line number.
+        if (ws->current_line != -1) {
+            p = put_line_end(ws, p);
+        }
+        if (ws->format == OUTFORMAT_DEBUG) {
+            p = put_int(p, token_line(tok));
+            *p++ = TOK_FMT_SPACE;
+        }
+        ws->current_line = token_line(tok);
+        ws->first_on_line = 1;
+    }
+
+    if (!ws->first_on_line) {
+        *p++ = TOK_FMT_SPACE;
+    }
+    *p++ = TOK_FMT_OPEN;
+    if (lex_len > 0) {
+        memcpy(p, lex.data, lex_len);
+        p += lex_len;
+    }
+    *p++ = TOK_FMT_SEP;
+    *p++ = TOK_FMT_SPACE;
+    memcpy(p, ws->cat_name[cat], ws->cat_len[cat]);
+    p += ws->cat_len[cat];
+    *p++ = TOK_FMT_CLOSE;
+    ws->len = (size_t)(p - ws->buf);
+    ws->first_on_line = 0;
+}
+
+// Ends the last output line (nothing is added when no token was written)
+// and writes the buffer.
+static void stream_finish(ow_stream_t *ws) {
+    if (ws->current_line != -1) {
+        ws->len = (size_t)(put_line_end(ws, ws->buf + ws->len) - ws->buf);
+        ws->current_line = -1;
+    }
+    flush_buffer(ws);
+}
+
+// Ends the open output line and writes the buffer.
+int ow_stream_flush_line(ow_stream_t *ws) {
+    if (ws == NULL || ws->buf == NULL) {
+        return -1;
+    }
+    stream_finish(ws);
+    return ws->error ? -1 : 0;
+}
+
+// Finishes the output and closes the file.
+int ow_stream_close(ow_stream_t *ws) {
+    int status;
+
+    if (ws == NULL || ws->buf == NULL) {
+        return -1;
+    }
+
+    stream_finish(ws);
+    status = ws->error ? -1 : 0;
+    if (ws->owned) {
+#if OW_HAVE_POSIX_IO
+        if (ws->fd >= 0 && close(ws->fd) != 0) {
+            status = -1;
+        }
+#endif
+        if (ws->fp != NULL && fclose(ws->fp) != 0) {
+            status = -1;
+        }
+    }
+    free(ws->buf);
+    ws->buf = NULL;
+    ws->fp = NULL;
+    ws->fd = -1;
+    return status;
+}
+
+// Writes every token of an opened stream and closes it.
+static int write_all_tokens(ow_stream_t *ws, const token_list_t *tokens) {
+    int i;
+    int count = tl_count(tokens);
+    const token_t *tok;
+
+    for (i = 0; i < count; i++) {
+        tok = tl_get(tokens, i);
+        if (tok == NULL) {
+            continue;
+        }
+        ow_stream_token(ws, tok, tl_lexeme(tokens, tok));
+    }
+    return ow_stream_close(ws);
 }
 
 // Writes complete token output file in configured mode.
 int ow_write_token_file_mode(const token_list_t *tokens,
                              const char *output_filename, int append_mode) {
-    FILE *fp;
-    int i;
-    int count;
-    int current_line;
-    int first_on_line;
-    const token_t *tok;
-    const char *open_mode = append_mode ? "a" : "w";
+    ow_stream_t ws;
 
     if (tokens == NULL || output_filename == NULL) {
         return -1;
     }
+    if (ow_stream_open(&ws, output_filename, append_mode) != 0) {
+        return -1;
+    }
+    return write_all_tokens(&ws, tokens);
+}
 
-    fp = fopen(output_filename, open_mode);
-    if (fp == NULL) {
+// Writes complete token output file with the settings of ctx on one thread.
+static int write_file_sequential(const token_list_t *tokens,
+                                 const char *output_filename,
+                                 const scanner_ctx_t *ctx) {
+    ow_stream_t ws;
+
+    if (ow_stream_open_ctx(&ws, output_filename, ctx) != 0) {
         return -1;
     }
+    return write_all_tokens(&ws, tokens);
+}
 
-    count = tl_count(tokens);
-    if (count == 0) {
-        fclose(fp);
-        return 0;
+#if OW_HAVE_POSIX_IO
+// One part of a parallel write: tokens [first, end), starting after a
+// token of line prev_line (-1 at the start of the output).
+typedef struct {
+    const token_list_t *tokens;  // Whole list.
+    const ow_stream_t *proto;    // Format and category table.
+    int fd;                      // Shared output descriptor.
+    int first;                   // First token.
+    int end;                     // One past the last token.
+    int prev_line;               // Line of the token before first.
+    int last;                    // 1 for the part ending the output.
+    int64_t size;                // Exact output bytes (measure pass).
+    int64_t offset;              // File offset (prefix sum of sizes).
+    int status;                  // 0, or -1 when a write failed.
+} ow_part_t;
+
+// Returns the decimal digits (and sign) of value.
+static int count_digits(int value) {
+    unsigned int v = (unsigned int)value;
+    int n = 1;
+
+    if (value < 0) {
+        v = 0u - v;
+        n++;
     }
+    while (v >= 10u) {
+        v /= 10u;
+        n++;
+    }
+    return n;
+}
 
-    current_line = -1;
-    first_on_line = 1;
+// Measure pass: the bytes ow_stream_token and stream_finish emit for the
+// part, mirroring them field by field.
+static void* part_measure(void *arg) {
+    ow_part_t *part = (ow_part_t *)arg;
+    const ow_stream_t *ws = part->proto;
+    int64_t line_end = (ws->format == OUTFORMAT_DEBUG) ? 2 : 1;
+    int64_t size = 0;
+    int line = part->prev_line;
+    int i;
 
-    for (i = 0; i < count; i++) {
-        tok = tl_get(tokens, i);
-        if (tok == NULL) {
+    for (i = part->first; i < part->end; i++) {
+        const token_t *tok = tl_get(part->tokens, i);
+        lexeme_view_t lex = tl_lexeme(part->tokens, tok);
+        int cat = token_category(tok);
+
+        if (cat < 0 || cat >= CAT_COUNT) {
+            cat = CAT_COUNT;
+        }
+        if (token_line(tok) != line) {
+            if (line != -1) {
+                size += line_end;
+            }
+            if (ws->format == OUTFORMAT_DEBUG) {
+                size += count_digits(token_line(tok)) + 1;
+            }
+            line = token_line(tok);
+        } else {
+            size += 1;
+        }
+        // "<" lexeme ", " category ">"
+        size += 4 + ((lex.len > 0) ? lex.len : 0) + (int64_t)ws->cat_len[cat];
+    }
+    if (part->last && line != -1) {
+        size += line_end;
+    }
+    part->size = size;
+    return NULL;
+}
+
+// Format pass: formats the part and pwrite()s it at its offset.
+static void* part_format(void *arg) {
+    ow_part_t *part = (ow_part_t *)arg;
+    ow_stream_t ws;
+    int i;
+
+    part->status = -1;
+    if (stream_init(&ws, NULL, part->fd, 0, part->proto->format) != 0) {
+        return NULL;
+    }
+    ws.pos = part->offset;
+    ws.current_line = part->prev_line;
+    ws.first_on_line = 0;
+    for (i = part->first; i < part->end; i++) {
+        const token_t *tok = tl_get(part->tokens, i);
+
+        ow_stream_token(&ws, tok, tl_lexeme(part->tokens, tok));
+    }
+    if (part->last) {
+        stream_finish(&ws);
+    } else {
+        flush_buffer(&ws);
+    }
+    // A size mismatch would leave a hole or overwrite the next part.
+    if (!ws.error && ws.pos == part->offset + part->size) {
+        part->status = 0;
+    }
+    free(ws.buf);
+    return NULL;
+}
+
+// Runs fn on every part: parts 1..n-1 on their own threads, part 0 on the
+// caller (inline when a thread cannot be started).
+static void run_parts(ow_part_t *parts, int n, void *(*fn)(void *)) {
+    pthread_t threads[OW_MAX_THREADS];
+    int started[OW_MAX_THREADS];
+    int i;
+
+    for (i = 1; i < n; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, fn, &parts[i]) == 0);
+        if (!started[i]) {
+            fn(&parts[i]);
+        }
+    }
+    fn(&parts[0]);
+    for (i = 1; i < n; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+// Cuts tokens into at most n parts of similar size, each starting on a new
+// source line. Returns the number of parts.
+static int split_parts(ow_part_t *parts, int n, const token_list_t *tokens) {
+    int count = tl_count(tokens);
+    int first = 0;
+    int k;
+    int used = 0;
+
+    for (k = 0; k < n && first < count; k++) {
+        int end = (k == n - 1) ? count
+                               : (int)((int64_t)count * (k + 1) / n);
+
+        if (end <= first) {
             continue;
         }
+        // Move the cut forward to the first token of the next line.
+        while (end < count && token_line(tl_get(tokens, end)) ==
+                              token_line(tl_get(tokens, end - 1))) {
+            end++;
+        }
+        parts[used].first = first;
+        parts[used].end = end;
+        parts[used].prev_line =
+            (first == 0) ? -1 : token_line(tl_get(tokens, first - 1));
+        parts[used].last = (end == count);
+        used++;
+        first = end;
+    }
+    return used;
+}
 
-        if (tok->line != current_line) {
-            // Start a new output line for a new source line number.
-            if (current_line != -1) {
-                fprintf(fp, "\n");
-#if OUTFORMAT == OUTFORMAT_DEBUG
-                fprintf(fp, "\n");
+// Returns writer threads for requested (0 = one per online CPU).
+static int writer_thread_count(int requested) {
+    long n = requested;
+
+    if (requested <= 0) {
+        n = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+        n = sysconf(_SC_NPROCESSORS_ONLN);
 #endif
-            }
-#if OUTFORMAT == OUTFORMAT_DEBUG
-            fprintf(fp, "%d ", tok->line);
+    }
+    if (n < 1) {
+        n = 1;
+    }
+    if (n > OW_MAX_THREADS) {
+        n = OW_MAX_THREADS;
+    }
+    return (int)n;
+}
+#endif
+
+// Writes complete token output file on up to nthreads threads.
+int ow_write_token_file_parallel(const token_list_t *tokens,
+                                 const char *output_filename,
+                                 const scanner_ctx_t *ctx, int nthreads) {
+#if OW_HAVE_POSIX_IO
+    ow_part_t parts[OW_MAX_THREADS];
+    ow_stream_t proto;
+    int64_t offset;
+    int status = 0;
+    int append_mode;
+    int fd;
+    int n;
+    int i;
 #endif
-            current_line = tok->line;
-            first_on_line = 1;
+
+    if (tokens == NULL || output_filename == NULL || ctx == NULL) {
+        return -1;
+    }
+#if OW_HAVE_POSIX_IO
+    n = writer_thread_count(nthreads);
+    if (tl_count(tokens) / OW_PAR_MIN_TOKENS < n) {
+        n = tl_count(tokens) / OW_PAR_MIN_TOKENS;
+    }
+    if (n <= 1) {
+        return write_file_sequential(tokens, output_filename, ctx);
+    }
+
+    // Messages may already be in the file (DEBUG_ON): tokens go after them.
+    // O_APPEND is not used because it makes pwrite ignore the offset.
+    append_mode = (ctx->cfg.debug == DEBUG_ON);
+    fd = open(output_filename,
+              O_WRONLY | O_CREAT | (append_mode ? 0 : O_TRUNC), 0666);
+    if (fd < 0) {
+        return -1;
+    }
+    offset = append_mode ? (int64_t)lseek(fd, 0, SEEK_END) : 0;
+    if (offset < 0 || stream_init(&proto, NULL, fd, 0,
+                                  ctx->cfg.outformat) != 0) {
+        close(fd);
+        return -1;
+    }
+    free(proto.buf);
+    proto.buf = NULL;
+
+    n = split_parts(parts, n, tokens);
+    for (i = 0; i < n; i++) {
+        parts[i].tokens = tokens;
+        parts[i].proto = &proto;
+        parts[i].fd = fd;
+    }
+    run_parts(parts, n, part_measure);
+    for (i = 0; i < n; i++) {
+        parts[i].offset = offset;
+        offset += parts[i].size;
+    }
+    run_parts(parts, n, part_format);
+
+    for (i = 0; i < n; i++) {
+        if (parts[i].status != 0) {
+            status = -1;
+        }
+    }
+    if (close(fd) != 0) {
+        status = -1;
+    }
+    return status;
+#else
+    (void)nthreads;
+    return write_file_sequential(tokens, output_filename, ctx);
+#endif
+}
+
+// Writes the output file on one or cfg.threads threads.
+static int write_file(const token_list_t *tokens, const char *output_filename,
+                      const scanner_ctx_t *ctx) {
+    if (ctx->cfg.threads != 1) {
+        return ow_write_token_file_parallel(tokens, output_filename, ctx,
+                                            ctx->cfg.threads);
+    }
+    return write_file_sequential(tokens, output_filename, ctx);
+}
+
+// Compares the output with the file: size first, then chunk by chunk.
+int ow_output_matches(const token_list_t *tokens, const char *output_filename,
+                      const scanner_ctx_t *ctx) {
+    ow_stream_t ws;
+    int count;
+    int i;
+
+    if (tokens == NULL || output_filename == NULL || ctx == NULL) {
+        return 0;
+    }
+    count = tl_count(tokens);
+#if OW_HAVE_POSIX_IO
+    {
+        struct stat st;
+        ow_part_t whole;
+        int fd = open(output_filename, O_RDONLY);
+
+        if (fd < 0) {
+            return 0;
+        }
+        stream_setup(&ws, NULL, fd, 1, ctx->cfg.outformat);
+        whole.tokens = tokens;
+        whole.proto = &ws;
+        whole.first = 0;
+        whole.end = count;
+        whole.prev_line = -1;
+        whole.last = 1;
+        part_measure(&whole);
+        if (fstat(fd, &st) != 0 || (int64_t)st.st_size != whole.size) {
+            close(fd);
+            return 0;
+        }
+        ws.buf = (char *)malloc(OW_BUF_SIZE);
+        if (ws.buf == NULL) {
+            fprintf(stderr, "ow_output_matches: memory allocation failed\n");
+            close(fd);
+            return 0;
         }
+    }
+#else
+    {
+        // Text mode on both sides: no byte size to compare up front.
+        FILE *fp = fopen(output_filename, "r");
 
-        if (!first_on_line) {
-            fprintf(fp, " ");
+        if (fp == NULL) {
+            return 0;
+        }
+        if (stream_init(&ws, fp, -1, 1, ctx->cfg.outformat) != 0) {
+            fclose(fp);
+            return 0;
         }
-        write_token_formatted(fp, tok);
-        first_on_line = 0;
     }
+#endif
+    ws.compare = 1;
+    for (i = 0; i < count && !ws.error; i++) {
+        const token_t *tok = tl_get(tokens, i);
 
-    // Finish output line. DEBUG adds an extra separator line.
-    fprintf(fp, "\n");
-#if OUTFORMAT == OUTFORMAT_DEBUG
-    fprintf(fp, "\n");
+        ow_stream_token(&ws, tok, tl_lexeme(tokens, tok));
+    }
+#if !OW_HAVE_POSIX_IO
+    // Equal so far: the file must also end here.
+    if (!ws.error) {
+        stream_finish(&ws);
+        if (fgetc(ws.fp) != EOF) {
+            ws.error = 1;
+        }
+    }
 #endif
+    return (ow_stream_close(&ws) == 0) ? 1 : 0;
+}
+
+// Keeps an identical file; else writes "<output>.<pid>.<n>.tmp" and renames
+// it over output_filename, so readers see the old or the new file, never a
+// part, even with several writers of the same output.
+static int write_file_if_changed(const token_list_t *tokens,
+                                 const char *output_filename,
+                                 const scanner_ctx_t *ctx) {
+    size_t len;
+    char *tmp;
+    int status;
+
+    if (ow_output_matches(tokens, output_filename, ctx)) {
+        return 0;
+    }
+    len = strlen(output_filename);
+    tmp = (char *)malloc(len + OW_TMP_EXTRA);
+    if (tmp == NULL) {
+        fprintf(stderr, "write_file_if_changed: memory allocation failed\n");
+        return -1;
+    }
+    snprintf(tmp, len + OW_TMP_EXTRA, "%s.%ld.%u" OW_TMP_SUFFIX,
+             output_filename, (long)ow_getpid(),
+             atomic_fetch_add(&ow_serial, 1u));
+
+    status = write_file(tokens, tmp, ctx);
+#ifdef _WIN32
+    // rename does not replace an existing file here.
+    if (status == 0) {
+        remove(output_filename);
+    }
+#endif
+    if (status == 0 && rename(tmp, output_filename) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        remove(tmp);
+    }
+    free(tmp);
+    return status;
+}
+
+// Writes complete token output file with the settings of ctx.
+int ow_write_token_file_ctx(const token_list_t *tokens,
+                            const char *output_filename,
+                            const scanner_ctx_t *ctx) {
+    if (tokens == NULL || output_filename == NULL || ctx == NULL) {
+        return -1;
+    }
+    // DEBUG_ON output starts with the messages already in the file.
+    if (ctx->cfg.keep_unchanged && ctx->cfg.debug != DEBUG_ON) {
+        return write_file_if_changed(tokens, output_filename, ctx);
+    }
+    return write_file(tokens, output_filename, ctx);
+}
+
+// Writes the token output to an open stream in the format of ctx.
+int ow_write_token_stream_ctx(const token_list_t *tokens, FILE *fp,
+                              const scanner_ctx_t *ctx) {
+    ow_stream_t ws;
+
+    if (tokens == NULL || fp == NULL || ctx == NULL) {
+        return -1;
+    }
+    if (stream_init(&ws, fp, -1, 0, ctx->cfg.outformat) != 0) {
+        return -1;
+    }
+    if (write_all_tokens(&ws, tokens) != 0) {
+        return -1;
+    }
+    return ferror(fp) ? -1 : 0;
+}
 
-    fclose(fp);
+// Opens the session file once, buffered by the session's buffer.
+int ow_session_open(ow_session_t *s, const char *output_filename) {
+    if (s == NULL) {
+        return -1;
+    }
+    s->fp = NULL;
+    s->buf = NULL;
+    if (output_filename == NULL) {
+        return -1;
+    }
+    s->buf = (char *)malloc(OW_BUF_SIZE);
+    if (s->buf == NULL) {
+        fprintf(stderr, "ow_session_open: memory allocation failed\n");
+        return -1;
+    }
+    s->fp = fopen(output_filename, "w");
+    if (s->fp == NULL) {
+        free(s->buf);
+        s->buf = NULL;
+        return -1;
+    }
+    // On failure stdio keeps a buffer of its own; s->buf stays ours.
+    setvbuf(s->fp, s->buf, _IOFBF, OW_BUF_SIZE);
     return 0;
 }
 
+// Returns the session stream (stdout when closed).
+FILE* ow_session_file(const ow_session_t *s) {
+    if (s == NULL || s->fp == NULL) {
+        return stdout;
+    }
+    return s->fp;
+}
+
+// Writes the token lines after the buffered messages, through the session
+// stream.
+int ow_session_write_tokens(ow_session_t *s, const token_list_t *tokens,
+                            const scanner_ctx_t *ctx) {
+    ow_stream_t ws;
+    int status;
+    int i;
+
+    if (s == NULL || s->fp == NULL || tokens == NULL || ctx == NULL) {
+        return -1;
+    }
+    // Formatted chunks are fwrite()n to the session stream, whose buffer
+    // stays stdio's: messages, tokens and anything after them keep their
+    // order, and the close is the final flush.
+    if (stream_init(&ws, s->fp, -1, 0, ctx->cfg.outformat) != 0) {
+        return -1;
+    }
+    for (i = 0; i < tl_count(tokens); i++) {
+        const token_t *tok = tl_get(tokens, i);
+
+        ow_stream_token(&ws, tok, tl_lexeme(tokens, tok));
+    }
+    stream_finish(&ws);
+    status = (ws.error || ferror(s->fp)) ? -1 : 0;
+    free(ws.buf);
+    return status;
+}
+
+// Final flush and close.
+int ow_session_close(ow_session_t *s) {
+    int status = 0;
+
+    if (s == NULL || s->fp == NULL) {
+        return -1;
+    }
+    if (fclose(s->fp) != 0) {
+        status = -1;
+    }
+    free(s->buf);
+    s->fp = NULL;
+    s->buf = NULL;
+    return status;
+}
+
 int ow_write_token_file(const token_list_t *tokens, const char *output_filename) {
     return ow_write_token_file_mode(tokens, output_filename, 0);
 }
@@ -15,6 +15,13 @@
  *   - Same as RELEASE but each token line starts with the input line number.
  *   - An empty line separates each token line.
  *
+ * Tokens are formatted by hand into an OW_BUF_SIZE buffer written with one
+ * write() per fill. Large lists are cut at source-line boundaries, sized in
+ * a measure pass and pwrite()n in parallel at prefix-sum offsets. DEBUG_ON
+ * runs go through one output session (one open, one final flush).
+ * Write-if-changed compares with the existing file before writing and
+ * replaces a changed one through a unique temporary file and rename().
+ *
  * Team: Compilers P2
  * -----------------------------------------------------------------------------
  */
@@ -23,14 +30,13 @@
 #define OUT_WRITER_H
 
 #include "../token_list/token_list.h"
+#include "../scan_ctx/scan_ctx.h"
+#include <stddef.h>  // size_t
+#include <stdint.h>  // int64_t, UINT16_MAX
+#include <stdio.h>   // FILE
 
-// Output format options.
-#define OUTFORMAT_RELEASE 0
-#define OUTFORMAT_DEBUG   1
-
-#ifndef OUTFORMAT
-#define OUTFORMAT OUTFORMAT_RELEASE  // default RELEASE format
-#endif
+// OUTFORMAT_RELEASE / OUTFORMAT_DEBUG and the OUTFORMAT default live in
+// scan_ctx.h.
 
 // Token formatting delimiters.
 #define TOK_FMT_OPEN  '<'
@@ -38,6 +44,58 @@
 #define TOK_FMT_SEP   ','
 #define TOK_FMT_SPACE ' '
 
+// Output buffer bytes. Must hold the longest formatted token (16-bit
+// lexeme length) with its line break, DEBUG line prefix and category.
+#ifndef OW_BUF_SIZE
+#define OW_BUF_SIZE (256 * 1024)
+#endif
+_Static_assert(OW_BUF_SIZE >= 2 * (UINT16_MAX + 1),
+               "OW_BUF_SIZE too small for the longest token");
+
+// Output files are written through POSIX descriptors (open/write/pwrite)
+// where available, else through stdio (and never in parallel).
+#ifdef _WIN32
+#define OW_HAVE_POSIX_IO 0
+#else
+#define OW_HAVE_POSIX_IO 1
+#endif
+
+// Parallel writer: fewest tokens per part, and the thread cap.
+#define OW_PAR_MIN_TOKENS (64 * 1024)
+#define OW_MAX_THREADS    64
+
+// Write-if-changed: temporary file suffix, room for ".<pid>.<n>" plus the
+// suffix, and file read chunk in bytes.
+#define OW_TMP_SUFFIX ".tmp"
+#define OW_TMP_EXTRA  48
+#ifndef OW_CMP_CHUNK
+#define OW_CMP_CHUNK (16 * 1024)
+#endif
+
+// Incremental writer state: tokens are formatted as they arrive, so the
+// file can be written while scanning is still in progress.
+typedef struct {
+    FILE *fp;           // Output stream (NULL when writing to fd).
+    int fd;             // Output descriptor (-1 when writing to fp).
+    int64_t pos;        // pwrite offset of the next flush (-1: write()).
+    int owned;          // 1: opened by the stream, closed by ow_stream_close.
+    int error;          // 1 once a flush failed (or compared unequal).
+    int compare;        // 1: flushes compare with the file, never write.
+    int format;         // OUTFORMAT_RELEASE or OUTFORMAT_DEBUG.
+    int current_line;   // Source line of the open output line (-1: none).
+    int first_on_line;  // 1 before the first token of an output line.
+    char *buf;          // Formatted bytes not yet written (OW_BUF_SIZE).
+    size_t len;         // Bytes in buf.
+    const char *cat_name[CAT_COUNT + 1];  // Category names (last: unknown).
+    size_t cat_len[CAT_COUNT + 1];        // Their lengths.
+} ow_stream_t;
+
+// One .cscn file shared by messages, tokens and counts (DEBUG_ON).
+typedef struct {
+    FILE *fp;   // Opened once; fully buffered by buf (NULL when closed).
+    char *buf;  // Stdio buffer of fp (OW_BUF_SIZE bytes).
+} ow_session_t;
+
 // Builds output filename with .cscn pattern.
 void ow_build_output_filename(const char *input_filename, char *output_buf,
                               int buf_len);
@@ -53,4 +111,72 @@ int ow_write_token_file(const token_list_t *tokens, const char *output_filename)
 int ow_write_token_file_mode(const token_list_t *tokens,
                              const char *output_filename, int append_mode);
 
+// Writes token list in the format of ctx, appending when ctx routes
+// messages into the output file (DEBUG_ON). Uses ctx->cfg.threads writer
+// threads for large lists (ow_write_token_file_parallel). With
+// ctx->cfg.keep_unchanged (not DEBUG_ON), an identical existing file is
+// kept as is and a changed one is replaced through a unique temporary file
+// and rename.
+int ow_write_token_file_ctx(const token_list_t *tokens,
+                            const char *output_filename,
+                            const scanner_ctx_t *ctx);
+
+// Writes token list to output_filename like ow_write_token_file_ctx, on up
+// to nthreads threads (0 = one per online CPU). Lists under two parts of
+// OW_PAR_MIN_TOKENS, or builds without pwrite, are written sequentially.
+int ow_write_token_file_parallel(const token_list_t *tokens,
+                                 const char *output_filename,
+                                 const scanner_ctx_t *ctx, int nthreads);
+
+// Returns 1 when output_filename already holds exactly the output of
+// tokens in the format of ctx, else 0 (also for a missing file). Nothing
+// is written.
+int ow_output_matches(const token_list_t *tokens, const char *output_filename,
+                      const scanner_ctx_t *ctx);
+
+// Writes the token output to an already open stream (left open) in the
+// format of ctx, e.g. a socket reply buffer.
+int ow_write_token_stream_ctx(const token_list_t *tokens, FILE *fp,
+                              const scanner_ctx_t *ctx);
+
+// Opens output_filename for streaming (append or overwrite) in the
+// OUTFORMAT format. Returns 0 on success, -1 if the file cannot be opened.
+int ow_stream_open(ow_stream_t *ws, const char *output_filename,
+                   int append_mode);
+
+// Same as ow_stream_open with the format and append mode of ctx.
+int ow_stream_open_ctx(ow_stream_t *ws, const char *output_filename,
+                       const scanner_ctx_t *ctx);
+
+// Writes one token with its lexeme, starting a new output line whenever the
+// source line changes.
+void ow_stream_token(ow_stream_t *ws, const token_t *tok, lexeme_view_t lex);
+
+// Ends the open output line now (the next token starts a new one) and
+// writes everything buffered, so readers of the file see whole lines.
+// Returns 0, or -1 once any write failed.
+int ow_stream_flush_line(ow_stream_t *ws);
+
+// Finishes the last output line, writes the buffer and closes the file.
+// Returns 0, or -1 when any write failed.
+int ow_stream_close(ow_stream_t *ws);
+
+// Opens output_filename (overwrite) for a session. Returns 0, or -1 when
+// the file cannot be opened.
+int ow_session_open(ow_session_t *s, const char *output_filename);
+
+// Returns the session stream to route messages to (logger_init_dest,
+// err_report).
+FILE* ow_session_file(const ow_session_t *s);
+
+// Writes the token lines after the messages written so far, in the format
+// of ctx, through the session stream (more may follow before the close).
+// Returns 0, or -1 when a write failed.
+int ow_session_write_tokens(ow_session_t *s, const token_list_t *tokens,
+                            const scanner_ctx_t *ctx);
+
+// Flushes and closes the file. Returns 0, or -1 when the final flush or
+// close failed.
+int ow_session_close(ow_session_t *s);
+
 #endif /* OUT_WRITER_H */
@@ -0,0 +1,246 @@
+/*
+ * -----------------------------------------------------------------------------
+ * pipeline.c
+ *
+ * SPSC token ring and the scanner -> writer pipeline. Waiting sides yield
+ * the CPU after a short spin so the pipeline also behaves on one core.
+ * Also the single-threaded line-streaming scan.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#include "pipeline.h"
+#include <pthread.h>  // pthread_create, pthread_join
+#include <sched.h>    // sched_yield
+#include <stdlib.h>   // malloc, free
+#include <stdio.h>    // fprintf, stderr
+
+// Busy polls before a waiting side yields its time slice.
+#define SPSC_SPIN 64
+
+// Writer thread arguments and result.
+typedef struct {
+    spsc_ring_t *ring;            // Token source.
+    const char *output_filename;  // .cscn path.
+    const scanner_ctx_t *ctx;     // Output format and mode.
+    int status;                   // 0 on success, -1 on output failure.
+} pipe_writer_t;
+
+// Spins briefly, then yields.
+static void spsc_wait(int *spins) {
+    if (++(*spins) >= SPSC_SPIN) {
+        sched_yield();
+        *spins = 0;
+    }
+}
+
+// Sets both indices to zero and opens the ring.
+void spsc_init(spsc_ring_t *ring) {
+    if (ring == NULL) {
+        return;
+    }
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->closed, 0);
+    ring->head_cache = 0;
+    ring->tail_cache = 0;
+}
+
+// Producer: waits for a free slot, fills it, then publishes it.
+void spsc_push(spsc_ring_t *ring, const spsc_item_t *item) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    int spins = 0;
+
+    while (tail - ring->head_cache >= SPSC_RING_SIZE) {
+        ring->head_cache = atomic_load_explicit(&ring->head,
+                                                memory_order_acquire);
+        if (tail - ring->head_cache >= SPSC_RING_SIZE) {
+            spsc_wait(&spins);
+        }
+    }
+    ring->items[tail & SPSC_RING_MASK] = *item;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+// Producer: no more items will follow.
+void spsc_close(spsc_ring_t *ring) {
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+}
+
+// Consumer: waits for a published slot or for close on an empty ring.
+int spsc_pop(spsc_ring_t *ring, spsc_item_t *item) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    int spins = 0;
+
+    while (head == ring->tail_cache) {
+        // Read closed before tail: a close seen here covers every push.
+        int closed = atomic_load_explicit(&ring->closed, memory_order_acquire);
+
+        ring->tail_cache = atomic_load_explicit(&ring->tail,
+                                                memory_order_acquire);
+        if (head != ring->tail_cache) {
+            break;
+        }
+        if (closed) {
+            return 0;
+        }
+        spsc_wait(&spins);
+    }
+    *item = ring->items[head & SPSC_RING_MASK];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 1;
+}
+
+// Writer stage: streams popped tokens to the output file. On open failure
+// it keeps draining so the scanner never blocks.
+static void* pipe_writer_main(void *arg) {
+    pipe_writer_t *writer = (pipe_writer_t *)arg;
+    ow_stream_t ws;
+    spsc_item_t item;
+    int open_ok;
+
+    open_ok = (ow_stream_open_ctx(&ws, writer->output_filename,
+                                  writer->ctx) == 0);
+    while (spsc_pop(writer->ring, &item)) {
+        if (open_ok) {
+            ow_stream_token(&ws, item.tok, item.lex);
+        }
+    }
+    writer->status = (open_ok && ow_stream_close(&ws) == 0) ? 0 : -1;
+    return NULL;
+}
+
+// Scanner stage on this thread, writer stage on a second one.
+int pipeline_run(char_stream_t *cs, token_list_t *tokens, scanner_ctx_t *ctx,
+                 const char *output_filename, int *write_status) {
+    spsc_ring_t *ring;
+    counter_t *cnt;
+    pipe_writer_t writer;
+    pthread_t thread;
+    int pushed = 0;
+
+    if (write_status != NULL) {
+        *write_status = -1;
+    }
+    if (cs == NULL || tokens == NULL || ctx == NULL ||
+        output_filename == NULL) {
+        return -1;
+    }
+    cnt = scanner_ctx_counter(ctx);
+
+    ring = (spsc_ring_t *)malloc(sizeof(spsc_ring_t));
+    if (ring == NULL) {
+        fprintf(stderr, "pipeline_run: memory allocation failed\n");
+        return -1;
+    }
+    spsc_init(ring);
+    writer.ring = ring;
+    writer.output_filename = output_filename;
+    writer.ctx = ctx;
+    writer.status = -1;
+
+    if (pthread_create(&thread, NULL, pipe_writer_main, &writer) != 0) {
+        // No second thread: run the stages one after the other.
+        free(ring);
+        automata_scan_engine(cs, tokens, &ctx->lg, cnt, ctx->cfg.engine);
+        if (write_status != NULL) {
+            *write_status = ow_write_token_file_ctx(tokens, output_filename,
+                                                    ctx);
+        }
+        return 0;
+    }
+
+    while (automata_scan_next(cs, tokens, &ctx->lg, cnt, ctx->cfg.engine)) {
+        // Hand over every token appended by this step.
+        for (; pushed < tl_count(tokens); pushed++) {
+            spsc_item_t item;
+
+            item.tok = tl_get(tokens, pushed);
+            item.lex = tl_lexeme(tokens, item.tok);
+            spsc_push(ring, &item);
+        }
+    }
+    spsc_close(ring);
+    pthread_join(thread, NULL);
+    free(ring);
+
+    if (write_status != NULL) {
+        *write_status = writer.status;
+    }
+    return 0;
+}
+
+// Scanner and writer interleaved on this thread, one source line at a time.
+int pipeline_stream(char_stream_t *cs, token_list_t *tokens,
+                    scanner_ctx_t *ctx, const char *output_filename,
+                    int *write_status, int *count) {
+    ow_stream_t ws;
+    counter_t *cnt;
+    int open_ok;
+    int line = -1;
+    int total = 0;
+    int i = 0;
+
+    if (write_status != NULL) {
+        *write_status = -1;
+    }
+    if (count != NULL) {
+        *count = 0;
+    }
+    if (cs == NULL || tokens == NULL || ctx == NULL ||
+        output_filename == NULL) {
+        return -1;
+    }
+    cnt = scanner_ctx_counter(ctx);
+    tl_clear(tokens);
+
+    // On open failure the scan still runs so messages and counts are kept.
+    open_ok = (ow_stream_open_ctx(&ws, output_filename, ctx) == 0);
+    while (automata_scan_next(cs, tokens, &ctx->lg, cnt, ctx->cfg.engine)) {
+        const token_t *tok = tl_get(tokens, tl_count(tokens) - 1);
+        int tok_line = token_line(tok);
+
+        if (tok_line != line && line != -1) {
+            // Every earlier token is formatted: end the line on disk and
+            // recycle its storage, keeping the token that opened this one.
+            token_t next = *tok;
+            lexeme_view_t lex = tl_lexeme(tokens, tok);
+
+            for (; i < tl_count(tokens) - 1; i++) {
+                if (open_ok) {
+                    const token_t *prev = tl_get(tokens, i);
+
+                    ow_stream_token(&ws, prev, tl_lexeme(tokens, prev));
+                }
+            }
+            if (open_ok) {
+                ow_stream_flush_line(&ws);
+                ow_stream_token(&ws, &next, lex);
+            }
+            total += tl_count(tokens);
+            tl_clear(tokens);
+            i = 0;
+        }
+        line = tok_line;
+    }
+    for (; i < tl_count(tokens); i++) {
+        if (open_ok) {
+            const token_t *tok = tl_get(tokens, i);
+
+            ow_stream_token(&ws, tok, tl_lexeme(tokens, tok));
+        }
+    }
+    total += tl_count(tokens);
+    tl_clear(tokens);
+
+    if (write_status != NULL) {
+        *write_status = (open_ok && ow_stream_close(&ws) == 0) ? 0 : -1;
+    } else if (open_ok) {
+        ow_stream_close(&ws);
+    }
+    if (count != NULL) {
+        *count = total;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * -----------------------------------------------------------------------------
+ * pipeline.h
+ *
+ * Pipelined scan: the scanner runs on the calling thread and pushes every
+ * token it appends into a bounded lock-free single-producer/single-consumer
+ * ring; a writer thread pops them and streams the .cscn file (ow_stream_*)
+ * while scanning continues. Wall-clock time approaches the slower stage
+ * instead of the sum of both. A later parser stage gets its own ring.
+ *
+ * Ring items carry the token pointer (stable: token_list never moves
+ * tokens) and its lexeme view, resolved by the producer, so the consumer
+ * never touches the growing list.
+ *
+ * Streaming scan (pipeline_stream): one thread, no retained tokens. Tokens
+ * are formatted as they are scanned; when the scanner reaches a new source
+ * line, the finished output line is ended and written and the token list
+ * is recycled (tl_clear). Token memory stays constant in the file size and
+ * the .cscn grows line by line while the scan runs.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "../automata/automata.h"
+#include "../out_writer/out_writer.h"
+
+#include <stdatomic.h>  // atomic_size_t, atomic_int
+#include <stddef.h>     // size_t
+
+// Ring capacity in tokens (power of two) and cache line padding.
+#define SPSC_RING_SIZE  4096
+#define SPSC_RING_MASK  (SPSC_RING_SIZE - 1)
+#define SPSC_CACHE_LINE 64
+
+_Static_assert((SPSC_RING_SIZE & SPSC_RING_MASK) == 0,
+               "SPSC_RING_SIZE must be a power of two");
+
+// One token handed from scanner to consumer.
+typedef struct {
+    const token_t *tok;  // Token inside the producer's list.
+    lexeme_view_t lex;   // Its lexeme.
+} spsc_item_t;
+
+// Bounded single-producer/single-consumer ring. tail is only written by the
+// producer, head only by the consumer; each side caches the other's index.
+typedef struct {
+    spsc_item_t items[SPSC_RING_SIZE];
+    atomic_size_t tail;     // Next slot the producer fills.
+    size_t head_cache;      // Producer's last view of head.
+    char pad_tail[SPSC_CACHE_LINE];
+    atomic_size_t head;     // Next slot the consumer reads.
+    size_t tail_cache;      // Consumer's last view of tail.
+    char pad_head[SPSC_CACHE_LINE];
+    atomic_int closed;      // Set by the producer after the last push.
+} spsc_ring_t;
+
+// Initializes an empty ring.
+void spsc_init(spsc_ring_t *ring);
+
+// Pushes one item, waiting while the ring is full (producer only).
+void spsc_push(spsc_ring_t *ring, const spsc_item_t *item);
+
+// Marks the end of the stream (producer only).
+void spsc_close(spsc_ring_t *ring);
+
+// Pops one item, waiting while the ring is empty. Returns 0 once the ring
+// is closed and drained (consumer only).
+int spsc_pop(spsc_ring_t *ring, spsc_item_t *item);
+
+// Scans cs into tokens while a writer thread streams them to
+// output_filename, both with the settings of ctx. Returns the scan result;
+// *write_status receives 0, or -1 when the output could not be written.
+int pipeline_run(char_stream_t *cs, token_list_t *tokens, scanner_ctx_t *ctx,
+                 const char *output_filename, int *write_status);
+
+// Scans cs and writes every finished source line to output_filename as
+// soon as the scanner moves past it, with the settings of ctx. tokens is
+// scratch storage (recycled per line, empty on return). Returns the scan
+// result; *write_status receives 0, or -1 when the output could not be
+// written, and *count the number of tokens scanned.
+int pipeline_stream(char_stream_t *cs, token_list_t *tokens,
+                    scanner_ctx_t *ctx, const char *output_filename,
+                    int *write_status, int *count);
+
+#endif /* PIPELINE_H */
@@ -0,0 +1,60 @@
+/*
+ * -----------------------------------------------------------------------------
+ * scan_ctx.c
+ *
+ * Scanner configuration defaults and context setup.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#include "scan_ctx.h"
+#include <stddef.h>  // NULL
+
+// Copies the compile-time flags.
+void scanner_config_default(scanner_config_t *cfg) {
+    if (cfg == NULL) {
+        return;
+    }
+    cfg->outformat = OUTFORMAT;
+    cfg->debug = DEBUG_FLAG;
+#ifdef COUNTCONFIG
+    cfg->count = 1;
+#else
+    cfg->count = 0;
+#endif
+    cfg->countout = COUNTOUT;
+    cfg->countfile = COUNTFILE;
+    cfg->engine = SCAN_ENGINE;
+    cfg->threads = SCAN_THREADS;
+    cfg->split = SCAN_SPLIT;
+    cfg->pipeline = SCAN_PIPELINE;
+    cfg->stream = SCAN_STREAM;
+    cfg->cache_dir = SCAN_CACHE ? SCAN_CACHE_DIR : NULL;
+    cfg->ctok = SCAN_CTOK;
+    cfg->keep_unchanged = SCAN_KEEP_UNCHANGED;
+}
+
+// Sets config, destinations and zeroed counters.
+void scanner_ctx_init(scanner_ctx_t *ctx, const scanner_config_t *cfg,
+                      FILE *out) {
+    if (ctx == NULL) {
+        return;
+    }
+    if (cfg != NULL) {
+        ctx->cfg = *cfg;
+    } else {
+        scanner_config_default(&ctx->cfg);
+    }
+    ctx->out = (out != NULL) ? out : stdout;
+    logger_init_dest(&ctx->lg, ctx->out);
+    counter_init(&ctx->cnt);
+}
+
+// Returns &ctx->cnt when this scan counts.
+counter_t* scanner_ctx_counter(scanner_ctx_t *ctx) {
+    if (ctx == NULL || !ctx->cfg.count) {
+        return NULL;
+    }
+    return &ctx->cnt;
+}
@@ -0,0 +1,133 @@
+/*
+ * -----------------------------------------------------------------------------
+ * scan_ctx.h
+ *
+ * Scanner configuration and per-scan context.
+ *
+ * The compile-time flags (OUTFORMAT, DEBUG_FLAG, COUNTCONFIG, SCAN_*) only
+ * provide defaults: scanner_config_default copies them into a
+ * scanner_config_t, and a scanner_ctx_t carries that config together with
+ * the destinations and counters of one scan. Every function taking a
+ * context reads its settings from there, so scans with different settings
+ * can run side by side in one process, on any number of threads.
+ *
+ * COUNTCONFIG still decides whether counting code is compiled in at all;
+ * cfg.count switches it per scan in such builds.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#ifndef SCAN_CTX_H
+#define SCAN_CTX_H
+
+#include "../logger/logger.h"
+#include "../counter/counter.h"
+#include <stdio.h>  // FILE
+
+// DFA engine used by the scan loop.
+typedef enum {
+    SCAN_ENGINE_MATRIX = 0,  // class map + T[state][class]
+    SCAN_ENGINE_FUSED  = 1,  // FT[state][byte] + accept bitmask
+    SCAN_ENGINE_TRIE   = 2   // KT[state][byte] with keyword trie states
+} scan_engine_t;
+
+// Default engine for automata_scan (compile-time).
+#ifndef SCAN_ENGINE
+#define SCAN_ENGINE SCAN_ENGINE_MATRIX
+#endif
+
+// Scanner threads for automata_scan_parallel (compile-time). 0 = one per
+// online CPU, 1 = always sequential.
+#ifndef SCAN_THREADS
+#define SCAN_THREADS 0
+#endif
+
+// Chunking strategy used by the driver (compile-time).
+#define SCAN_SPLIT_NEWLINE     0  // automata_scan_parallel
+#define SCAN_SPLIT_SPECULATIVE 1  // automata_scan_speculative
+#ifndef SCAN_SPLIT
+#define SCAN_SPLIT SCAN_SPLIT_NEWLINE
+#endif
+
+// Pipeline mode for the driver (compile-time): 1 = scanner and writer run
+// concurrently (only when scanner messages do not share the output file).
+#ifndef SCAN_PIPELINE
+#define SCAN_PIPELINE 0
+#endif
+
+// Streaming output for the driver (compile-time): 1 = write each finished
+// source line while scanning and recycle its tokens (pipeline_stream; only
+// when scanner messages do not share the output file).
+#ifndef SCAN_STREAM
+#define SCAN_STREAM 0
+#endif
+
+// Token cache for the driver (compile-time): 1 = reuse the stored tokens of
+// unchanged inputs from SCAN_CACHE_DIR (token_cache module).
+#ifndef SCAN_CACHE
+#define SCAN_CACHE 0
+#endif
+#ifndef SCAN_CACHE_DIR
+#define SCAN_CACHE_DIR ".cscn_cache"
+#endif
+
+// Binary token file for the driver (compile-time): 1 = also write the token
+// list to "<input>tok" (token_io module) for later phases to map.
+#ifndef SCAN_CTOK
+#define SCAN_CTOK 0
+#endif
+
+// Write-if-changed output for the driver (compile-time): 1 = keep a .cscn
+// file whose contents would not change, replace others atomically (only
+// when scanner messages do not share the output file; the whole list is
+// written after the scan, so pipeline and streaming modes are off).
+#ifndef SCAN_KEEP_UNCHANGED
+#define SCAN_KEEP_UNCHANGED 0
+#endif
+
+// Output format options.
+#define OUTFORMAT_RELEASE 0
+#define OUTFORMAT_DEBUG   1
+
+#ifndef OUTFORMAT
+#define OUTFORMAT OUTFORMAT_RELEASE  // default RELEASE format
+#endif
+
+// Settings of one scan.
+typedef struct {
+    int outformat;  // OUTFORMAT_RELEASE or OUTFORMAT_DEBUG.
+    int debug;      // DEBUG_ON: messages go to the output file.
+    int count;      // 1: collect operation counts (COUNTCONFIG builds).
+    int countout;   // COUNTOUT_STDOUT or COUNTOUT_OUT.
+    int countfile;  // COUNTFILE_DBGCNT or COUNTFILE_OUTPUT.
+    scan_engine_t engine;  // DFA engine.
+    int threads;    // Scanner threads per input (0 = one per online CPU).
+    int split;      // SCAN_SPLIT_NEWLINE or SCAN_SPLIT_SPECULATIVE.
+    int pipeline;   // 1: write the output while scanning.
+    int stream;     // 1: write and drop each finished line while scanning.
+    const char *cache_dir;  // Token cache directory (NULL = no cache).
+    int ctok;       // 1: also write the binary .ctok token file.
+    int keep_unchanged;  // 1: leave identical .cscn files untouched.
+} scanner_config_t;
+
+// One scan: its settings, destinations and counters.
+typedef struct {
+    scanner_config_t cfg;  // Settings.
+    FILE *out;             // Console lines (progress, summaries).
+    logger_t lg;           // Scanner and driver messages.
+    counter_t cnt;         // Operation counts.
+} scanner_ctx_t;
+
+// Fills cfg from the compile-time flags.
+void scanner_config_default(scanner_config_t *cfg);
+
+// Initializes ctx with a copy of cfg (NULL = defaults). Console lines and
+// messages go to out (NULL = stdout); counters start at zero.
+void scanner_ctx_init(scanner_ctx_t *ctx, const scanner_config_t *cfg,
+                      FILE *out);
+
+// Returns the counters to update, or NULL when counting is off.
+counter_t* scanner_ctx_counter(scanner_ctx_t *ctx);
+
+#endif /* SCAN_CTX_H */
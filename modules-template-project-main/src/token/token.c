@@ -3,7 +3,8 @@
  * token.c
  *
  * Token data object implementation.
- * Copies the lexeme character-by-character (no string library for recognition).
+ * Tokens only carry a lexeme handle; lexeme bytes live in the token list's
+ * lexeme store or in the source buffer.
  *
  * Team: Compilers P2
  * -----------------------------------------------------------------------------
@@ -12,29 +13,17 @@
 #include "token.h"
 #include <stddef.h>
 
-// Initializes token fields and copies lexeme content into owned storage.
-void token_init(token_t *tok, const char *lexeme, token_category_t cat,
-                int line, int col) {
-    int i = 0;
-
+// Initializes token fields.
+void token_init(token_t *tok, uint32_t lexeme, int length, int flags,
+                token_category_t cat, int line, int col) {
     if (tok == NULL) {
         return;
     }
 
-    if (lexeme == NULL) {
-        tok->lexeme[0] = '\0';
-        tok->category = cat;
-        tok->line = line;
-        tok->col = col;
-        return;
-    }
-
-    while (lexeme[i] != '\0' && i < MAX_LEXEME_LEN - 1) {
-        tok->lexeme[i] = lexeme[i];
-        i++;
-    }
-    tok->lexeme[i] = '\0';
-    tok->category = cat;
-    tok->line = line;
-    tok->col = col;
+    tok->lexeme = lexeme;
+    tok->line = (uint32_t)line;
+    tok->col = (uint32_t)col;
+    tok->length = (uint16_t)length;
+    tok->category = (uint8_t)cat;
+    tok->flags = (uint8_t)flags;
 }
@@ -6,6 +6,11 @@
  * optional metadata (source line, column).
  * Pure data object — no I/O in this module.
  *
+ * Layout: 16 bytes. The lexeme is stored out of line; the token keeps a
+ * 32-bit handle that the owning token list resolves (tl_lexeme) either in
+ * its lexeme store or, for TOKEN_FLAG_SOURCE tokens, in the attached source.
+ * Fields are read through the token_* accessors.
+ *
  * Team: Compilers P2
  * -----------------------------------------------------------------------------
  */
@@ -14,17 +19,56 @@
 #define TOKEN_H
 
 #include "../lang_spec/lang_spec.h"
+#include <stdint.h>  // uint32_t, uint16_t, uint8_t
+
+// Token flags.
+#define TOKEN_FLAG_SOURCE 0x01  // Handle is an offset into the list source.
+
+// Largest lexeme handle (byte offset) a token can hold.
+#define TOKEN_HANDLE_MAX UINT32_MAX
 
 // Token payload and source coordinates.
 typedef struct {
-    char lexeme[MAX_LEXEME_LEN]; // Token lexeme string.
-    token_category_t category;   // Token category.
-    int line;                    // Source 1-based line.
-    int col;                     // Source 1-based column.
+    uint32_t lexeme;    // Lexeme handle (byte offset in store or source).
+    uint32_t line;      // Source 1-based line.
+    uint32_t col;       // Source 1-based column.
+    uint16_t length;    // Lexeme length in bytes.
+    uint8_t category;   // token_category_t value.
+    uint8_t flags;      // TOKEN_FLAG_* bits.
 } token_t;
 
-// Initializes one token.
-void token_init(token_t *tok, const char *lexeme, token_category_t cat,
-                int line, int col);
+_Static_assert(sizeof(token_t) == 16, "token_t must stay 16 bytes");
+_Static_assert(MAX_LEXEME_LEN - 1 <= UINT16_MAX, "lexeme length must fit uint16_t");
+_Static_assert(CAT_COUNT <= UINT8_MAX, "category must fit uint8_t");
+
+// Read-only lexeme view. Not NUL-terminated for source spans.
+typedef struct {
+    const char *data;  // First lexeme byte.
+    int len;           // Lexeme length in bytes.
+} lexeme_view_t;
+
+// Initializes one token from a lexeme handle.
+void token_init(token_t *tok, uint32_t lexeme, int length, int flags,
+                token_category_t cat, int line, int col);
+
+// Returns token category.
+static inline token_category_t token_category(const token_t *tok) {
+    return (token_category_t)tok->category;
+}
+
+// Returns source 1-based line.
+static inline int token_line(const token_t *tok) {
+    return (int)tok->line;
+}
+
+// Returns source 1-based column.
+static inline int token_col(const token_t *tok) {
+    return (int)tok->col;
+}
+
+// Returns lexeme length in bytes.
+static inline int token_length(const token_t *tok) {
+    return (int)tok->length;
+}
 
 #endif /* TOKEN_H */
@@ -0,0 +1,527 @@
+/*
+ * -----------------------------------------------------------------------------
+ * token_cache.c
+ *
+ * On-disk token cache implementation: content/spec hashing, entry store
+ * (temporary file + rename) and entry load into an arena-backed token list.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#include "token_cache.h"
+#include "../automata/automata.h"
+#include "../char_stream/char_stream.h"
+#include "../error_mod/error_mod.h"
+
+#include <errno.h>        // errno, EEXIST
+#include <inttypes.h>     // PRIx64
+#include <limits.h>       // UCHAR_MAX
+#include <stdatomic.h>    // atomic_uint
+#include <stdlib.h>       // malloc, realloc, free
+#include <string.h>       // memcpy, memcmp, strlen
+#include <sys/stat.h>     // mkdir, fstat
+#ifdef _WIN32
+#include <direct.h>       // _mkdir
+#include <process.h>      // _getpid
+#define tc_mkdir(path) _mkdir(path)
+#define tc_getpid()    _getpid()
+#else
+#include <unistd.h>       // getpid
+#define tc_mkdir(path) mkdir((path), 0777)
+#define tc_getpid()    getpid()
+#endif
+
+// XXH64 primes.
+#define TC_PRIME1 0x9E3779B185EBCA87ULL
+#define TC_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define TC_PRIME3 0x165667B19E3779F9ULL
+#define TC_PRIME4 0x85EBCA77C2B2AE63ULL
+#define TC_PRIME5 0x27D4EB2F165667C5ULL
+
+// Bytes consumed per XXH64 stripe (four 8-byte lanes).
+#define TC_STRIPE 32
+
+// Spec description buffer size (comfortably above the current spec).
+#define TC_SPEC_BUF 4096
+
+// Initial message buffer size.
+#define TC_MSG_INIT 256
+
+// Serial number of temporary entry files written by this process.
+static atomic_uint tc_serial;
+
+// Rotates x left by r bits.
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Reads 8 bytes (unaligned).
+static inline uint64_t read64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Reads 4 bytes (unaligned).
+static inline uint32_t read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// One lane update.
+static inline uint64_t hash_round(uint64_t acc, uint64_t input) {
+    acc += input * TC_PRIME2;
+    acc = rotl64(acc, 31);
+    return acc * TC_PRIME1;
+}
+
+// Folds one lane into the final accumulator.
+static inline uint64_t hash_merge(uint64_t acc, uint64_t lane) {
+    acc ^= hash_round(0, lane);
+    return acc * TC_PRIME1 + TC_PRIME4;
+}
+
+// Hashes len bytes: four independent lanes over 32-byte stripes, then the
+// tail 8, 4 and 1 bytes at a time.
+uint64_t tc_hash64(const void *data, size_t len, uint64_t seed) {
+    const unsigned char *p = (const unsigned char *)data;
+    size_t rem = (data != NULL) ? len : 0;
+    uint64_t h;
+
+    if (rem >= TC_STRIPE) {
+        uint64_t v1 = seed + TC_PRIME1 + TC_PRIME2;
+        uint64_t v2 = seed + TC_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - TC_PRIME1;
+
+        do {
+            v1 = hash_round(v1, read64(p));
+            v2 = hash_round(v2, read64(p + 8));
+            v3 = hash_round(v3, read64(p + 16));
+            v4 = hash_round(v4, read64(p + 24));
+            p += TC_STRIPE;
+            rem -= TC_STRIPE;
+        } while (rem >= TC_STRIPE);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = hash_merge(h, v1);
+        h = hash_merge(h, v2);
+        h = hash_merge(h, v3);
+        h = hash_merge(h, v4);
+    } else {
+        h = seed + TC_PRIME5;
+    }
+
+    h += (uint64_t)((data != NULL) ? len : 0);
+    for (; rem >= 8; rem -= 8, p += 8) {
+        h ^= hash_round(0, read64(p));
+        h = rotl64(h, 27) * TC_PRIME1 + TC_PRIME4;
+    }
+    if (rem >= 4) {
+        h ^= (uint64_t)read32(p) * TC_PRIME1;
+        h = rotl64(h, 23) * TC_PRIME2 + TC_PRIME3;
+        p += 4;
+        rem -= 4;
+    }
+    for (; rem > 0; rem--, p++) {
+        h ^= (uint64_t)(*p) * TC_PRIME5;
+        h = rotl64(h, 11) * TC_PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= TC_PRIME2;
+    h ^= h >> 29;
+    h *= TC_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Byte description of the language spec, hashed by tc_spec_hash.
+typedef struct {
+    unsigned char bytes[TC_SPEC_BUF];
+    size_t len;
+} spec_buf_t;
+
+// Appends len bytes to the description (truncated when full).
+static void spec_put(spec_buf_t *b, const void *data, size_t len) {
+    if (len > TC_SPEC_BUF - b->len) {
+        len = TC_SPEC_BUF - b->len;
+    }
+    memcpy(b->bytes + b->len, data, len);
+    b->len += len;
+}
+
+// Appends one int.
+static void spec_put_int(spec_buf_t *b, int v) {
+    spec_put(b, &v, sizeof(v));
+}
+
+// X-macro adapters for the lang_spec lists. Strings keep their NUL as a
+// separator.
+#define TC_SPEC_STR(b, s) spec_put((b), (s), sizeof(s));
+#define TC_SPEC_CH(b, c)  spec_put_int((b), (c));
+
+// Hashes the language spec, the DFA built on it and the message texts a
+// hit replays.
+uint64_t tc_spec_hash(void) {
+    spec_buf_t b;
+    int cat;
+    int ch;
+    int st;
+    int cc;
+    int id;
+
+    b.len = 0;
+    spec_put_int(&b, TC_VERSION);
+    spec_put_int(&b, MAX_LEXEME_LEN);
+    spec_put_int(&b, CAT_COUNT);
+    for (cat = 0; cat < CAT_COUNT; cat++) {
+        const char *name = ls_get_category_name((token_category_t)cat);
+        spec_put(&b, name, strlen(name) + 1);
+    }
+    LS_KEYWORD_LIST(TC_SPEC_STR, &b)
+    LS_OPERATOR_LIST(TC_SPEC_CH, &b)
+    LS_SPECIAL_LIST(TC_SPEC_CH, &b)
+    LS_WHITESPACE_LIST(TC_SPEC_CH, &b)
+    spec_put_int(&b, LIT_QUOTE);
+    for (ch = 0; ch <= UCHAR_MAX; ch++) {
+        spec_put_int(&b, (int)classify_char(ch));
+    }
+    spec_put_int(&b, (int)classify_char(CS_EOF));
+    spec_put_int(&b, ST_COUNT);
+    spec_put_int(&b, CC_COUNT);
+    for (st = 0; st < ST_COUNT; st++) {
+        for (cc = 0; cc < CC_COUNT; cc++) {
+            spec_put_int(&b, (int)automata_next_state((scan_state_t)st,
+                                                      (char_class_t)cc));
+        }
+        spec_put_int(&b, automata_state_category((scan_state_t)st));
+    }
+    spec_put_int(&b, ERR_ID_COUNT);
+    for (id = 0; id < ERR_ID_COUNT; id++) {
+        const char *msg = err_get_message(id);
+        spec_put(&b, msg, strlen(msg) + 1);
+    }
+    spec_put(&b, ERR_FMT_CONTEXT, sizeof(ERR_FMT_CONTEXT));
+    spec_put(&b, ERR_FMT, sizeof(ERR_FMT));
+
+    return tc_hash64(b.bytes, b.len, TC_HASH_SEED);
+}
+
+// Formats <dir>/<content><spec>.ctc.
+int tc_entry_path(const token_cache_t *tc, const tc_key_t *key, char *buf,
+                  size_t size) {
+    int n;
+
+    if (tc == NULL || key == NULL || buf == NULL) {
+        return -1;
+    }
+    n = snprintf(buf, size, "%s/%016" PRIx64 "%016" PRIx64 "%s",
+                 tc->dir, key->content, key->spec, TC_SUFFIX);
+
+    return (n < 0 || (size_t)n >= size) ? -1 : 0;
+}
+
+// Remembers dir and creates it when missing.
+int tc_open(token_cache_t *tc, const char *dir) {
+    size_t len;
+
+    if (tc == NULL) {
+        return -1;
+    }
+    tc->enabled = 0;
+    tc->dir[0] = '\0';
+    tc->spec = 0;
+    tc->capture = NULL;
+    tc->msgs = NULL;
+    tc->msg_len = 0;
+    tc->msg_cap = 0;
+
+    if (dir == NULL || dir[0] == '\0') {
+        return -1;
+    }
+    len = strlen(dir);
+    if (len >= TC_PATH_MAX) {
+        return -1;
+    }
+    if (tc_mkdir(dir) != 0 && errno != EEXIST) {
+        return -1;
+    }
+
+    memcpy(tc->dir, dir, len + 1);
+    tc->spec = tc_spec_hash();
+    tc->enabled = 1;
+    return 0;
+}
+
+// Hashes the input bytes.
+void tc_key(const token_cache_t *tc, tc_key_t *key, const char *data,
+            size_t len) {
+    if (key == NULL) {
+        return;
+    }
+    key->content = tc_hash64(data, len, TC_HASH_SEED);
+    key->spec = (tc != NULL) ? tc->spec : tc_spec_hash();
+    key->length = (uint64_t)len;
+}
+
+// Returns 1 when every stored token is a valid span of the lexeme blob.
+static int entry_tokens_valid(const token_t *toks, uint32_t count,
+                              uint32_t lex_len) {
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        if (toks[i].flags != TOKEN_FLAG_SOURCE ||
+            toks[i].category >= CAT_COUNT ||
+            toks[i].lexeme > lex_len ||
+            toks[i].length > lex_len - toks[i].lexeme) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Reads and validates the entry for key, then fills tokens from it.
+int tc_load(const token_cache_t *tc, const tc_key_t *key,
+            token_list_t *tokens, arena_t *arena, FILE *msg_dest,
+            int *result) {
+    char path[TC_PATH_MAX];
+    tc_header_t h;
+    const token_t *toks;
+    const char *blob;
+    unsigned char *mem;
+    struct stat st;
+    uint64_t payload;
+    size_t size;
+    FILE *fp;
+    uint32_t i;
+
+    if (tc == NULL || !tc->enabled || key == NULL || tokens == NULL ||
+        arena == NULL || tc_entry_path(tc, key, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return -1;
+    }
+    if (fread(&h, sizeof(h), 1, fp) != 1 ||
+        memcmp(h.magic, TC_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != TC_VERSION || h.key.content != key->content ||
+        h.key.spec != key->spec || h.key.length != key->length) {
+        fclose(fp);
+        return -1;
+    }
+
+    // The header sizes come from the file itself: they must account for
+    // its exact length before anything is allocated from them.
+    payload = (uint64_t)h.count * sizeof(token_t) + h.lex_len + h.msg_len;
+    if (fstat(fileno(fp), &st) != 0 || st.st_size < 0 ||
+        (uint64_t)st.st_size != sizeof(tc_header_t) + payload ||
+        payload > (uint64_t)SIZE_MAX) {
+        fclose(fp);
+        return -1;
+    }
+    size = (size_t)payload;
+    mem = (unsigned char *)arena_alloc(arena, (size > 0) ? size : 1);
+    if (mem == NULL) {
+        fclose(fp);
+        return -1;
+    }
+    // The entry must end exactly after the message text.
+    if (fread(mem, 1, size, fp) != size || fgetc(fp) != EOF) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    toks = (const token_t *)mem;
+    blob = (const char *)mem + (size_t)h.count * sizeof(token_t);
+    if (!entry_tokens_valid(toks, h.count, h.lex_len)) {
+        return -1;
+    }
+
+    tl_set_source(tokens, blob, h.lex_len);
+    for (i = 0; i < h.count; i++) {
+        tl_add(tokens, &toks[i]);
+    }
+    if (h.msg_len > 0 && msg_dest != NULL) {
+        fwrite(blob + h.lex_len, 1, h.msg_len, msg_dest);
+    }
+    if (result != NULL) {
+        *result = h.result;
+    }
+    return 0;
+}
+
+// Rewinds the per-worker capture file (created on first use).
+FILE* tc_capture_begin(token_cache_t *tc) {
+    if (tc == NULL || !tc->enabled) {
+        return NULL;
+    }
+    tc->msg_len = 0;
+    if (tc->capture == NULL) {
+        tc->capture = tmpfile();
+        if (tc->capture == NULL) {
+            return NULL;
+        }
+    }
+    // Rewound, not truncated: only the bytes written from here on count.
+    rewind(tc->capture);
+    return tc->capture;
+}
+
+// Copies the captured messages into tc->msgs and on to dest.
+void tc_capture_end(token_cache_t *tc, FILE *dest) {
+    long end;
+
+    if (tc == NULL || tc->capture == NULL) {
+        return;
+    }
+    fflush(tc->capture);
+    end = ftell(tc->capture);
+    tc->msg_len = 0;
+    if (end <= 0) {
+        return;
+    }
+
+    if ((size_t)end > tc->msg_cap) {
+        size_t cap = (tc->msg_cap > 0) ? tc->msg_cap : TC_MSG_INIT;
+        char *grown;
+
+        while (cap < (size_t)end) {
+            cap *= 2;
+        }
+        grown = (char *)realloc(tc->msgs, cap);
+        if (grown == NULL) {
+            fprintf(stderr, "tc_capture_end: memory allocation failed\n");
+            return;
+        }
+        tc->msgs = grown;
+        tc->msg_cap = cap;
+    }
+
+    rewind(tc->capture);
+    tc->msg_len = fread(tc->msgs, 1, (size_t)end, tc->capture);
+    if (dest != NULL) {
+        fwrite(tc->msgs, 1, tc->msg_len, dest);
+    }
+}
+
+// Writes header, rebased tokens, lexeme blob and messages to fp. Returns 0
+// on success.
+static int write_entry(FILE *fp, const tc_key_t *key,
+                       const token_list_t *tokens, const char *msgs,
+                       size_t msg_len, int result) {
+    tc_header_t h;
+    size_t lex_len = 0;
+    int count = tl_count(tokens);
+    int i;
+
+    // Every lexeme becomes a span of the blob, so the blob is bounded by
+    // the token handle range.
+    for (i = 0; i < count; i++) {
+        lex_len += (size_t)token_length(tl_get(tokens, i));
+        if (lex_len > (size_t)TOKEN_HANDLE_MAX) {
+            return -1;
+        }
+    }
+    if (msg_len > (size_t)UINT32_MAX) {
+        return -1;
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TC_MAGIC, sizeof(h.magic));
+    h.version = TC_VERSION;
+    h.key = *key;
+    h.count = (uint32_t)count;
+    h.lex_len = (uint32_t)lex_len;
+    h.msg_len = (uint32_t)msg_len;
+    h.result = (int32_t)result;
+    if (fwrite(&h, sizeof(h), 1, fp) != 1) {
+        return -1;
+    }
+
+    lex_len = 0;
+    for (i = 0; i < count; i++) {
+        token_t tok = *tl_get(tokens, i);
+
+        tok.lexeme = (uint32_t)lex_len;
+        tok.flags = TOKEN_FLAG_SOURCE;
+        lex_len += tok.length;
+        if (fwrite(&tok, sizeof(tok), 1, fp) != 1) {
+            return -1;
+        }
+    }
+    for (i = 0; i < count; i++) {
+        const token_t *tok = tl_get(tokens, i);
+        lexeme_view_t lex = tl_lexeme(tokens, tok);
+
+        if (lex.len != token_length(tok) ||
+            fwrite(lex.data, 1, (size_t)lex.len, fp) != (size_t)lex.len) {
+            return -1;
+        }
+    }
+    if (msg_len > 0 && fwrite(msgs, 1, msg_len, fp) != msg_len) {
+        return -1;
+    }
+    return 0;
+}
+
+// Writes the entry next to its final path, then renames it into place.
+int tc_store(token_cache_t *tc, const tc_key_t *key,
+             const token_list_t *tokens, int result) {
+    char path[TC_PATH_MAX];
+    char tmp[TC_PATH_MAX];
+    FILE *fp;
+    int status;
+    int n;
+
+    if (tc == NULL || !tc->enabled || key == NULL || tokens == NULL ||
+        tc_entry_path(tc, key, path, sizeof(path)) != 0) {
+        return -1;
+    }
+    n = snprintf(tmp, sizeof(tmp), "%s.%ld.%u.tmp", path,
+                 (long)tc_getpid(), atomic_fetch_add(&tc_serial, 1u));
+    if (n < 0 || (size_t)n >= sizeof(tmp)) {
+        return -1;
+    }
+
+    fp = fopen(tmp, "wb");
+    if (fp == NULL) {
+        return -1;
+    }
+    status = write_entry(fp, key, tokens, tc->msgs, tc->msg_len, result);
+    if (fclose(fp) != 0) {
+        status = -1;
+    }
+#ifdef _WIN32
+    // rename does not replace an existing file on Windows.
+    if (status == 0) {
+        remove(path);
+    }
+#endif
+    if (status != 0 || rename(tmp, path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+// Closes the capture file and frees the message buffer.
+void tc_close(token_cache_t *tc) {
+    if (tc == NULL) {
+        return;
+    }
+    if (tc->capture != NULL) {
+        fclose(tc->capture);
+    }
+    free(tc->msgs);
+    tc->capture = NULL;
+    tc->msgs = NULL;
+    tc->msg_len = 0;
+    tc->msg_cap = 0;
+    tc->enabled = 0;
+}
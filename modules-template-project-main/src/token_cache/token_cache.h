@@ -0,0 +1,126 @@
+/*
+ * -----------------------------------------------------------------------------
+ * token_cache.h
+ *
+ * On-disk token cache. A scan result (token list plus the scanner messages
+ * it produced) is stored under a key made of a fast content hash of the
+ * input and a hash of the language specification. When the same bytes are
+ * scanned again with the same specification, the entry is loaded and
+ * replayed instead of running the DFA.
+ *
+ * Entry layout (host byte order, one file per key):
+ *   tc_header_t | token_t[count] | lexeme blob | message text
+ * Stored tokens are spans (TOKEN_FLAG_SOURCE) of the lexeme blob, so a
+ * loaded entry is attached to the token list as its source and tokens are
+ * added as is. Entries are written to a temporary file and renamed into
+ * place, so concurrent writers and readers only ever see whole entries.
+ *
+ * The cache is best effort: any unreadable, truncated or mismatching entry
+ * is a miss, and a failed store leaves the scan result untouched.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#ifndef TOKEN_CACHE_H
+#define TOKEN_CACHE_H
+
+#include "../token_list/token_list.h"
+#include "../arena/arena.h"
+
+#include <stdio.h>   // FILE
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint64_t, uint32_t
+
+// Entry file identification. Bump TC_VERSION whenever the entry layout or
+// scanner logic outside the hashed tables (tc_spec_hash) changes.
+#define TC_MAGIC   "CTKC"
+#define TC_VERSION 1
+
+// Entry file suffix.
+#define TC_SUFFIX ".ctc"
+
+// Max cache directory / entry path length.
+#define TC_PATH_MAX 512
+
+// Seed of the content hash.
+#define TC_HASH_SEED 0
+
+// Key of one cache entry.
+typedef struct {
+    uint64_t content;  // Hash of the input bytes.
+    uint64_t spec;     // Hash of the language specification.
+    uint64_t length;   // Input length in bytes.
+} tc_key_t;
+
+// Entry file header.
+typedef struct {
+    char magic[4];     // TC_MAGIC.
+    uint32_t version;  // TC_VERSION.
+    tc_key_t key;      // Key the entry was stored under.
+    uint32_t count;    // Stored tokens.
+    uint32_t lex_len;  // Lexeme blob bytes.
+    uint32_t msg_len;  // Message text bytes.
+    int32_t result;    // Scan result to report on a hit.
+} tc_header_t;
+
+_Static_assert(sizeof(tc_header_t) == 48, "tc_header_t layout changed");
+
+// Per-worker cache handle (not shared between threads).
+typedef struct {
+    int enabled;            // 1 once the directory is usable.
+    char dir[TC_PATH_MAX];  // Cache directory.
+    uint64_t spec;          // tc_spec_hash(), computed once.
+    FILE *capture;          // Message capture file (NULL until used).
+    char *msgs;             // Messages of the last capture.
+    size_t msg_len;         // Bytes in msgs.
+    size_t msg_cap;         // Allocated bytes in msgs.
+} token_cache_t;
+
+// Returns a 64-bit hash of len bytes (XXH64 construction).
+uint64_t tc_hash64(const void *data, size_t len, uint64_t seed);
+
+// Returns the hash of everything that decides how bytes become tokens and
+// messages: categories, keywords, operators, specials, whitespace,
+// character classes, the transition matrix and its accepting categories,
+// the error message texts and TC_VERSION.
+uint64_t tc_spec_hash(void);
+
+// Opens the cache in dir, creating the directory if needed. Returns 0, or
+// -1 (tc->enabled stays 0) when dir is NULL, too long or not creatable.
+int tc_open(token_cache_t *tc, const char *dir);
+
+// Computes the key of the len input bytes at data.
+void tc_key(const token_cache_t *tc, tc_key_t *key, const char *data,
+            size_t len);
+
+// Writes the entry file path of key to buf. Returns 0, or -1 when it does
+// not fit in size bytes.
+int tc_entry_path(const token_cache_t *tc, const tc_key_t *key, char *buf,
+                  size_t size);
+
+// Loads the entry for key into the empty token list tokens (entry memory
+// comes from arena, which must outlive the tokens) and writes the stored
+// messages to msg_dest. Returns 0 on a hit (*result = stored scan result),
+// -1 on a miss (nothing loaded or written).
+int tc_load(const token_cache_t *tc, const tc_key_t *key,
+            token_list_t *tokens, arena_t *arena, FILE *msg_dest,
+            int *result);
+
+// Starts capturing the messages of a scan about to be stored. Returns the
+// stream to route messages to, or NULL when capture is unavailable.
+FILE* tc_capture_begin(token_cache_t *tc);
+
+// Ends a capture: the captured messages are written to dest and kept for
+// the next tc_store.
+void tc_capture_end(token_cache_t *tc, FILE *dest);
+
+// Stores tokens, the captured messages and result under key. Returns 0,
+// or -1 when nothing was stored.
+int tc_store(token_cache_t *tc, const tc_key_t *key,
+             const token_list_t *tokens, int result);
+
+// Releases capture resources.
+void tc_close(token_cache_t *tc);
+
+#endif /* TOKEN_CACHE_H */
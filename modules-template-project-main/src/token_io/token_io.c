@@ -0,0 +1,360 @@
+/*
+ * -----------------------------------------------------------------------------
+ * token_io.c
+ *
+ * Binary token file implementation: in-memory image build + one write,
+ * and mapped read-only loading with header/section checks.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#include "token_io.h"
+
+#include <limits.h>  // INT_MAX
+#include <stdio.h>   // FILE, fprintf
+#include <stdlib.h>  // malloc, free
+#include <string.h>  // memcpy, memcmp, memset
+#ifndef _WIN32
+#include <errno.h>     // errno, EINTR
+#include <fcntl.h>     // open
+#include <unistd.h>    // write, close
+#endif
+#if TIO_USE_MMAP
+#include <sys/mman.h>  // mmap, munmap
+#include <sys/stat.h>  // fstat
+#endif
+
+// Rounds n up to a multiple of TIO_ALIGN.
+static uint64_t tio_align(uint64_t n) {
+    return (n + TIO_ALIGN - 1) & ~(uint64_t)(TIO_ALIGN - 1);
+}
+
+// Builds "<input>tok". Example: example.c -> example.ctok.
+void tio_build_filename(const char *input_filename, char *output_buf,
+                        int buf_len) {
+    const char *suffix = CTOK_SUFFIX;
+    int i = 0;
+    int s = 0;
+
+    if (input_filename == NULL || output_buf == NULL || buf_len <= 0) {
+        return;
+    }
+
+    while (input_filename[i] != '\0' && i < buf_len - 1) {
+        output_buf[i] = input_filename[i];
+        i++;
+    }
+    while (suffix[s] != '\0' && i < buf_len - 1) {
+        output_buf[i] = suffix[s];
+        i++;
+        s++;
+    }
+    output_buf[i] = '\0';
+}
+
+// Stores the whole image with one write (a short write is continued).
+static int write_image(const char *path, const unsigned char *img,
+                       size_t size) {
+#ifndef _WIN32
+    size_t done = 0;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+    if (fd < 0) {
+        return -1;
+    }
+    while (done < size) {
+        ssize_t n = write(fd, img + done, size - done);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            close(fd);
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return close(fd);
+#else
+    FILE *fp = fopen(path, "wb");
+    int status = 0;
+
+    if (fp == NULL) {
+        return -1;
+    }
+    if (fwrite(img, 1, size, fp) != size) {
+        status = -1;
+    }
+    if (fclose(fp) != 0) {
+        status = -1;
+    }
+    return status;
+#endif
+}
+
+// Lays out header, tokens, blob and line index in one buffer, then writes it.
+int tio_write(const token_list_t *tokens, const char *path) {
+    tio_header_t h;
+    unsigned char *img;
+    token_t *toks;
+    unsigned char *blob;
+    uint32_t *index;
+    uint64_t lex_len = 0;
+    uint32_t pos = 0;
+    int count = tl_count(tokens);
+    int lines;
+    int line = 0;
+    int status;
+    int i;
+
+    if (tokens == NULL || path == NULL) {
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        lex_len += (uint64_t)tl_lexeme(tokens, tl_get(tokens, i)).len;
+    }
+    if (lex_len > (uint64_t)TOKEN_HANDLE_MAX) {
+        return -1;
+    }
+    // Tokens are in source order, so the last one is on the last line.
+    lines = (count > 0) ? token_line(tl_get(tokens, count - 1)) : 0;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TIO_MAGIC, sizeof(h.magic));
+    h.version = TIO_VERSION;
+    h.byte_order = TIO_BYTE_ORDER;
+    h.header_size = (uint32_t)sizeof(h);
+    h.token_size = (uint32_t)sizeof(token_t);
+    h.count = (uint32_t)count;
+    h.lines = (uint32_t)lines;
+    h.tokens_off = sizeof(h);
+    h.lex_off = h.tokens_off + (uint64_t)count * sizeof(token_t);
+    h.lex_len = lex_len;
+    h.lines_off = tio_align(h.lex_off + lex_len);
+    h.file_size = h.lines_off + ((uint64_t)lines + 1) * sizeof(uint32_t);
+    if (h.file_size > (uint64_t)SIZE_MAX) {
+        return -1;
+    }
+
+    img = (unsigned char *)malloc((size_t)h.file_size);
+    if (img == NULL) {
+        fprintf(stderr, "tio_write: memory allocation failed\n");
+        return -1;
+    }
+    memcpy(img, &h, sizeof(h));
+    toks = (token_t *)(img + h.tokens_off);
+    blob = img + h.lex_off;
+    index = (uint32_t *)(img + h.lines_off);
+    memset(blob + lex_len, 0, (size_t)(h.lines_off - h.lex_off - lex_len));
+
+    // One pass: rebased token, its lexeme, and the line index entries of
+    // every line up to its own.
+    for (i = 0; i < count; i++) {
+        token_t tok = *tl_get(tokens, i);
+        lexeme_view_t lex = tl_lexeme(tokens, &tok);
+
+        while (line < token_line(&tok)) {
+            index[line++] = (uint32_t)i;
+        }
+        memcpy(blob + pos, lex.data, (size_t)lex.len);
+        tok.lexeme = pos;
+        tok.length = (uint16_t)lex.len;
+        tok.flags = TOKEN_FLAG_SOURCE;
+        toks[i] = tok;
+        pos += (uint32_t)lex.len;
+    }
+    while (line <= lines) {
+        index[line++] = (uint32_t)count;
+    }
+
+    status = write_image(path, img, (size_t)h.file_size);
+    free(img);
+    return status;
+}
+
+// Loads the file bytes: mapped when possible, else read into memory.
+static int load_bytes(tio_file_t *f, const char *path) {
+#if TIO_USE_MMAP
+    struct stat st;
+    void *map;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping stays valid after the descriptor is closed.
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    f->base = (const unsigned char *)map;
+    f->size = (size_t)st.st_size;
+    f->mapped = 1;
+    return 0;
+#else
+    unsigned char *buf;
+    long size;
+    FILE *fp = fopen(path, "rb");
+
+    if (fp == NULL) {
+        return -1;
+    }
+    if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) <= 0) {
+        fclose(fp);
+        return -1;
+    }
+    rewind(fp);
+    buf = (unsigned char *)malloc((size_t)size);
+    if (buf == NULL) {
+        fprintf(stderr, "tio_open: memory allocation failed\n");
+        fclose(fp);
+        return -1;
+    }
+    if (fread(buf, 1, (size_t)size, fp) != (size_t)size) {
+        free(buf);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    f->base = buf;
+    f->size = (size_t)size;
+    f->mapped = 0;
+    return 0;
+#endif
+}
+
+// Returns 1 when the header matches this build and every section lies
+// inside the size file bytes.
+static int header_valid(const tio_header_t *h, size_t size) {
+    uint64_t tokens_end;
+
+    if (memcmp(h->magic, TIO_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != TIO_VERSION || h->byte_order != TIO_BYTE_ORDER ||
+        h->header_size != sizeof(tio_header_t) ||
+        h->token_size != sizeof(token_t) || h->file_size != size ||
+        h->count > (uint32_t)INT_MAX || h->lines >= (uint32_t)INT_MAX ||
+        h->lex_len > (uint64_t)TOKEN_HANDLE_MAX) {
+        return 0;
+    }
+    tokens_end = h->tokens_off + (uint64_t)h->count * sizeof(token_t);
+    return h->tokens_off >= sizeof(tio_header_t) &&
+           h->tokens_off % TIO_ALIGN == 0 &&
+           h->lex_off >= tokens_end && h->lex_off <= size &&
+           h->lex_len <= size - h->lex_off &&
+           h->lines_off >= h->lex_off + h->lex_len &&
+           h->lines_off % sizeof(uint32_t) == 0 && h->lines_off <= size &&
+           ((uint64_t)h->lines + 1) * sizeof(uint32_t) <= size - h->lines_off;
+}
+
+// Returns 1 when every token is a span of the blob and the line index is
+// ordered and ends at count.
+static int contents_valid(const tio_header_t *h, const token_t *toks,
+                          const uint32_t *index) {
+    uint32_t i;
+
+    for (i = 0; i < h->count; i++) {
+        if (toks[i].flags != TOKEN_FLAG_SOURCE ||
+            toks[i].category >= CAT_COUNT ||
+            toks[i].lexeme > h->lex_len ||
+            toks[i].length > h->lex_len - toks[i].lexeme) {
+            return 0;
+        }
+    }
+    for (i = 0; i < h->lines; i++) {
+        if (index[i] > index[i + 1]) {
+            return 0;
+        }
+    }
+    return index[0] <= index[h->lines] && index[h->lines] == h->count;
+}
+
+// Releases file bytes.
+static void unload_bytes(tio_file_t *f) {
+#if TIO_USE_MMAP
+    if (f->mapped && f->base != NULL) {
+        munmap((void *)f->base, f->size);
+    }
+#endif
+    if (!f->mapped) {
+        free((void *)f->base);
+    }
+    f->base = NULL;
+    f->size = 0;
+    f->mapped = 0;
+}
+
+// Maps path and builds the read-only token view over it.
+int tio_open(tio_file_t *f, const char *path, int flags) {
+    const tio_header_t *h;
+    const token_t *toks;
+
+    if (f == NULL || path == NULL) {
+        return -1;
+    }
+    f->base = NULL;
+    f->size = 0;
+    f->mapped = 0;
+    f->line_index = NULL;
+    f->lines = 0;
+    tl_init(&f->tokens);
+
+    if (load_bytes(f, path) != 0) {
+        return -1;
+    }
+    h = (const tio_header_t *)f->base;
+    if (f->size < sizeof(tio_header_t) || !header_valid(h, f->size)) {
+        unload_bytes(f);
+        return -1;
+    }
+    toks = (const token_t *)(f->base + h->tokens_off);
+    f->line_index = (const uint32_t *)(f->base + h->lines_off);
+    f->lines = (int)h->lines;
+    if ((flags & TIO_OPEN_VERIFY) && !contents_valid(h, toks, f->line_index)) {
+        unload_bytes(f);
+        return -1;
+    }
+
+    if (tl_init_view(&f->tokens, toks, (int)h->count,
+                     (const char *)f->base + h->lex_off,
+                     (size_t)h->lex_len) != 0) {
+        unload_bytes(f);
+        return -1;
+    }
+    return 0;
+}
+
+// Looks line up in the line index.
+int tio_line_tokens(const tio_file_t *f, int line, int *count) {
+    int first;
+
+    if (count != NULL) {
+        *count = 0;
+    }
+    if (f == NULL || f->line_index == NULL || line < 1) {
+        return 0;
+    }
+    if (line > f->lines) {
+        return tl_count(&f->tokens);
+    }
+    first = (int)f->line_index[line - 1];
+    if (count != NULL) {
+        *count = (int)f->line_index[line] - first;
+    }
+    return first;
+}
+
+// Drops the view, then the file bytes.
+void tio_close(tio_file_t *f) {
+    if (f == NULL) {
+        return;
+    }
+    tl_free(&f->tokens);
+    unload_bytes(f);
+    f->line_index = NULL;
+    f->lines = 0;
+}
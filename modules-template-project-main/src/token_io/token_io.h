@@ -0,0 +1,106 @@
+/*
+ * -----------------------------------------------------------------------------
+ * token_io.h
+ *
+ * Binary token file (.ctok): the token list in a form later phases can use
+ * without re-lexing the textual .cscn.
+ *
+ * Layout (host byte order, sections TIO_ALIGN-aligned):
+ *   tio_header_t
+ *   token_t[count]          spans (TOKEN_FLAG_SOURCE) of the lexeme blob
+ *   lexeme blob             every lexeme, in token order
+ *   uint32_t[lines + 1]     line index: tokens of source line l (1-based)
+ *                           are [index[l - 1], index[l])
+ *
+ * The writer builds the whole image in memory and stores it with one
+ * sequential write. The reader maps the file and exposes it as a read-only
+ * token_list_t view (tl_init_view): tokens and lexemes are used in place,
+ * so opening costs a mapping plus a small block directory, whatever the
+ * file size.
+ *
+ * Team: Compilers P2
+ * -----------------------------------------------------------------------------
+ */
+
+#ifndef TOKEN_IO_H
+#define TOKEN_IO_H
+
+#include "../token_list/token_list.h"
+
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint16_t, uint32_t, uint64_t
+
+// File identification. Bump TIO_VERSION on any layout change.
+#define TIO_MAGIC   "CTOK"
+#define TIO_VERSION 1
+
+// Written as is: reads back differently on a host of the other byte order.
+#define TIO_BYTE_ORDER 0x0102
+
+// Section alignment in bytes.
+#define TIO_ALIGN 16
+
+// Memory-map .ctok files (0 reads them into memory instead).
+#ifndef TIO_USE_MMAP
+#ifdef _WIN32
+#define TIO_USE_MMAP 0
+#else
+#define TIO_USE_MMAP 1
+#endif
+#endif
+
+// tio_open flags.
+#define TIO_OPEN_TRUSTED 0  // Check header and section bounds only.
+#define TIO_OPEN_VERIFY  1  // Also check every token and the line index.
+
+// File header.
+typedef struct {
+    char magic[4];         // TIO_MAGIC.
+    uint16_t version;      // TIO_VERSION.
+    uint16_t byte_order;   // TIO_BYTE_ORDER as stored by the writer.
+    uint32_t header_size;  // sizeof(tio_header_t).
+    uint32_t token_size;   // sizeof(token_t).
+    uint32_t count;        // Tokens.
+    uint32_t lines;        // Source lines covered by the line index.
+    uint64_t tokens_off;   // Token array offset.
+    uint64_t lex_off;      // Lexeme blob offset.
+    uint64_t lex_len;      // Lexeme blob bytes.
+    uint64_t lines_off;    // Line index offset.
+    uint64_t file_size;    // Total file bytes.
+} tio_header_t;
+
+_Static_assert(sizeof(tio_header_t) == 64, "tio_header_t layout changed");
+_Static_assert(sizeof(tio_header_t) % TIO_ALIGN == 0,
+               "token array must start aligned");
+
+// An open .ctok file.
+typedef struct {
+    const unsigned char *base;  // File bytes (mapped or read).
+    size_t size;                // File size.
+    int mapped;                 // 1: base is a mapping, else malloc'd.
+    const uint32_t *line_index; // lines + 1 entries.
+    int lines;                  // Source lines covered.
+    token_list_t tokens;        // Read-only view of the file.
+} tio_file_t;
+
+// Builds "<input>tok". Example: example.c -> example.ctok.
+void tio_build_filename(const char *input_filename, char *output_buf,
+                        int buf_len);
+
+// Writes tokens (any mix of span and stored lexemes) to path. Returns 0,
+// or -1 when the image cannot be built or written.
+int tio_write(const token_list_t *tokens, const char *path);
+
+// Opens path (flags: TIO_OPEN_TRUSTED or TIO_OPEN_VERIFY). On success
+// f->tokens is a read-only view valid until tio_close. Returns 0, or -1
+// for a missing, foreign or damaged file.
+int tio_open(tio_file_t *f, const char *path, int flags);
+
+// Returns the index of the first token on source line and stores the
+// number of tokens of that line in *count (0 past the last line).
+int tio_line_tokens(const tio_file_t *f, int line, int *count);
+
+// Releases the view and the file bytes.
+void tio_close(tio_file_t *f);
+
+#endif /* TOKEN_IO_H */
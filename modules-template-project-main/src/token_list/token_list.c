@@ -2,7 +2,9 @@
  * -----------------------------------------------------------------------------
  * token_list.c
  *
- * Ordered token list implementation using a growable dynamic array.
+ * Ordered token list implementation: fixed-size blocks of 16-byte tokens
+ * behind a two-level block directory, plus a chunked lexeme store, backed
+ * by malloc or by an arena.
  *
  * Team: Compilers P2
  * -----------------------------------------------------------------------------
@@ -12,71 +14,513 @@
 #include <stdlib.h>  // malloc, realloc, free
 #include <stdio.h>   // fprintf, stderr
 #include <stddef.h>  // NULL
+#include <string.h>  // memcpy, memset
+
+_Static_assert(MAX_LEXEME_LEN <= TL_LEX_CHUNK_SIZE,
+               "a lexeme (plus NUL) must fit in one store chunk");
+
+// Allocates size bytes from the list arena or the heap.
+static void* tl_alloc(token_list_t *list, size_t size) {
+    if (list->arena != NULL) {
+        return arena_alloc(list->arena, size);
+    }
+    return malloc(size);
+}
+
+// Resizes a block from tl_alloc. Arena blocks are copied, never freed.
+static void* tl_realloc(token_list_t *list, void *ptr, size_t old_size,
+                        size_t new_size) {
+    void *grown;
+
+    if (list->arena == NULL) {
+        return realloc(ptr, new_size);
+    }
+    grown = arena_alloc(list->arena, new_size);
+    if (grown != NULL && ptr != NULL) {
+        memcpy(grown, ptr, old_size);
+    }
+    return grown;
+}
+
+// Releases a block from tl_alloc (no-op for arena memory).
+static void tl_release(token_list_t *list, void *ptr) {
+    if (list->arena == NULL) {
+        free(ptr);
+    }
+}
+
+// Sets every field of an empty list (storage is allocated on first add).
+static void tl_setup(token_list_t *list, arena_t *arena) {
+    list->arena = arena;
+    list->dir = NULL;
+    list->tail = NULL;
+    list->count = 0;
+    list->capacity = 0;
+    list->source = NULL;
+    list->source_len = 0;
+    list->lex_chunks = NULL;
+    list->lex_nchunks = 0;
+    list->lex_dir_cap = 0;
+    list->lex_used = 0;
+    list->view = 0;
+}
 
 // Allocates initial storage for the token list.
 void tl_init(token_list_t *list) {
     if (list == NULL) {
         return;
     }
+    tl_setup(list, NULL);
+}
 
-    list->tokens = (token_t *)malloc(TL_INIT_CAPACITY * sizeof(token_t));
-    if (list->tokens == NULL) {
-        fprintf(stderr, "tl_init: memory allocation failed\n");
-        list->capacity = 0;
-    } else {
-        list->capacity = TL_INIT_CAPACITY;
+// Allocates initial storage for the token list from an arena.
+void tl_init_arena(token_list_t *list, arena_t *arena) {
+    if (list == NULL) {
+        return;
     }
-    list->count = 0;
+    tl_setup(list, arena);
+}
+
+// Builds the block directory over a borrowed token array.
+int tl_init_view(token_list_t *list, const token_t *tokens, int count,
+                 const char *source, size_t len) {
+    int nblocks;
+    int block;
+    int page;
+
+    if (list == NULL || count < 0 || (count > 0 && tokens == NULL)) {
+        return -1;
+    }
+    tl_setup(list, NULL);
+    list->view = 1;
+    tl_set_source(list, source, len);
+    if (count == 0) {
+        return 0;
+    }
+
+    list->dir = (token_t ***)tl_alloc(list, TL_DIR_PAGES * sizeof(token_t **));
+    if (list->dir == NULL) {
+        fprintf(stderr, "tl_init_view: memory allocation failed\n");
+        return -1;
+    }
+    memset(list->dir, 0, TL_DIR_PAGES * sizeof(token_t **));
+    nblocks = ((count - 1) >> TL_BLOCK_SHIFT) + 1;
+    for (block = 0; block < nblocks; block++) {
+        page = block >> TL_DIR_PAGE_SHIFT;
+        if (list->dir[page] == NULL) {
+            list->dir[page] = (token_t **)tl_alloc(list, TL_DIR_PAGE * sizeof(token_t *));
+            if (list->dir[page] == NULL) {
+                fprintf(stderr, "tl_init_view: memory allocation failed\n");
+                tl_free(list);
+                return -1;
+            }
+        }
+        // Views never write through these pointers (see tl_grow).
+        list->dir[page][block & TL_DIR_PAGE_MASK] =
+            (token_t *)(tokens + ((size_t)block << TL_BLOCK_SHIFT));
+    }
+    // capacity == count: any append reaches tl_grow, which refuses it.
+    list->count = count;
+    list->capacity = count;
+    return 0;
 }
 
-// Doubles storage capacity when needed.
+// Adds one token block, plus its directory page when it starts a new one.
+// Nothing already stored is moved.
 static int tl_grow(token_list_t *list) {
+    int block;
+    int page;
+    token_t *tokens;
+
     if (list == NULL) {
         return -1;
     }
+    if (list->view) {
+        fprintf(stderr, "tl_grow: token list view is read-only\n");
+        return -1;
+    }
+    if (list->capacity > INT_MAX - TL_BLOCK_TOKENS) {
+        fprintf(stderr, "tl_grow: token list limit reached\n");
+        return -1;
+    }
 
-    if (list->capacity <= 0) {
-        list->tokens = (token_t *)malloc(TL_INIT_CAPACITY * sizeof(token_t));
-        if (list->tokens == NULL) {
+    if (list->dir == NULL) {
+        list->dir = (token_t ***)tl_alloc(list, TL_DIR_PAGES * sizeof(token_t **));
+        if (list->dir == NULL) {
+            fprintf(stderr, "tl_grow: memory allocation failed\n");
+            return -1;
+        }
+        memset(list->dir, 0, TL_DIR_PAGES * sizeof(token_t **));
+    }
+
+    block = list->capacity >> TL_BLOCK_SHIFT;
+    page = block >> TL_DIR_PAGE_SHIFT;
+    if (list->dir[page] == NULL) {
+        list->dir[page] = (token_t **)tl_alloc(list, TL_DIR_PAGE * sizeof(token_t *));
+        if (list->dir[page] == NULL) {
             fprintf(stderr, "tl_grow: memory allocation failed\n");
             return -1;
         }
-        list->capacity = TL_INIT_CAPACITY;
-        return 0;
     }
 
-    int new_cap = list->capacity * TL_GROWTH_FACTOR;
-    token_t *new_buf = (token_t *)realloc(list->tokens, new_cap * sizeof(token_t));
-    if (new_buf == NULL) {
-        fprintf(stderr, "tl_grow: memory reallocation failed\n");
+    tokens = (token_t *)tl_alloc(list, TL_BLOCK_TOKENS * sizeof(token_t));
+    if (tokens == NULL) {
+        fprintf(stderr, "tl_grow: memory allocation failed\n");
         return -1;
     }
-    list->tokens = new_buf;
-    list->capacity = new_cap;
+    list->dir[page][block & TL_DIR_PAGE_MASK] = tokens;
+    list->tail = tokens;
+    list->capacity += TL_BLOCK_TOKENS;
     return 0;
 }
 
+// Returns the next free slot, adding a block when the tail one is full.
+static token_t* tl_next_slot(token_list_t *list) {
+    if (list->count >= list->capacity) {
+        if (tl_grow(list) != 0) {
+            return NULL;
+        }
+    }
+    return &list->tail[list->count & TL_BLOCK_MASK];
+}
+
 // Appends a token copy to the list.
 void tl_add(token_list_t *list, const token_t *tok) {
+    token_t *slot;
+
     if (list == NULL || tok == NULL) {
         return;
     }
 
-    if (list->count >= list->capacity) {
-        if (tl_grow(list) != 0) {
-            return;
+    slot = tl_next_slot(list);
+    if (slot == NULL) {
+        return;
+    }
+    *slot = *tok;
+    list->count++;
+}
+
+// Opens a new lexeme chunk, growing the chunk directory when full.
+static int tl_lex_new_chunk(token_list_t *list) {
+    char *chunk;
+
+    if ((size_t)list->lex_nchunks >= ((size_t)TOKEN_HANDLE_MAX >> TL_LEX_CHUNK_SHIFT) + 1) {
+        fprintf(stderr, "tl_lex_new_chunk: lexeme store limit reached\n");
+        return -1;
+    }
+    if (list->lex_nchunks >= list->lex_dir_cap) {
+        int new_cap = (list->lex_dir_cap > 0)
+                          ? list->lex_dir_cap * TL_GROWTH_FACTOR
+                          : TL_LEX_DIR_INIT;
+        char **new_dir = (char **)tl_realloc(list, list->lex_chunks,
+                                             list->lex_dir_cap * sizeof(char *),
+                                             new_cap * sizeof(char *));
+        if (new_dir == NULL) {
+            fprintf(stderr, "tl_lex_new_chunk: memory reallocation failed\n");
+            return -1;
         }
+        list->lex_chunks = new_dir;
+        list->lex_dir_cap = new_cap;
+    }
+
+    chunk = (char *)tl_alloc(list, TL_LEX_CHUNK_SIZE);
+    if (chunk == NULL) {
+        fprintf(stderr, "tl_lex_new_chunk: memory allocation failed\n");
+        return -1;
+    }
+    list->lex_chunks[list->lex_nchunks] = chunk;
+    list->lex_nchunks++;
+    list->lex_used = 0;
+    return 0;
+}
+
+// Copies len (already capped) lexeme bytes plus a NUL into the store and
+// sets *handle. Returns 0, or -1 when the store cannot grow.
+static int tl_store_lexeme(token_list_t *list, const char *lexeme, int len,
+                           uint32_t *handle) {
+    char *dst;
+    int i;
+
+    // A lexeme never straddles two chunks.
+    if (list->lex_nchunks == 0 ||
+        list->lex_used + (size_t)len + 1 > TL_LEX_CHUNK_SIZE) {
+        if (tl_lex_new_chunk(list) != 0) {
+            return -1;
+        }
+    }
+
+    *handle = ((uint32_t)(list->lex_nchunks - 1) << TL_LEX_CHUNK_SHIFT) |
+              (uint32_t)list->lex_used;
+    dst = list->lex_chunks[list->lex_nchunks - 1] + list->lex_used;
+    for (i = 0; i < len; i++) {
+        dst[i] = lexeme[i];
+    }
+    dst[len] = '\0';
+    list->lex_used += (size_t)len + 1;
+    return 0;
+}
+
+// Copies the lexeme into the store, then appends a token referring to it.
+void tl_add_lexeme(token_list_t *list, const char *lexeme, int len,
+                   token_category_t cat, int line, int col) {
+    token_t tok;
+    uint32_t handle;
+
+    if (list == NULL || lexeme == NULL || len < 0) {
+        return;
+    }
+    if (len > MAX_LEXEME_LEN - 1) {
+        len = MAX_LEXEME_LEN - 1;
+    }
+    if (tl_store_lexeme(list, lexeme, len, &handle) != 0) {
+        return;
+    }
+
+    token_init(&tok, handle, len, 0, cat, line, col);
+    tl_add(list, &tok);
+}
+
+// Records the borrowed source buffer used by span tokens.
+void tl_set_source(token_list_t *list, const char *source, size_t len) {
+    if (list == NULL) {
+        return;
+    }
+    if (source == NULL || len > (size_t)TOKEN_HANDLE_MAX) {
+        list->source = NULL;
+        list->source_len = 0;
+        return;
+    }
+    list->source = source;
+    list->source_len = len;
+}
+
+// Returns borrowed source buffer.
+const char* tl_source(const token_list_t *list) {
+    if (list == NULL) {
+        return NULL;
+    }
+    return list->source;
+}
+
+// Appends a span token in place, without copying any lexeme bytes.
+void tl_add_span(token_list_t *list, size_t offset, int length,
+                 token_category_t cat, int line, int col) {
+    token_t *slot;
+
+    if (list == NULL) {
+        return;
     }
-    list->tokens[list->count] = *tok;
+
+    slot = tl_next_slot(list);
+    if (slot == NULL) {
+        return;
+    }
+    token_init(slot, (uint32_t)offset, length, TOKEN_FLAG_SOURCE, cat, line, col);
     list->count++;
 }
 
+// Appends src tokens to dst in order.
+void tl_append(token_list_t *dst, const token_list_t *src) {
+    int i;
+
+    if (dst == NULL || src == NULL) {
+        return;
+    }
+
+    for (i = 0; i < src->count; i++) {
+        const token_t *tok = tl_get(src, i);
+        token_t *slot;
+
+        if (!(tok->flags & TOKEN_FLAG_SOURCE)) {
+            lexeme_view_t lex = tl_lexeme(src, tok);
+            tl_add_lexeme(dst, lex.data, lex.len, token_category(tok),
+                          token_line(tok), token_col(tok));
+            continue;
+        }
+        slot = tl_next_slot(dst);
+        if (slot == NULL) {
+            return;
+        }
+        *slot = *tok;
+        dst->count++;
+    }
+}
+
+// Returns the slot of index (index < capacity).
+static token_t* tl_slot(const token_list_t *list, int index) {
+    int block = index >> TL_BLOCK_SHIFT;
+
+    return &list->dir[block >> TL_DIR_PAGE_SHIFT][block & TL_DIR_PAGE_MASK]
+                     [index & TL_BLOCK_MASK];
+}
+
+// Moves n tokens from index from to index to (ranges may overlap), one
+// run at a time that stays inside one source and one destination block.
+static void tl_move(token_list_t *list, int to, int from, int n) {
+    int run;
+
+    if (to < from) {
+        while (n > 0) {
+            run = n;
+            if (run > TL_BLOCK_TOKENS - (from & TL_BLOCK_MASK)) {
+                run = TL_BLOCK_TOKENS - (from & TL_BLOCK_MASK);
+            }
+            if (run > TL_BLOCK_TOKENS - (to & TL_BLOCK_MASK)) {
+                run = TL_BLOCK_TOKENS - (to & TL_BLOCK_MASK);
+            }
+            memmove(tl_slot(list, to), tl_slot(list, from),
+                    (size_t)run * sizeof(token_t));
+            to += run;
+            from += run;
+            n -= run;
+        }
+    } else if (to > from) {
+        // Back to front, so no token is overwritten before it moves.
+        while (n > 0) {
+            run = n;
+            if (run > ((from + n - 1) & TL_BLOCK_MASK) + 1) {
+                run = ((from + n - 1) & TL_BLOCK_MASK) + 1;
+            }
+            if (run > ((to + n - 1) & TL_BLOCK_MASK) + 1) {
+                run = ((to + n - 1) & TL_BLOCK_MASK) + 1;
+            }
+            n -= run;
+            memmove(tl_slot(list, to + n), tl_slot(list, from + n),
+                    (size_t)run * sizeof(token_t));
+        }
+    }
+}
+
+// Shortens the list to count tokens and releases the blocks past it, so
+// the last kept block is the tail again.
+static void tl_truncate(token_list_t *list, int count) {
+    int keep = (count + TL_BLOCK_TOKENS - 1) >> TL_BLOCK_SHIFT;
+    int block;
+
+    for (block = keep; block < (list->capacity >> TL_BLOCK_SHIFT); block++) {
+        token_t **entry = &list->dir[block >> TL_DIR_PAGE_SHIFT]
+                                    [block & TL_DIR_PAGE_MASK];
+
+        tl_release(list, *entry);
+        *entry = NULL;
+    }
+    list->capacity = keep << TL_BLOCK_SHIFT;
+    list->tail = (keep > 0) ? tl_slot(list, (keep - 1) << TL_BLOCK_SHIFT)
+                            : NULL;
+    list->count = count;
+}
+
+// Replaces tokens [first, first + remove) with src: the tail is moved once
+// (block-sized memmove runs), then src tokens are copied into the gap.
+int tl_splice(token_list_t *list, int first, int remove,
+              const token_list_t *src) {
+    int n = tl_count(src);
+    int old_count;
+    int tail;
+    int status = 0;
+    int i;
+
+    if (list == NULL || list->view || first < 0 || remove < 0 ||
+        first > list->count ||
+        remove > list->count - first || n > INT_MAX - (list->count - remove)) {
+        return -1;
+    }
+    old_count = list->count;
+    tail = list->count - first - remove;
+
+    if (n > remove) {
+        // Open the gap at the end, then shift the tail right.
+        for (i = remove; i < n; i++) {
+            if (tl_next_slot(list) == NULL) {
+                tl_truncate(list, old_count);
+                return -1;
+            }
+            list->count++;
+        }
+        tl_move(list, first + n, first + remove, tail);
+    } else if (n < remove) {
+        tl_move(list, first + n, first + remove, tail);
+        tl_truncate(list, old_count - (remove - n));
+    }
+
+    for (i = 0; i < n; i++) {
+        token_t tok = *tl_get(src, i);
+
+        // Stored lexemes move into this list's store (empty if it is full).
+        if (!(tok.flags & TOKEN_FLAG_SOURCE)) {
+            lexeme_view_t lex = tl_lexeme(src, &tok);
+
+            if (tl_store_lexeme(list, lex.data, lex.len, &tok.lexeme) != 0) {
+                tok.length = 0;
+                status = -1;
+            }
+        }
+        *tl_slot(list, first + i) = tok;
+    }
+    return status;
+}
+
+// Shifts span offsets and lines of tokens [first, count), block by block.
+void tl_shift(token_list_t *list, int first, int64_t offset_delta,
+              int line_delta) {
+    int i = first;
+
+    if (list == NULL || list->view || first < 0) {
+        return;
+    }
+    while (i < list->count) {
+        token_t *tok = tl_slot(list, i);
+        int run = TL_BLOCK_TOKENS - (i & TL_BLOCK_MASK);
+        int k;
+
+        if (run > list->count - i) {
+            run = list->count - i;
+        }
+        for (k = 0; k < run; k++) {
+            if (tok[k].flags & TOKEN_FLAG_SOURCE) {
+                tok[k].lexeme = (uint32_t)((int64_t)tok[k].lexeme + offset_delta);
+            }
+            tok[k].line = (uint32_t)((int64_t)tok[k].line + line_delta);
+        }
+        i += run;
+    }
+}
+
+// Resolves a token lexeme to its stored copy or its source span.
+lexeme_view_t tl_lexeme(const token_list_t *list, const token_t *tok) {
+    lexeme_view_t view;
+    uint32_t chunk;
+
+    view.data = "";
+    view.len = 0;
+    if (tok == NULL || list == NULL) {
+        return view;
+    }
+    if (tok->flags & TOKEN_FLAG_SOURCE) {
+        if (list->source != NULL) {
+            view.data = list->source + tok->lexeme;
+            view.len = tok->length;
+        }
+        return view;
+    }
+    chunk = tok->lexeme >> TL_LEX_CHUNK_SHIFT;
+    if ((int)chunk < list->lex_nchunks) {
+        view.data = list->lex_chunks[chunk] + (tok->lexeme & TL_LEX_CHUNK_MASK);
+        view.len = tok->length;
+    }
+    return view;
+}
+
 // Returns token pointer by index.
 const token_t* tl_get(const token_list_t *list, int index) {
+    int block;
+
     if (list == NULL || index < 0 || index >= list->count) {
         return NULL;
     }
-    return &list->tokens[index];
+    block = index >> TL_BLOCK_SHIFT;
+    return &list->dir[block >> TL_DIR_PAGE_SHIFT][block & TL_DIR_PAGE_MASK]
+                     [index & TL_BLOCK_MASK];
 }
 
 // Returns number of tokens stored.
@@ -87,16 +531,61 @@ int tl_count(const token_list_t *list) {
     return list->count;
 }
 
-// Releases list memory.
+// Empties the list, keeping one token block and one lexeme chunk.
+void tl_clear(token_list_t *list) {
+    int c;
+
+    if (list == NULL || list->view) {
+        return;
+    }
+    tl_truncate(list, (list->capacity > 0) ? 1 : 0);
+    list->count = 0;
+    for (c = 1; c < list->lex_nchunks; c++) {
+        tl_release(list, list->lex_chunks[c]);
+    }
+    if (list->lex_nchunks > 1) {
+        list->lex_nchunks = 1;
+    }
+    list->lex_used = 0;
+}
+
+// Releases list memory (arena-backed memory is left to the arena).
 void tl_free(token_list_t *list) {
+    int c;
+    int block;
+    int page;
+
     if (list == NULL) {
         return;
     }
 
-    if (list->tokens != NULL) {
-        free(list->tokens);
-        list->tokens = NULL;
+    for (c = 0; c < list->lex_nchunks; c++) {
+        tl_release(list, list->lex_chunks[c]);
+    }
+    if (list->lex_chunks != NULL) {
+        tl_release(list, list->lex_chunks);
+        list->lex_chunks = NULL;
+    }
+    if (list->dir != NULL) {
+        // View blocks are borrowed.
+        for (block = 0; !list->view &&
+                        block < (list->capacity >> TL_BLOCK_SHIFT); block++) {
+            tl_release(list, list->dir[block >> TL_DIR_PAGE_SHIFT]
+                                      [block & TL_DIR_PAGE_MASK]);
+        }
+        for (page = 0; page < TL_DIR_PAGES && list->dir[page] != NULL; page++) {
+            tl_release(list, list->dir[page]);
+        }
+        tl_release(list, list->dir);
+        list->dir = NULL;
     }
+    list->tail = NULL;
     list->count = 0;
     list->capacity = 0;
+    list->source = NULL;
+    list->source_len = 0;
+    list->lex_nchunks = 0;
+    list->lex_dir_cap = 0;
+    list->lex_used = 0;
+    list->view = 0;
 }
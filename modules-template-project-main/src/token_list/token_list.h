@@ -2,8 +2,23 @@
  * -----------------------------------------------------------------------------
  * token_list.h
  *
- * Ordered token list (dynamic array). Stores tokens in the order they
- * appear in the input. No formatting or scanning logic here.
+ * Ordered token list. Stores tokens in the order they appear in the input.
+ * No formatting or scanning logic here.
+ *
+ * Tokens live in fixed-size blocks reached through a two-level block
+ * directory (a fixed page table of block-pointer pages). Blocks and pages
+ * are never moved or reallocated, so appends are O(1) worst case, tl_get
+ * is O(1), and a token pointer stays valid until tl_free.
+ *
+ * Lexemes live out of line: copied lexemes are appended (NUL-terminated)
+ * to the list's lexeme store; span tokens refer to the attached source.
+ * The store is a directory of fixed-size chunks that never move, so a
+ * lexeme view stays valid while the list keeps growing.
+ *
+ * Storage comes from malloc, or from an arena (tl_init_arena) so that the
+ * whole list is released with the arena in one shot. A view (tl_init_view)
+ * points its blocks into a borrowed token array, e.g. a mapped .ctok file;
+ * it is read-only.
  *
  * Team: Compilers P2
  * -----------------------------------------------------------------------------
@@ -13,30 +28,112 @@
 #define TOKEN_LIST_H
 
 #include "../token/token.h"
+#include "../arena/arena.h"
+
+#include <stddef.h>  // size_t
+#include <limits.h>  // INT_MAX
+
+// Token blocks: index = (block << TL_BLOCK_SHIFT) | slot in block.
+#define TL_BLOCK_SHIFT  12
+#define TL_BLOCK_TOKENS (1 << TL_BLOCK_SHIFT)
+#define TL_BLOCK_MASK   (TL_BLOCK_TOKENS - 1)
 
-// Initial capacity and growth factor for token storage.
-#define TL_INIT_CAPACITY 128
+// Block directory: block = (page << TL_DIR_PAGE_SHIFT) | entry in page.
+#define TL_DIR_PAGE_SHIFT 10
+#define TL_DIR_PAGE       (1 << TL_DIR_PAGE_SHIFT)
+#define TL_DIR_PAGE_MASK  (TL_DIR_PAGE - 1)
+#define TL_DIR_PAGES \
+    ((int)(((unsigned)INT_MAX >> (TL_BLOCK_SHIFT + TL_DIR_PAGE_SHIFT)) + 1))
+
+// Growth factor for the lexeme chunk directory.
 #define TL_GROWTH_FACTOR 2
 
+// Lexeme store chunking: handle = (chunk << SHIFT) | offset in chunk.
+#define TL_LEX_CHUNK_SHIFT 16
+#define TL_LEX_CHUNK_SIZE  ((size_t)1 << TL_LEX_CHUNK_SHIFT)
+#define TL_LEX_CHUNK_MASK  (TL_LEX_CHUNK_SIZE - 1)
+#define TL_LEX_DIR_INIT    16
+
 // Token list storage.
 typedef struct {
-    token_t *tokens;   // Dynamic token array.
-    int count;         // Number of used slots.
-    int capacity;      // Allocated token slots.
+    token_t ***dir;      // TL_DIR_PAGES page pointers (NULL until first add).
+    token_t *tail;       // Block being filled.
+    int count;           // Number of used slots.
+    int capacity;        // Allocated token slots (whole blocks).
+    const char *source;  // Borrowed source for span lexemes (or NULL).
+    size_t source_len;   // Source length in bytes.
+    arena_t *arena;      // Backing arena, or NULL for malloc/free.
+    char **lex_chunks;   // Lexeme chunk directory.
+    int lex_nchunks;     // Chunks in use (last one is being filled).
+    int lex_dir_cap;     // Directory slots allocated.
+    size_t lex_used;     // Bytes used in the last chunk.
+    int view;            // 1: blocks borrowed from a token array (read-only).
 } token_list_t;
 
 // Initializes an empty token list.
 void tl_init(token_list_t *list);
 
-// Adds one token.
+// Initializes an empty token list allocating from arena. tl_free does not
+// release arena memory; arena_reset/arena_free do.
+void tl_init_arena(token_list_t *list, arena_t *arena);
+
+// Initializes a read-only list over count borrowed tokens, all spans of
+// source (len bytes). No token is copied: blocks point into tokens, which
+// must stay valid and TL_BLOCK_TOKENS-contiguous until tl_free. Appends,
+// splices and shifts are refused. Returns 0, or -1 on allocation failure.
+int tl_init_view(token_list_t *list, const token_t *tokens, int count,
+                 const char *source, size_t len);
+
+// Adds one token whose lexeme handle is already valid for this list.
 void tl_add(token_list_t *list, const token_t *tok);
 
-// Returns token at index or NULL.
+// Copies len lexeme bytes into the lexeme store and appends the token.
+void tl_add_lexeme(token_list_t *list, const char *lexeme, int len,
+                   token_category_t cat, int line, int col);
+
+// Attaches a resident source buffer. Span tokens added afterwards refer to
+// it; the buffer must outlive every lexeme view taken from the list.
+// Sources larger than TOKEN_HANDLE_MAX are not attached.
+void tl_set_source(token_list_t *list, const char *source, size_t len);
+
+// Returns attached source buffer or NULL.
+const char* tl_source(const token_list_t *list);
+
+// Appends one span token [offset, offset + length) of the attached source.
+void tl_add_span(token_list_t *list, size_t offset, int length,
+                 token_category_t cat, int line, int col);
+
+// Appends every token of src to dst in order. Span tokens are copied as is
+// (dst must be attached to the same source); stored lexemes are re-copied.
+void tl_append(token_list_t *dst, const token_list_t *src);
+
+// Replaces tokens [first, first + remove) of list with every token of src,
+// in order; later tokens move up or down. Span tokens are copied as is
+// (list must be attached to the same source); stored lexemes are re-copied.
+// Token pointers at or after first are invalidated. Returns 0, or -1 on a
+// bad range or allocation failure.
+int tl_splice(token_list_t *list, int first, int remove,
+              const token_list_t *src);
+
+// Adds offset_delta to the source offset of every span token from index
+// first on, and line_delta to every line (text moved by an edit).
+void tl_shift(token_list_t *list, int first, int64_t offset_delta,
+              int line_delta);
+
+// Returns the lexeme of a token stored in list (empty view for NULL).
+lexeme_view_t tl_lexeme(const token_list_t *list, const token_t *tok);
+
+// Returns token at index or NULL. The pointer stays valid until tl_free.
 const token_t* tl_get(const token_list_t *list, int index);
 
 // Returns token count.
 int tl_count(const token_list_t *list);
 
+// Empties the list for reuse: keeps its first token block and lexeme chunk
+// (and the attached source), releases the rest. Token pointers and lexeme
+// views taken before are invalidated. Views cannot be cleared.
+void tl_clear(token_list_t *list);
+
 // Frees token list storage.
 void tl_free(token_list_t *list);
 
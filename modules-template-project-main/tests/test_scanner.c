@@ -11,6 +11,7 @@
  */
 
 #include "test_scanner.h"
+#include <pthread.h>
 
 /* ---- Test: Language Specification ---- */
 
@@ -65,27 +66,71 @@ static void test_lang_spec(void) {
 
 /* ---- Test: Token and Token List ---- */
 
+/* Keyword list expander for the tests. */
+#define TEST_KW_ITEM(arg, kw) kw,
+
+/*
+ * test_keyword_hash - every LS_KEYWORD_LIST entry is found through the
+ * generated perfect hash; prefixes, case changes and same-shape
+ * non-keywords are not.
+ */
+static void test_keyword_hash(void) {
+    static const char *kws[] = { LS_KEYWORD_LIST(TEST_KW_ITEM, _) };
+    char probe[MAX_LEXEME_LEN];
+    int k;
+
+    printf("  Testing keyword perfect hash...\n");
+
+    assert((int)(sizeof(kws) / sizeof(kws[0])) == NUM_KEYWORDS);
+    for (k = 0; k < NUM_KEYWORDS; k++) {
+        int len = (int)strlen(kws[k]);
+
+        assert(ls_is_keyword(kws[k]) == 1);
+        assert(ls_is_keyword_n(kws[k], len) == 1);
+        assert(ls_is_keyword_n(kws[k], len - 1) == 0);
+
+        /* Same first/last byte and length, different middle or case. */
+        memcpy(probe, kws[k], (size_t)len + 1);
+        probe[0] = (char)(probe[0] - 'a' + 'A');
+        assert(ls_is_keyword(probe) == 0);
+        memcpy(probe, kws[k], (size_t)len + 1);
+        probe[len] = 'x';
+        probe[len + 1] = '\0';
+        assert(ls_is_keyword_n(probe, len + 1) == 0);
+        assert(ls_is_keyword_n(probe, len) == 1);
+    }
+    assert(ls_is_keyword("") == 0);
+    assert(ls_is_keyword("vxid") == 0);
+    assert(ls_is_keyword("returns") == 0);
+
+    printf("  keyword perfect hash tests PASSED\n");
+}
+
 /*
  * test_token_list - verifies token creation and list operations.
  */
 static void test_token_list(void) {
     token_list_t list;
-    token_t tok;
     const token_t *retrieved;
+    lexeme_view_t lex;
 
     printf("  Testing token + token_list...\n");
 
     tl_init(&list);
     assert(tl_count(&list) == 0);
 
-    token_init(&tok, "hello", CAT_IDENTIFIER, 1, 1);
-    tl_add(&list, &tok);
+    tl_add_lexeme(&list, "hello", 5, CAT_IDENTIFIER, 1, 1);
     assert(tl_count(&list) == 1);
 
     retrieved = tl_get(&list, 0);
     assert(retrieved != NULL);
-    assert(retrieved->category == CAT_IDENTIFIER);
-    assert(retrieved->line == 1);
+    assert(token_category(retrieved) == CAT_IDENTIFIER);
+    assert(token_line(retrieved) == 1);
+    lex = tl_lexeme(&list, retrieved);
+    assert(lex.len == 5 && memcmp(lex.data, "hello", 5) == 0);
+
+    /* Compact layout */
+    assert(sizeof(token_t) == 16);
 
     /* Out of bounds returns NULL */
     assert(tl_get(&list, 5) == NULL);
@@ -96,6 +141,41 @@ static void test_token_list(void) {
     printf("  token + token_list tests PASSED\n");
 }
 
+/*
+ * test_token_list_blocks - appends across several token blocks and checks
+ * that pointers taken early still point at the same tokens.
+ */
+static void test_token_list_blocks(void) {
+    token_list_t list;
+    const token_t *first;
+    const token_t *block_end = NULL;
+    int i;
+
+    printf("  Testing token_list block storage...\n");
+
+    tl_init(&list);
+    tl_add_span(&list, 0, 1, CAT_NUMBER, 1, 1);
+    first = tl_get(&list, 0);
+    for (i = 1; i < TEST_BLOCK_TOKENS; i++) {
+        tl_add_span(&list, (size_t)i, 1, CAT_NUMBER, i + 1, 1);
+        if (i == TL_BLOCK_TOKENS - 1) {
+            block_end = tl_get(&list, i);
+        }
+    }
+    assert(tl_count(&list) == TEST_BLOCK_TOKENS);
+    assert(tl_get(&list, 0) == first);
+    assert(tl_get(&list, TL_BLOCK_TOKENS - 1) == block_end);
+    assert(token_line(block_end) == TL_BLOCK_TOKENS);
+    for (i = 0; i < TEST_BLOCK_TOKENS; i++) {
+        const token_t *tok = tl_get(&list, i);
+        assert(tok->lexeme == (uint32_t)i && token_line(tok) == i + 1);
+    }
+    assert(tl_get(&list, TEST_BLOCK_TOKENS) == NULL);
+    tl_free(&list);
+
+    printf("  token_list block storage tests PASSED\n");
+}
+
 /* ---- Test: Scanner with test input file ---- */
 
 /*
@@ -145,37 +225,37 @@ static void test_scanner_scan(void) {
     /* Verify first token: "if" should be CAT_KEYWORD */
     tok = tl_get(&tokens, 0);
     assert(tok != NULL);
-    assert(tok->category == CAT_KEYWORD);
+    assert(token_category(tok) == CAT_KEYWORD);
 
     /* Verify "(" token: should be CAT_SPECIALCHAR */
     tok = tl_get(&tokens, 1);
     assert(tok != NULL);
-    assert(tok->category == CAT_SPECIALCHAR);
+    assert(token_category(tok) == CAT_SPECIALCHAR);
 
     /* Verify "x" token: should be CAT_IDENTIFIER */
     tok = tl_get(&tokens, 2);
     assert(tok != NULL);
-    assert(tok->category == CAT_IDENTIFIER);
+    assert(token_category(tok) == CAT_IDENTIFIER);
 
     /* Verify ">" token: should be CAT_OPERATOR */
     tok = tl_get(&tokens, 3);
     assert(tok != NULL);
-    assert(tok->category == CAT_OPERATOR);
+    assert(token_category(tok) == CAT_OPERATOR);
 
     /* Verify "3" token: should be CAT_NUMBER */
     tok = tl_get(&tokens, 4);
     assert(tok != NULL);
-    assert(tok->category == CAT_NUMBER);
+    assert(token_category(tok) == CAT_NUMBER);
 
     /* Verify literal "true" token */
     tok = tl_get(&tokens, 8);
     assert(tok != NULL);
-    assert(tok->category == CAT_LITERAL);
+    assert(token_category(tok) == CAT_LITERAL);
 
     /* Verify "else" keyword */
     tok = tl_get(&tokens, 11);
     assert(tok != NULL);
-    assert(tok->category == CAT_KEYWORD);
+    assert(token_category(tok) == CAT_KEYWORD);
 
     tl_free(&tokens);
 
@@ -281,19 +361,19 @@ static void test_blank_lines(void) {
     /* "int" is keyword on line 1 */
     tok = tl_get(&tokens, 0);
     assert(tok != NULL);
-    assert(tok->category == CAT_KEYWORD);
-    assert(tok->line == 1);
+    assert(token_category(tok) == CAT_KEYWORD);
+    assert(token_line(tok) == 1);
 
     /* "return" is keyword on line 4 (after 2 blank lines) */
     tok = tl_get(&tokens, 3);
     assert(tok != NULL);
-    assert(tok->category == CAT_KEYWORD);
-    assert(tok->line == 4);
+    assert(token_category(tok) == CAT_KEYWORD);
+    assert(token_line(tok) == 4);
 
     /* "0" is number on line 4 */
     tok = tl_get(&tokens, 4);
     assert(tok != NULL);
-    assert(tok->category == CAT_NUMBER);
+    assert(token_category(tok) == CAT_NUMBER);
 
     tl_free(&tokens);
 
@@ -340,17 +420,17 @@ static void test_unterminated_literal(void) {
     /* Token 0: "x" IDENTIFIER */
     tok = tl_get(&tokens, 0);
     assert(tok != NULL);
-    assert(tok->category == CAT_IDENTIFIER);
+    assert(token_category(tok) == CAT_IDENTIFIER);
 
     /* Token 1: "=" OPERATOR */
     tok = tl_get(&tokens, 1);
     assert(tok != NULL);
-    assert(tok->category == CAT_OPERATOR);
+    assert(token_category(tok) == CAT_OPERATOR);
 
     /* Token 2: unterminated literal → NONRECOGNIZED */
     tok = tl_get(&tokens, 2);
     assert(tok != NULL);
-    assert(tok->category == CAT_NONRECOGNIZED);
+    assert(token_category(tok) == CAT_NONRECOGNIZED);
 
     tl_free(&tokens);
 
@@ -396,32 +476,32 @@ static void test_grouped_nonrecognized(void) {
     /* Token 0: "x" IDENTIFIER */
     tok = tl_get(&tokens, 0);
     assert(tok != NULL);
-    assert(tok->category == CAT_IDENTIFIER);
+    assert(token_category(tok) == CAT_IDENTIFIER);
 
     /* Token 1: "=" OPERATOR */
     tok = tl_get(&tokens, 1);
     assert(tok != NULL);
-    assert(tok->category == CAT_OPERATOR);
+    assert(token_category(tok) == CAT_OPERATOR);
 
     /* Token 2: "@#$" grouped NONRECOGNIZED */
     tok = tl_get(&tokens, 2);
     assert(tok != NULL);
-    assert(tok->category == CAT_NONRECOGNIZED);
+    assert(token_category(tok) == CAT_NONRECOGNIZED);
 
     /* Token 3: "+" OPERATOR */
     tok = tl_get(&tokens, 3);
     assert(tok != NULL);
-    assert(tok->category == CAT_OPERATOR);
+    assert(token_category(tok) == CAT_OPERATOR);
 
     /* Token 4: "y" IDENTIFIER */
     tok = tl_get(&tokens, 4);
     assert(tok != NULL);
-    assert(tok->category == CAT_IDENTIFIER);
+    assert(token_category(tok) == CAT_IDENTIFIER);
 
     /* Token 5: ";" SPECIALCHAR */
     tok = tl_get(&tokens, 5);
     assert(tok != NULL);
-    assert(tok->category == CAT_SPECIALCHAR);
+    assert(token_category(tok) == CAT_SPECIALCHAR);
 
     tl_free(&tokens);
 
@@ -521,13 +601,2197 @@ static void test_null_counter_pointer(void) {
     printf("  NULL counter pointer tests PASSED\n");
 }
 
+/* ---- Test: char_stream backends ---- */
+
+/*
+ * test_char_stream_mmap - verifies the mmap backend keeps the same
+ * peek/get, line/col and CS_EOF semantics, including empty files.
+ */
+static void test_char_stream_mmap(void) {
+    char_stream_t cs;
+    FILE *fp;
+    int result;
+
+    printf("  Testing char_stream mmap backend...\n");
+
+    fp = fopen(TEST_INPUT_FILE, "w");
+    assert(fp != NULL);
+    fprintf(fp, "ab\nc");
+    fclose(fp);
+
+    result = cs_open(&cs, TEST_INPUT_FILE);
+    assert(result == 0);
+#if CS_USE_MMAP
+    assert(cs.mode == CS_MODE_MMAP);
+#endif
+    assert(cs_peek(&cs) == 'a');
+    assert(cs_peek(&cs) == 'a');
+    assert(cs_get(&cs) == 'a');
+    assert(cs_line(&cs) == 1 && cs_col(&cs) == 2);
+    assert(cs_get(&cs) == 'b');
+    assert(cs_get(&cs) == '\n');
+    assert(cs_line(&cs) == 2 && cs_col(&cs) == 1);
+    assert(cs_get(&cs) == 'c');
+    assert(cs_peek(&cs) == CS_EOF);
+    assert(cs_get(&cs) == CS_EOF);
+    assert(cs_line(&cs) == 2 && cs_col(&cs) == 2);
+    cs_close(&cs);
+
+    /* Empty file: immediate EOF */
+    fp = fopen(TEST_INPUT_FILE, "w");
+    assert(fp != NULL);
+    fclose(fp);
+    result = cs_open(&cs, TEST_INPUT_FILE);
+    assert(result == 0);
+    assert(cs_peek(&cs) == CS_EOF);
+    assert(cs_get(&cs) == CS_EOF);
+    cs_close(&cs);
+
+    printf("  char_stream mmap tests PASSED\n");
+}
+
+#if CS_HAVE_POSIX_IO
+/*
+ * test_char_stream_buffered - streams more than one buffer through a pipe
+ * and checks every byte plus final line/col across refills, and that a
+ * failed read is flagged instead of passing for end of input.
+ */
+static void test_char_stream_buffered(void) {
+    char_stream_t cs;
+    int fds[2];
+    pid_t pid;
+    long i;
+    int ch;
+    int result;
+
+    printf("  Testing char_stream buffered backend...\n");
+
+    assert(pipe(fds) == 0);
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        /* Writer child: TEST_PIPE_BYTES bytes, one newline every 100 */
+        char block[100];
+        close(fds[0]);
+        for (i = 0; i < 99; i++) {
+            block[i] = (char)('a' + (i % 26));
+        }
+        block[99] = '\n';
+        for (i = 0; i < TEST_PIPE_BYTES / 100; i++) {
+            if (write(fds[1], block, sizeof(block)) != (ssize_t)sizeof(block)) {
+                _exit(1);
+            }
+        }
+        close(fds[1]);
+        _exit(0);
+    }
+    close(fds[1]);
+
+    result = cs_open_fd(&cs, fds[0]);
+    assert(result == 0);
+    assert(cs.mode == CS_MODE_BUFFERED);
+    for (i = 0; i < TEST_PIPE_BYTES; i++) {
+        int expected = (i % 100 == 99) ? '\n' : 'a' + (int)((i % 100) % 26);
+        assert(cs_peek(&cs) == expected);
+        ch = cs_get(&cs);
+        assert(ch == expected);
+    }
+    assert(cs_peek(&cs) == CS_EOF);
+    assert(cs_get(&cs) == CS_EOF);
+    assert(cs_line(&cs) == TEST_PIPE_BYTES / 100 + 1);
+    assert(cs_col(&cs) == 1);
+    cs_close(&cs);
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+
+    /* A failed read ends the stream and is reported (EISDIR here). */
+    assert(cs_error(&cs) == 0);
+    fds[0] = open(TEST_READ_ERROR_DIR, O_RDONLY);
+    assert(fds[0] >= 0);
+    assert(cs_open_fd(&cs, fds[0]) == 0);
+    assert(cs_get(&cs) == CS_EOF);
+    assert(cs_error(&cs) == 1);
+    cs_close(&cs);
+    assert(cs_error(&cs) == 0);
+    close(fds[0]);
+
+    /* Only the exact name selects stdin. */
+    assert(cs_is_stdin_name(CS_STDIN_NAME) == 1);
+    assert(cs_is_stdin_name("--") == 0);
+    assert(cs_is_stdin_name("") == 0);
+    assert(cs_is_stdin_name(NULL) == 0);
+
+    printf("  char_stream buffered tests PASSED\n");
+}
+#endif
+
+/* ---- Test: character class table ---- */
+
+/*
+ * test_classify_table - checks the compile-time class map against the
+ * lang_spec predicates for every byte value.
+ */
+static void test_classify_table(void) {
+    int ch;
+    char_class_t expected;
+
+    printf("  Testing character class table...\n");
+
+    for (ch = 0; ch < 256; ch++) {
+        char c = (char)ch;
+        if (ls_is_letter(c)) {
+            expected = CC_LETTER;
+        } else if (ls_is_digit(c)) {
+            expected = CC_DIGIT;
+        } else if (ls_is_quote(c)) {
+            expected = CC_QUOTE;
+        } else if (ls_is_operator(c)) {
+            expected = CC_OPERATOR;
+        } else if (ls_is_special_char(c)) {
+            expected = CC_SPECIAL;
+        } else if (c == WS_NL) {
+            expected = CC_NEWLINE;
+        } else if (ls_is_whitespace(c)) {
+            expected = CC_SPACE;
+        } else {
+            expected = CC_OTHER;
+        }
+        assert(classify_char(ch) == expected);
+    }
+    assert(classify_char(CS_EOF) == CC_EOF);
+
+    printf("  character class table tests PASSED\n");
+}
+
+/* ---- Test: fused DFA engine ---- */
+
+/*
+ * test_fused_engine - scans the same input with the MATRIX and FUSED
+ * engines and checks the token streams are identical.
+ */
+static void test_fused_engine(void) {
+    char_stream_t cs;
+    token_list_t matrix_tokens;
+    token_list_t fused_tokens;
+    logger_t lg;
+    FILE *fp;
+    int i;
+
+    printf("  Testing fused DFA engine...\n");
+
+    fp = fopen(TEST_INPUT_FILE, "w");
+    assert(fp != NULL);
+    fprintf(fp, "int x1 = 42;\n while(x1 > 0) { x1 = x1 + @@ 1; }\n");
+    fprintf(fp, "return \"ok\" * [a,b];\n\"open\n");
+    fclose(fp);
+
+    logger_init(&lg, stdout);
+    tl_init(&matrix_tokens);
+    tl_init(&fused_tokens);
+
+    assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+    assert(automata_scan_engine(&cs, &matrix_tokens, &lg, NULL,
+                                SCAN_ENGINE_MATRIX) == 0);
+    cs_close(&cs);
+
+    assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+    assert(automata_scan_engine(&cs, &fused_tokens, &lg, NULL,
+                                SCAN_ENGINE_FUSED) == 0);
+    cs_close(&cs);
+
+    assert(tl_count(&matrix_tokens) == tl_count(&fused_tokens));
+    for (i = 0; i < tl_count(&matrix_tokens); i++) {
+        const token_t *a = tl_get(&matrix_tokens, i);
+        const token_t *b = tl_get(&fused_tokens, i);
+        lexeme_view_t va = tl_lexeme(&matrix_tokens, a);
+        lexeme_view_t vb = tl_lexeme(&fused_tokens, b);
+        assert(token_category(a) == token_category(b));
+        assert(token_line(a) == token_line(b) && token_col(a) == token_col(b));
+        assert(va.len == vb.len);
+        assert(memcmp(va.data, vb.data, (size_t)va.len) == 0);
+    }
+
+    tl_free(&matrix_tokens);
+    tl_free(&fused_tokens);
+
+    printf("  fused DFA engine tests PASSED\n");
+}
+
+/* ---- Test: keyword trie engine ---- */
+
+/*
+ * test_trie_engine - scans keyword-like input with the MATRIX and TRIE
+ * engines: same tokens, and keywords/prefixes/extensions classified alike.
+ */
+static void test_trie_engine(void) {
+    char_stream_t cs;
+    token_list_t matrix_tokens;
+    token_list_t trie_tokens;
+    logger_t lg;
+    FILE *fp;
+    int keywords = 0;
+    int i;
+
+    printf("  Testing keyword trie engine...\n");
+
+    fp = fopen(TEST_INPUT_FILE, "w");
+    assert(fp != NULL);
+    fprintf(fp, "if iff i ifx if1 else els elsex while whil whiles\n");
+    fprintf(fp, "return returnx int in integer char cha void voi\n");
+    fprintf(fp, "IF Int w e 3if if(x) { return 0; } \"while\" @if\n");
+    fprintf(fp, "void");
+    fclose(fp);
+
+    logger_init(&lg, stdout);
+    tl_init(&matrix_tokens);
+    tl_init(&trie_tokens);
+
+    assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+    assert(automata_scan_engine(&cs, &matrix_tokens, &lg, NULL,
+                                SCAN_ENGINE_MATRIX) == 0);
+    cs_close(&cs);
+
+    assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+    assert(automata_scan_engine(&cs, &trie_tokens, &lg, NULL,
+                                SCAN_ENGINE_TRIE) == 0);
+    cs_close(&cs);
+
+    assert(tl_count(&matrix_tokens) == tl_count(&trie_tokens));
+    for (i = 0; i < tl_count(&matrix_tokens); i++) {
+        const token_t *a = tl_get(&matrix_tokens, i);
+        const token_t *b = tl_get(&trie_tokens, i);
+        lexeme_view_t va = tl_lexeme(&matrix_tokens, a);
+        lexeme_view_t vb = tl_lexeme(&trie_tokens, b);
+        assert(token_category(a) == token_category(b));
+        assert(token_line(a) == token_line(b) && token_col(a) == token_col(b));
+        assert(va.len == vb.len);
+        assert(memcmp(va.data, vb.data, (size_t)va.len) == 0);
+        if (token_category(b) == CAT_KEYWORD) {
+            keywords++;
+        }
+    }
+    /* Lines 1-2: each keyword once. Line 3: 3|if, if(, return, @|if.
+     * Line 4: void at EOF. */
+    assert(keywords == NUM_KEYWORDS + 5);
+
+    tl_free(&matrix_tokens);
+    tl_free(&trie_tokens);
+
+    printf("  keyword trie engine tests PASSED\n");
+}
+
+/* ---- Test: zero-copy lexemes ---- */
+
+/*
+ * test_span_lexemes - scans a mapped input with the token list attached to
+ * it and checks the span views match a copying scan of the same file.
+ */
+static void test_span_lexemes(void) {
+    char_stream_t copy_cs;
+    char_stream_t span_cs;
+    token_list_t copied;
+    token_list_t spans;
+    logger_t lg;
+    const char *source;
+    size_t source_len;
+    int i;
+
+    printf("  Testing zero-copy lexemes...\n");
+
+    write_test_file();
+    logger_init(&lg, stdout);
+    tl_init(&copied);
+    tl_init(&spans);
+
+    assert(cs_open(&copy_cs, TEST_INPUT_FILE) == 0);
+    automata_scan(&copy_cs, &copied, &lg, NULL);
+    cs_close(&copy_cs);
+
+    assert(cs_open(&span_cs, TEST_INPUT_FILE) == 0);
+    source = cs_data(&span_cs, &source_len);
+    tl_set_source(&spans, source, source_len);
+    automata_scan(&span_cs, &spans, &lg, NULL);
+
+    assert(tl_count(&spans) == TEST_BASIC_EXPECTED_TOKENS);
+    assert(tl_count(&copied) == tl_count(&spans));
+    for (i = 0; i < tl_count(&spans); i++) {
+        const token_t *a = tl_get(&copied, i);
+        const token_t *b = tl_get(&spans, i);
+        lexeme_view_t va = tl_lexeme(&copied, a);
+        lexeme_view_t vb = tl_lexeme(&spans, b);
+#if CS_USE_MMAP
+        assert(b->flags & TOKEN_FLAG_SOURCE);
+        assert(vb.data == source + b->lexeme);
+#endif
+        assert(token_category(a) == token_category(b));
+        assert(token_line(a) == token_line(b) && token_col(a) == token_col(b));
+        assert(va.len == vb.len);
+        assert(memcmp(va.data, vb.data, (size_t)va.len) == 0);
+    }
+
+    tl_free(&spans);
+    cs_close(&span_cs);
+    tl_free(&copied);
+
+    printf("  zero-copy lexeme tests PASSED\n");
+}
+
+/* ---- Test: pull scanner ---- */
+
+/*
+ * test_pull_scanner - pulls tokens one at a time with lookahead and checks
+ * them against a full scan of the same input.
+ */
+static void test_pull_scanner(void) {
+    char_stream_t cs;
+    token_list_t all;
+    scanner_t sc;
+    logger_t lg;
+    const scanner_token_t *tok;
+    int i = 0;
+    int k;
+
+    printf("  Testing pull scanner...\n");
+
+    write_test_file();
+    logger_init(&lg, stdout);
+    tl_init(&all);
+    assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+    automata_scan(&cs, &all, &lg, NULL);
+    cs_close(&cs);
+
+    assert(scanner_open(&sc, TEST_INPUT_FILE, &lg, NULL, SCAN_ENGINE) == 0);
+    assert(scanner_peek(&sc, 0) == NULL);
+    assert(scanner_peek(&sc, SCANNER_LOOKAHEAD + 1) == NULL);
+    while ((tok = scanner_next(&sc)) != NULL) {
+        const token_t *want = tl_get(&all, i);
+        lexeme_view_t lex = tl_lexeme(&all, want);
+
+        assert(want != NULL);
+        assert(token_category(&tok->tok) == token_category(want));
+        assert(token_line(&tok->tok) == token_line(want));
+        assert(token_col(&tok->tok) == token_col(want));
+        assert(tok->lex.len == lex.len);
+        assert(memcmp(tok->lex.data, lex.data, (size_t)lex.len) == 0);
+
+        /* Peeking never disturbs the token just returned. */
+        for (k = 1; k <= SCANNER_LOOKAHEAD; k++) {
+            const scanner_token_t *ahead = scanner_peek(&sc, k);
+            const token_t *next = tl_get(&all, i + k);
+
+            assert((ahead == NULL) == (next == NULL));
+            if (ahead != NULL) {
+                assert(token_col(&ahead->tok) == token_col(next));
+                assert(token_line(&ahead->tok) == token_line(next));
+            }
+        }
+        assert(token_col(&tok->tok) == token_col(want));
+        i++;
+    }
+    assert(i == tl_count(&all));
+    assert(scanner_next(&sc) == NULL);
+    assert(scanner_peek(&sc, 1) == NULL);
+    scanner_close(&sc);
+    tl_free(&all);
+
+    printf("  pull scanner tests PASSED\n");
+}
+
+/* ---- Test: pipelined scan ---- */
+
+/*
+ * read_capture - returns the bytes written to a capture file (caller frees).
+ */
+static char* read_capture(FILE *fp, long *len) {
+    char *data;
+
+    fflush(fp);
+    *len = ftell(fp);
+    data = (char *)malloc((size_t)*len + 1);
+    assert(data != NULL);
+    rewind(fp);
+    assert(fread(data, 1, (size_t)*len, fp) == (size_t)*len);
+    return data;
+}
+
+/*
+ * read_whole_file - returns the contents of path (caller frees).
+ */
+static char* read_whole_file(const char *path, long *len) {
+    FILE *fp = fopen(path, "rb");
+    char *data;
+
+    assert(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    *len = ftell(fp);
+    rewind(fp);
+    data = (char *)malloc((size_t)*len + 1);
+    assert(data != NULL);
+    assert(fread(data, 1, (size_t)*len, fp) == (size_t)*len);
+    fclose(fp);
+    return data;
+}
+
+/*
+ * test_pipeline - pushes a few ring wraps of tokens through the SPSC ring
+ * and checks the pipelined .cscn matches the sequential writer byte for
+ * byte.
+ */
+static void test_pipeline(void) {
+    char_stream_t cs;
+    token_list_t seq_tokens;
+    token_list_t pipe_tokens;
+    scanner_ctx_t ctx;
+    logger_t lg;
+    FILE *fp;
+    char *seq_text;
+    char *pipe_text;
+    long seq_len;
+    long pipe_len;
+    const char *source;
+    size_t source_len;
+    int write_status = -1;
+    int i;
+
+    printf("  Testing pipelined scan...\n");
+
+    fp = fopen(TEST_INPUT_FILE, "w");
+    assert(fp != NULL);
+    for (i = 0; i < TEST_PIPE_LINES; i++) {
+        fprintf(fp, "int v%d = %d; if (v%d) return \"s\";\n", i, i, i);
+        if (i % 100 == 0) {
+            fputs("\n@ while\n", fp);
+        }
+    }
+    fclose(fp);
+    logger_init(&lg, stdout);
+
+    tl_init(&seq_tokens);
+    assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+    automata_scan(&cs, &seq_tokens, &lg, NULL);
+    cs_close(&cs);
+    assert(ow_write_token_file(&seq_tokens, TEST_OUTPUT_FILE) == 0);
+    assert(tl_count(&seq_tokens) > SPSC_RING_SIZE * 4);
+
+    tl_init(&pipe_tokens);
+    assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+    source = cs_data(&cs, &source_len);
+    tl_set_source(&pipe_tokens, source, source_len);
+    scanner_ctx_init(&ctx, NULL, stdout);
+    ctx.cfg.debug = DEBUG_OFF;
+    assert(pipeline_run(&cs, &pipe_tokens, &ctx, TEST_PIPE_OUTPUT_FILE,
+                        &write_status) == 0);
+    assert(write_status == 0);
+    assert(tl_count(&pipe_tokens) == tl_count(&seq_tokens));
+
+    seq_text = read_whole_file(TEST_OUTPUT_FILE, &seq_len);
+    pipe_text = read_whole_file(TEST_PIPE_OUTPUT_FILE, &pipe_len);
+    assert(seq_len == pipe_len);
+    assert(memcmp(seq_text, pipe_text, (size_t)seq_len) == 0);
+
+    free(seq_text);
+    free(pipe_text);
+    tl_free(&pipe_tokens);
+    cs_close(&cs);
+    tl_free(&seq_tokens);
+    remove(TEST_PIPE_OUTPUT_FILE);
+
+    printf("  pipelined scan tests PASSED\n");
+}
+
+/* ---- Test: buffered output formatter ---- */
+
+/*
+ * fmt_reference - writes tokens with printf-style formatting (the .cscn
+ * format spelled out token by token) to fp.
+ */
+static void fmt_reference(const token_list_t *tokens, int format, FILE *fp) {
+    int line = -1;
+    int i;
+
+    for (i = 0; i < tl_count(tokens); i++) {
+        const token_t *tok = tl_get(tokens, i);
+        lexeme_view_t lex = tl_lexeme(tokens, tok);
+
+        if (token_line(tok) != line) {
+            if (line != -1) {
+                fputs(format == OUTFORMAT_DEBUG ? "\n\n" : "\n", fp);
+            }
+            if (format == OUTFORMAT_DEBUG) {
+                fprintf(fp, "%d ", token_line(tok));
+            }
+            line = token_line(tok);
+        } else {
+            fputc(' ', fp);
+        }
+        fprintf(fp, "<%.*s, %s>", lex.len, lex.data,
+                ls_get_category_name(token_category(tok)));
+    }
+    if (line != -1) {
+        fputs(format == OUTFORMAT_DEBUG ? "\n\n" : "\n", fp);
+    }
+}
+
+/*
+ * test_output_buffer - output spanning many buffer flushes, including a
+ * lexeme of the maximum token length, matches the reference formatting in
+ * RELEASE and DEBUG, to a file and to an open stream.
+ */
+static void test_output_buffer(void) {
+    static const token_category_t cats[] = {
+        CAT_NUMBER, CAT_IDENTIFIER, CAT_KEYWORD, CAT_LITERAL, CAT_OPERATOR,
+        CAT_SPECIALCHAR, CAT_NONRECOGNIZED
+    };
+    token_list_t tokens;
+    scanner_ctx_t ctx;
+    FILE *ref;
+    FILE *out;
+    char *big;
+    char *a;
+    char *b;
+    char lex[32];
+    long alen;
+    long blen;
+    int format;
+    int i;
+
+    printf("  Testing buffered output formatter...\n");
+
+    tl_init(&tokens);
+    for (i = 0; i < TEST_FMT_LINES; i++) {
+        int n = snprintf(lex, sizeof(lex), "v%d", i);
+
+        tl_add_lexeme(&tokens, lex, n, cats[i % 7], i * 3 + 1, 1);
+        tl_add_lexeme(&tokens, "=", 1, CAT_OPERATOR, i * 3 + 1, n + 2);
+        if (i == TEST_FMT_LINES / 2) {
+            big = (char *)malloc(UINT16_MAX);
+            assert(big != NULL);
+            memset(big, 'x', UINT16_MAX);
+            tl_add_lexeme(&tokens, big, UINT16_MAX, CAT_LITERAL, i * 3 + 1,
+                          n + 4);
+            free(big);
+        }
+    }
+    tl_add_lexeme(&tokens, "", 0, CAT_NONRECOGNIZED, TEST_FMT_LINES * 3, 1);
+
+    for (format = OUTFORMAT_RELEASE; format <= OUTFORMAT_DEBUG; format++) {
+        ref = tmpfile();
+        out = tmpfile();
+        assert(ref != NULL && out != NULL);
+        fmt_reference(&tokens, format, ref);
+        scanner_ctx_init(&ctx, NULL, stdout);
+        ctx.cfg.debug = DEBUG_OFF;
+        ctx.cfg.outformat = format;
+        assert(ow_write_token_stream_ctx(&tokens, out, &ctx) == 0);
+        a = read_capture(ref, &alen);
+        b = read_capture(out, &blen);
+        assert(alen > OW_BUF_SIZE * 2);
+        assert(alen == blen && memcmp(a, b, (size_t)alen) == 0);
+        free(b);
+
+        assert(ow_write_token_file_ctx(&tokens, TEST_OUTPUT_FILE, &ctx) == 0);
+        b = read_whole_file(TEST_OUTPUT_FILE, &blen);
+        assert(alen == blen && memcmp(a, b, (size_t)alen) == 0);
+        free(a);
+        free(b);
+        fclose(ref);
+        fclose(out);
+    }
+    remove(TEST_OUTPUT_FILE);
+    tl_free(&tokens);
+
+    printf("  buffered output formatter tests PASSED\n");
+}
+
+/* ---- Test: parallel output writer ---- */
+
+/*
+ * par_out_compare - writes tokens sequentially and on several threads with
+ * the format and message routing of ctx, over files that start with prefix
+ * (DEBUG_ON appends), and checks both files are identical.
+ */
+static void par_out_compare(const token_list_t *tokens, scanner_ctx_t *ctx,
+                            const char *prefix) {
+    const char *paths[2] = { TEST_PAR_OUT_SEQ, TEST_PAR_OUT_PAR };
+    char *a;
+    char *b;
+    long alen;
+    long blen;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        FILE *fp = fopen(paths[i], "w");
+
+        assert(fp != NULL);
+        fputs(prefix, fp);
+        fclose(fp);
+    }
+    ctx->cfg.threads = 1;
+    assert(ow_write_token_file_ctx(tokens, TEST_PAR_OUT_SEQ, ctx) == 0);
+    assert(ow_write_token_file_parallel(tokens, TEST_PAR_OUT_PAR, ctx,
+                                        TEST_PAR_OUT_THREADS) == 0);
+    a = read_whole_file(TEST_PAR_OUT_SEQ, &alen);
+    b = read_whole_file(TEST_PAR_OUT_PAR, &blen);
+    assert(alen == blen && memcmp(a, b, (size_t)alen) == 0);
+    free(a);
+    free(b);
+}
+
+/*
+ * test_output_parallel - the parallel writer produces the sequential file
+ * in RELEASE and DEBUG, after DEBUG_ON messages, with long lines around the
+ * part cuts and with a list on a single line (no cut possible).
+ */
+static void test_output_parallel(void) {
+    token_list_t tokens;
+    token_list_t one_line;
+    scanner_ctx_t ctx;
+    char lex[32];
+    int line = 1;
+    int i;
+    int j;
+
+    printf("  Testing parallel output writer...\n");
+
+    tl_init(&tokens);
+    for (i = 0; i < TEST_PAR_OUT_LINES; i++) {
+        /* 1..16 tokens per line, some lines skipped (blank input lines). */
+        int per_line = 1 + (i * 7) % 16;
+
+        for (j = 0; j < per_line; j++) {
+            int n = snprintf(lex, sizeof(lex), "t%d_%d", i, j);
+
+            tl_add_lexeme(&tokens, lex, n, (token_category_t)(j % CAT_COUNT),
+                          line, 1 + j * 8);
+        }
+        line += 1 + (i % 3 == 0);
+    }
+    assert(tl_count(&tokens) > OW_PAR_MIN_TOKENS * TEST_PAR_OUT_THREADS);
+
+    scanner_ctx_init(&ctx, NULL, stdout);
+    ctx.cfg.debug = DEBUG_OFF;
+    ctx.cfg.outformat = OUTFORMAT_RELEASE;
+    par_out_compare(&tokens, &ctx, "");
+    ctx.cfg.outformat = OUTFORMAT_DEBUG;
+    par_out_compare(&tokens, &ctx, "");
+    ctx.cfg.debug = DEBUG_ON;
+    par_out_compare(&tokens, &ctx, "[ERROR 4][SCANNER] Line 1: message\n");
+
+    /* A single source line cannot be cut: one part. */
+    tl_init(&one_line);
+    for (i = 0; i < OW_PAR_MIN_TOKENS * 2; i++) {
+        tl_add_lexeme(&one_line, "x", 1, CAT_IDENTIFIER, 7, 1 + i);
+    }
+    ctx.cfg.debug = DEBUG_OFF;
+    par_out_compare(&one_line, &ctx, "");
+
+    tl_free(&one_line);
+    tl_free(&tokens);
+    remove(TEST_PAR_OUT_SEQ);
+    remove(TEST_PAR_OUT_PAR);
+
+    printf("  parallel output writer tests PASSED\n");
+}
+
+/* ---- Test: streaming output ---- */
+
+/*
+ * test_stream_output - streamed output equals the whole-list output in
+ * RELEASE and DEBUG, for span and copied lexemes, with a line longer than
+ * several token blocks; the scratch list ends empty with one block.
+ */
+static void test_stream_output(void) {
+    scanner_ctx_t ctx;
+    char_stream_t cs;
+    token_list_t whole;
+    token_list_t scratch;
+    FILE *fp;
+    FILE *log;
+    char *a;
+    char *b;
+    const char *source;
+    size_t source_len;
+    long alen;
+    long blen;
+    int write_status;
+    int count;
+    int format;
+    int spans;
+    int i;
+
+    printf("  Testing streaming output...\n");
+
+    fp = fopen(TEST_INPUT_FILE, "w");
+    assert(fp != NULL);
+    for (i = 0; i < TEST_STREAM_LINES; i++) {
+        fprintf(fp, "int v%d = %d; @ \"s%d\"\n", i, i, i);
+        if (i % 50 == 0) {
+            fputs("\n\"open\n", fp);
+        }
+        if (i == TEST_STREAM_LINES / 2) {
+            int j;
+
+            for (j = 0; j < TEST_STREAM_LONG_LINE; j++) {
+                fputs("x ", fp);
+            }
+            fputc('\n', fp);
+        }
+    }
+    fclose(fp);
+    log = tmpfile();
+    assert(log != NULL);
+
+    for (format = OUTFORMAT_RELEASE; format <= OUTFORMAT_DEBUG; format++) {
+        for (spans = 0; spans <= 1; spans++) {
+            scanner_ctx_init(&ctx, NULL, log);
+            ctx.cfg.debug = DEBUG_OFF;
+            ctx.cfg.threads = 1;
+            ctx.cfg.outformat = format;
+
+            tl_init(&whole);
+            assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+            automata_scan_engine(&cs, &whole, &ctx.lg, NULL, ctx.cfg.engine);
+            cs_close(&cs);
+            assert(ow_write_token_file_ctx(&whole, TEST_OUTPUT_FILE, &ctx) == 0);
+
+            tl_init(&scratch);
+            assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+            if (spans) {
+                source = cs_data(&cs, &source_len);
+                tl_set_source(&scratch, source, source_len);
+            }
+            assert(pipeline_stream(&cs, &scratch, &ctx, TEST_STREAM_OUTPUT,
+                                   &write_status, &count) == 0);
+            cs_close(&cs);
+            assert(write_status == 0);
+            assert(count == tl_count(&whole));
+            assert(count > TEST_STREAM_LONG_LINE + TEST_STREAM_LINES * 6);
+            assert(tl_count(&scratch) == 0);
+            assert(scratch.capacity == TL_BLOCK_TOKENS);
+            assert(scratch.lex_nchunks <= 1);
+
+            a = read_whole_file(TEST_OUTPUT_FILE, &alen);
+            b = read_whole_file(TEST_STREAM_OUTPUT, &blen);
+            assert(alen == blen && memcmp(a, b, (size_t)alen) == 0);
+            free(a);
+            free(b);
+            tl_free(&scratch);
+            tl_free(&whole);
+        }
+    }
+    remove(TEST_STREAM_OUTPUT);
+    fclose(log);
+
+    printf("  streaming output tests PASSED\n");
+}
+
+/* ---- Test: DEBUG output session ---- */
+
+/*
+ * session_messages - reports TEST_SESSION_MESSAGES errors through ctx.
+ */
+static void session_messages(scanner_ctx_t *ctx) {
+    int i;
+
+    for (i = 0; i < TEST_SESSION_MESSAGES; i++) {
+        err_report_ctx(ctx, ERR_NONRECOGNIZED, ERR_STEP_SCANNER, i + 1, "@");
+    }
+}
+
+/*
+ * test_output_session - messages, tokens and a trailing message written
+ * through one output session match the separate open-write-close-append
+ * sequence, and a session that cannot be opened fails cleanly.
+ */
+static void test_output_session(void) {
+    token_list_t tokens;
+    scanner_ctx_t ctx;
+    ow_session_t session;
+    FILE *fp;
+    char *a;
+    char *b;
+    char lex[32];
+    long alen;
+    long blen;
+    int format;
+    int i;
+
+    printf("  Testing DEBUG output session...\n");
+
+    tl_init(&tokens);
+    for (i = 0; i < TEST_FMT_LINES; i++) {
+        int n = snprintf(lex, sizeof(lex), "s%d", i);
+
+        tl_add_lexeme(&tokens, lex, n, CAT_IDENTIFIER, i + 1, 1);
+        tl_add_lexeme(&tokens, ";", 1, CAT_SPECIALCHAR, i + 1, n + 1);
+    }
+
+    for (format = OUTFORMAT_RELEASE; format <= OUTFORMAT_DEBUG; format++) {
+        scanner_ctx_init(&ctx, NULL, stdout);
+        ctx.cfg.debug = DEBUG_ON;
+        ctx.cfg.threads = 1;
+        ctx.cfg.outformat = format;
+
+        // Reference: messages to their own handle, then tokens appended.
+        fp = fopen(TEST_OUTPUT_FILE, "w");
+        assert(fp != NULL);
+        logger_init_dest(&ctx.lg, fp);
+        session_messages(&ctx);
+        fclose(fp);
+        logger_init_dest(&ctx.lg, stdout);
+        assert(ow_write_token_file_ctx(&tokens, TEST_OUTPUT_FILE, &ctx) == 0);
+        fp = fopen(TEST_OUTPUT_FILE, "a");
+        assert(fp != NULL);
+        err_report(fp, ERR_INTERNAL, ERR_STEP_DRIVER, 0, "after tokens");
+        fclose(fp);
+
+        assert(ow_session_open(&session, TEST_SESSION_OUTPUT) == 0);
+        logger_init_dest(&ctx.lg, ow_session_file(&session));
+        session_messages(&ctx);
+        assert(ow_session_write_tokens(&session, &tokens, &ctx) == 0);
+        err_report(ow_session_file(&session), ERR_INTERNAL, ERR_STEP_DRIVER,
+                   0, "after tokens");
+        assert(ow_session_close(&session) == 0);
+        assert(ow_session_file(&session) == stdout);
+        logger_init_dest(&ctx.lg, stdout);
+
+        a = read_whole_file(TEST_OUTPUT_FILE, &alen);
+        b = read_whole_file(TEST_SESSION_OUTPUT, &blen);
+        assert(alen > OW_BUF_SIZE * 2);
+        assert(alen == blen && memcmp(a, b, (size_t)alen) == 0);
+        free(a);
+        free(b);
+    }
+    remove(TEST_OUTPUT_FILE);
+    remove(TEST_SESSION_OUTPUT);
+
+    assert(ow_session_open(&session, "/nonexistent_dir/out.cscn") == -1);
+    assert(ow_session_file(&session) == stdout);
+    assert(ow_session_close(&session) == -1);
+    tl_free(&tokens);
+
+    printf("  DEBUG output session tests PASSED\n");
+}
+
+/* ---- Test: write-if-changed output ---- */
+
+/*
+ * keep_inode - returns the inode of path (0 when missing); a rename over
+ * the file gives it a new one.
+ */
+static long keep_inode(const char *path) {
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        return 0;
+    }
+    return (long)st.st_ino;
+}
+
+/*
+ * keep_temp_files - returns the temporary files of TEST_KEEP_OUTPUT left in
+ * TEST_KEEP_DIR.
+ */
+static int keep_temp_files(void) {
+    DIR *dir = opendir(TEST_KEEP_DIR);
+    struct dirent *ent;
+    int n = 0;
+
+    assert(dir != NULL);
+    while ((ent = readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, TEST_KEEP_TMP_PREFIX,
+                    strlen(TEST_KEEP_TMP_PREFIX)) == 0) {
+            n++;
+        }
+    }
+    closedir(dir);
+    return n;
+}
+
+/* One concurrent writer: its list, settings and status. */
+typedef struct {
+    const token_list_t *tokens;
+    scanner_ctx_t ctx;
+    int status;
+} test_keep_writer_t;
+
+/*
+ * test_keep_writer_main - rewrites TEST_KEEP_OUTPUT TEST_KEEP_ROUNDS times.
+ */
+static void* test_keep_writer_main(void *arg) {
+    test_keep_writer_t *w = (test_keep_writer_t *)arg;
+    int i;
+
+    w->status = 0;
+    for (i = 0; i < TEST_KEEP_ROUNDS; i++) {
+        if (ow_write_token_file_ctx(w->tokens, TEST_KEEP_OUTPUT,
+                                    &w->ctx) != 0) {
+            w->status = -1;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * test_output_unchanged - with keep_unchanged, an identical file keeps its
+ * inode, while a file that differs (same size, shorter, missing) is
+ * replaced with the exact output, no temporary file is left behind, and
+ * concurrent writers of one file never install a partial output.
+ */
+static void test_output_unchanged(void) {
+    token_list_t tokens;
+    token_list_t edited;
+    scanner_ctx_t ctx;
+    FILE *fp;
+    char *a;
+    char *b;
+    char lex[32];
+    long alen;
+    long blen;
+    long ino;
+    int format;
+    int threads;
+    int i;
+
+    printf("  Testing write-if-changed output...\n");
+
+    tl_init(&tokens);
+    tl_init(&edited);
+    for (i = 0; i < TEST_PAR_OUT_LINES; i++) {
+        int n = snprintf(lex, sizeof(lex), "k%d", i);
+
+        tl_add_lexeme(&tokens, lex, n, CAT_IDENTIFIER, i + 1, 1);
+        tl_add_lexeme(&tokens, "=", 1, CAT_OPERATOR, i + 1, n + 2);
+        tl_add_lexeme(&tokens, "0", 1, CAT_NUMBER, i + 1, n + 4);
+        tl_add_lexeme(&tokens, ";", 1, CAT_SPECIALCHAR, i + 1, n + 5);
+        // Same length, different bytes, near the end of the output.
+        if (i == TEST_PAR_OUT_LINES - 2) {
+            lex[0] = 'q';
+        }
+        tl_add_lexeme(&edited, lex, n, CAT_IDENTIFIER, i + 1, 1);
+        tl_add_lexeme(&edited, "=", 1, CAT_OPERATOR, i + 1, n + 2);
+        tl_add_lexeme(&edited, "0", 1, CAT_NUMBER, i + 1, n + 4);
+        tl_add_lexeme(&edited, ";", 1, CAT_SPECIALCHAR, i + 1, n + 5);
+    }
+
+    for (format = OUTFORMAT_RELEASE; format <= OUTFORMAT_DEBUG; format++) {
+        for (threads = 1; threads <= TEST_PAR_OUT_THREADS; threads += 3) {
+            scanner_ctx_init(&ctx, NULL, stdout);
+            ctx.cfg.debug = DEBUG_OFF;
+            ctx.cfg.threads = threads;
+            ctx.cfg.outformat = format;
+            ctx.cfg.keep_unchanged = 1;
+            remove(TEST_KEEP_OUTPUT);
+
+            // Missing file: written.
+            assert(ow_output_matches(&tokens, TEST_KEEP_OUTPUT, &ctx) == 0);
+            assert(ow_write_token_file_ctx(&tokens, TEST_KEEP_OUTPUT,
+                                           &ctx) == 0);
+            assert(ow_output_matches(&tokens, TEST_KEEP_OUTPUT, &ctx) == 1);
+
+            // Identical output: the file is not replaced.
+            ino = keep_inode(TEST_KEEP_OUTPUT);
+            assert(ow_write_token_file_ctx(&tokens, TEST_KEEP_OUTPUT,
+                                           &ctx) == 0);
+            assert(keep_inode(TEST_KEEP_OUTPUT) == ino);
+
+            // Same size, one byte different: replaced by the new output.
+            assert(ow_output_matches(&edited, TEST_KEEP_OUTPUT, &ctx) == 0);
+            assert(ow_write_token_file_ctx(&edited, TEST_KEEP_OUTPUT,
+                                           &ctx) == 0);
+            assert(keep_inode(TEST_KEEP_OUTPUT) != ino);
+            assert(keep_temp_files() == 0);
+            assert(ow_output_matches(&edited, TEST_KEEP_OUTPUT, &ctx) == 1);
+
+            // Truncated file: size differs, replaced.
+            fp = fopen(TEST_KEEP_OUTPUT, "w");
+            assert(fp != NULL);
+            fputs("<k0, CAT_IDENTIFIER>\n", fp);
+            fclose(fp);
+            assert(ow_output_matches(&tokens, TEST_KEEP_OUTPUT, &ctx) == 0);
+            assert(ow_write_token_file_ctx(&tokens, TEST_KEEP_OUTPUT,
+                                           &ctx) == 0);
+
+            // Same bytes as a plain write.
+            ctx.cfg.keep_unchanged = 0;
+            assert(ow_write_token_file_ctx(&tokens, TEST_OUTPUT_FILE,
+                                           &ctx) == 0);
+            a = read_whole_file(TEST_OUTPUT_FILE, &alen);
+            b = read_whole_file(TEST_KEEP_OUTPUT, &blen);
+            assert(alen == blen && memcmp(a, b, (size_t)alen) == 0);
+            free(a);
+            free(b);
+        }
+    }
+
+    /*
+     * Writers of two different outputs to the same file: every temporary
+     * file is private, so the file always ends up as one whole output.
+     */
+    {
+        test_keep_writer_t writers[TEST_KEEP_WRITERS];
+        pthread_t threads[TEST_KEEP_WRITERS];
+
+        for (i = 0; i < TEST_KEEP_WRITERS; i++) {
+            writers[i].tokens = (i % 2 == 0) ? &tokens : &edited;
+            scanner_ctx_init(&writers[i].ctx, NULL, stdout);
+            writers[i].ctx.cfg.debug = DEBUG_OFF;
+            writers[i].ctx.cfg.threads = 1;
+            writers[i].ctx.cfg.keep_unchanged = 1;
+            assert(pthread_create(&threads[i], NULL, test_keep_writer_main,
+                                  &writers[i]) == 0);
+        }
+        for (i = 0; i < TEST_KEEP_WRITERS; i++) {
+            pthread_join(threads[i], NULL);
+            assert(writers[i].status == 0);
+        }
+        assert(ow_output_matches(&tokens, TEST_KEEP_OUTPUT,
+                                 &writers[0].ctx) == 1 ||
+               ow_output_matches(&edited, TEST_KEEP_OUTPUT,
+                                 &writers[0].ctx) == 1);
+        assert(keep_temp_files() == 0);
+    }
+
+    remove(TEST_OUTPUT_FILE);
+    remove(TEST_KEEP_OUTPUT);
+    tl_free(&edited);
+    tl_free(&tokens);
+
+    printf("  write-if-changed output tests PASSED\n");
+}
+
+/* ---- Test: reentrant scanner contexts ---- */
+
+/* One scan of TEST_INPUT_FILE with its own context. */
+typedef struct {
+    scanner_ctx_t ctx;
+    char output[64];
+    FILE *log;
+    int tokens;
+} test_ctx_run_t;
+
+/*
+ * test_ctx_scan - scans TEST_INPUT_FILE and writes it with run->ctx.
+ */
+static void* test_ctx_scan(void *arg) {
+    test_ctx_run_t *run = (test_ctx_run_t *)arg;
+    char_stream_t cs;
+    token_list_t tokens;
+    const char *source;
+    size_t source_len;
+
+    tl_init(&tokens);
+    assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+    source = cs_data(&cs, &source_len);
+    tl_set_source(&tokens, source, source_len);
+    automata_scan_ctx(&cs, &tokens, &run->ctx);
+    err_report_ctx(&run->ctx, ERR_INTERNAL, ERR_STEP_DRIVER, 0, "done");
+    assert(ow_write_token_file_ctx(&tokens, run->output, &run->ctx) == 0);
+    run->tokens = tl_count(&tokens);
+    tl_free(&tokens);
+    cs_close(&cs);
+    return NULL;
+}
+
+/*
+ * setup_ctx_run - context i: RELEASE with counting, or DEBUG format
+ * without; messages captured in a temp file.
+ */
+static void setup_ctx_run(test_ctx_run_t *run, int i, const char *tag) {
+    scanner_config_t cfg;
+
+    scanner_config_default(&cfg);
+    cfg.debug = DEBUG_OFF;
+    cfg.threads = 1;
+    cfg.outformat = (i == 0) ? OUTFORMAT_RELEASE : OUTFORMAT_DEBUG;
+    cfg.count = (i == 0);
+    cfg.engine = (i == 0) ? SCAN_ENGINE_MATRIX : SCAN_ENGINE_TRIE;
+    run->log = tmpfile();
+    assert(run->log != NULL);
+    scanner_ctx_init(&run->ctx, &cfg, run->log);
+    snprintf(run->output, sizeof(run->output), TEST_CTX_OUTPUT_FMT, i, tag);
+}
+
+/*
+ * test_scanner_ctx - two scans with different settings run concurrently
+ * and must match the same scans run one after the other.
+ */
+static void test_scanner_ctx(void) {
+    test_ctx_run_t seq[TEST_CTX_RUNS];
+    test_ctx_run_t par[TEST_CTX_RUNS];
+    pthread_t threads[TEST_CTX_RUNS];
+    FILE *fp;
+    int i;
+
+    printf("  Testing reentrant scanner contexts...\n");
+
+    fp = fopen(TEST_INPUT_FILE, "w");
+    assert(fp != NULL);
+    for (i = 0; i < TEST_PIPE_LINES; i++) {
+        fprintf(fp, "if (v%d) x = \"s\"; @%d\n\"open\n", i, i);
+    }
+    fclose(fp);
+
+    for (i = 0; i < TEST_CTX_RUNS; i++) {
+        setup_ctx_run(&seq[i], i, "seq");
+        test_ctx_scan(&seq[i]);
+    }
+    for (i = 0; i < TEST_CTX_RUNS; i++) {
+        setup_ctx_run(&par[i], i, "par");
+        assert(pthread_create(&threads[i], NULL, test_ctx_scan, &par[i]) == 0);
+    }
+    for (i = 0; i < TEST_CTX_RUNS; i++) {
+        char *a;
+        char *b;
+        long alen;
+        long blen;
+
+        pthread_join(threads[i], NULL);
+        assert(par[i].tokens == seq[i].tokens);
+
+        a = read_whole_file(seq[i].output, &alen);
+        b = read_whole_file(par[i].output, &blen);
+        assert(alen == blen && memcmp(a, b, (size_t)alen) == 0);
+        /* Formats follow each context: DEBUG lines start with the line. */
+        assert(a[0] == ((i == 0) ? TOK_FMT_OPEN : '1'));
+        free(a);
+        free(b);
+
+        a = read_capture(seq[i].log, &alen);
+        b = read_capture(par[i].log, &blen);
+        assert(alen > 0 && alen == blen && memcmp(a, b, (size_t)alen) == 0);
+        free(a);
+        free(b);
+
+        fclose(seq[i].log);
+        fclose(par[i].log);
+        remove(seq[i].output);
+        remove(par[i].output);
+    }
+
+    /* Counting follows each context (only compiled in with COUNTCONFIG). */
+    assert(par[1].ctx.cnt.comp == 0);
+#ifdef COUNTCONFIG
+    assert(par[0].ctx.cnt.comp > 0);
+    assert(par[0].ctx.cnt.comp == seq[0].ctx.cnt.comp);
+#endif
+    printf("  reentrant scanner context tests PASSED\n");
+}
+
+/* ---- Test: token cache ---- */
+
+/*
+ * test_token_cache - stores a scan with errors, reloads it into an
+ * arena-backed list and checks tokens and replayed messages; changed input
+ * and damaged entries must miss.
+ */
+static void test_token_cache(void) {
+    static const char src[] =
+        "int x = 5 @ 3;\nchar *s = \"abc\nwhile (x) { y = $$; }\n";
+    token_cache_t tc;
+    tc_key_t key;
+    tc_key_t other;
+    scanner_ctx_t ctx;
+    char_stream_t cs;
+    token_list_t scanned;
+    token_list_t loaded;
+    arena_t arena;
+    char path[TC_PATH_MAX];
+    FILE *capture;
+    FILE *log;
+    FILE *replay;
+    FILE *fp;
+    char *a;
+    char *b;
+    size_t used;
+    long alen;
+    long blen;
+    int result = -1;
+    int i;
+
+    printf("  Testing token cache...\n");
+
+    /* XXH64 reference values. */
+    assert(tc_hash64("", 0, 0) == 0xEF46DB3751D8E999ULL);
+    assert(tc_hash64("abc", 3, 0) == 0x44BC2CF5AD770999ULL);
+    assert(tc_spec_hash() == tc_spec_hash());
+
+    /* The DFA tables hashed into the spec. */
+    assert(automata_next_state(ST_START, CC_DIGIT) == ST_IN_NUMBER);
+    assert(automata_next_state(ST_COUNT, CC_DIGIT) == ST_STOP);
+    assert(automata_state_category(ST_LIT_END) == CAT_LITERAL);
+    assert(automata_state_category(ST_START) == -1);
+
+    assert(tc_open(&tc, NULL) != 0 && !tc.enabled);
+    assert(tc_open(&tc, TEST_CACHE_DIR) == 0 && tc.enabled);
+    tc_key(&tc, &key, src, sizeof(src) - 1);
+
+    /* Miss: scan with messages captured, then store. */
+    log = tmpfile();
+    assert(log != NULL);
+    scanner_ctx_init(&ctx, NULL, log);
+    capture = tc_capture_begin(&tc);
+    assert(capture != NULL);
+    logger_init_dest(&ctx.lg, capture);
+    tl_init(&scanned);
+    assert(cs_open_view(&cs, src, sizeof(src) - 1, 0, sizeof(src) - 1,
+                        1, 1) == 0);
+    tl_set_source(&scanned, src, sizeof(src) - 1);
+    assert(automata_scan(&cs, &scanned, &ctx.lg, NULL) == 0);
+    tc_capture_end(&tc, log);
+    assert(tc_store(&tc, &key, &scanned, 0) == 0);
+
+    /* Hit: same tokens, same messages, no scan. */
+    arena_init(&arena, 0);
+    tl_init_arena(&loaded, &arena);
+    replay = tmpfile();
+    assert(replay != NULL);
+    assert(tc_load(&tc, &key, &loaded, &arena, replay, &result) == 0);
+    assert(result == 0);
+    assert(tl_count(&loaded) == tl_count(&scanned));
+    for (i = 0; i < tl_count(&scanned); i++) {
+        const token_t *x = tl_get(&scanned, i);
+        const token_t *y = tl_get(&loaded, i);
+        lexeme_view_t lx = tl_lexeme(&scanned, x);
+        lexeme_view_t ly = tl_lexeme(&loaded, y);
+
+        assert(token_category(x) == token_category(y));
+        assert(token_line(x) == token_line(y));
+        assert(token_col(x) == token_col(y));
+        assert(lx.len == ly.len && memcmp(lx.data, ly.data, (size_t)lx.len) == 0);
+    }
+    a = read_capture(log, &alen);
+    b = read_capture(replay, &blen);
+    assert(alen > 0 && alen == blen && memcmp(a, b, (size_t)alen) == 0);
+    assert(strstr(a, ERR_MSG_UNTERMINATED_LIT) != NULL);
+    free(a);
+    free(b);
+    tl_free(&loaded);
+
+    /* Changed content misses. */
+    other = key;
+    other.content ^= 1;
+    tl_init_arena(&loaded, &arena);
+    assert(tc_load(&tc, &other, &loaded, &arena, NULL, &result) != 0);
+    assert(tl_count(&loaded) == 0);
+
+    /* A truncated entry misses. */
+    assert(tc_entry_path(&tc, &key, path, sizeof(path)) == 0);
+    a = read_whole_file(path, &alen);
+    fp = fopen(path, "wb");
+    assert(fp != NULL);
+    fwrite(a, 1, (size_t)alen - 1, fp);
+    fclose(fp);
+    free(a);
+    assert(tc_load(&tc, &key, &loaded, &arena, NULL, &result) != 0);
+
+    /* A header claiming more bytes than the entry holds misses before
+       anything is allocated from it. */
+    a = read_whole_file(path, &alen);
+    assert(alen >= (long)sizeof(tc_header_t));
+    ((tc_header_t *)a)->count = UINT32_MAX;
+    fp = fopen(path, "wb");
+    assert(fp != NULL);
+    fwrite(a, 1, (size_t)alen, fp);
+    fclose(fp);
+    free(a);
+    used = arena_used(&arena);
+    assert(tc_load(&tc, &key, &loaded, &arena, NULL, &result) != 0);
+    assert(arena_used(&arena) == used);
+
+    remove(path);
+    remove(TEST_CACHE_DIR);
+    tl_free(&scanned);
+    cs_close(&cs);
+    arena_free(&arena);
+    fclose(log);
+    fclose(replay);
+    tc_close(&tc);
+
+    printf("  token cache tests PASSED\n");
+}
+
+/* ---- Test: incremental rescan ---- */
+
+/*
+ * inc_full_scan - scans the whole text into a fresh span list.
+ */
+static void inc_full_scan(const char *text, size_t len, token_list_t *out,
+                          scanner_ctx_t *ctx) {
+    char_stream_t cs;
+
+    tl_init(out);
+    tl_set_source(out, text, len);
+    assert(cs_open_view(&cs, text, len, 0, len, 1, 1) == 0);
+    automata_scan_engine(&cs, out, &ctx->lg, NULL, ctx->cfg.engine);
+    cs_close(&cs);
+}
+
+/*
+ * inc_assert_same - both lists hold the same tokens.
+ */
+static void inc_assert_same(const token_list_t *a, const token_list_t *b) {
+    int i;
+
+    assert(tl_count(a) == tl_count(b));
+    for (i = 0; i < tl_count(a); i++) {
+        const token_t *x = tl_get(a, i);
+        const token_t *y = tl_get(b, i);
+        lexeme_view_t lx = tl_lexeme(a, x);
+        lexeme_view_t ly = tl_lexeme(b, y);
+
+        assert(token_category(x) == token_category(y));
+        assert(token_line(x) == token_line(y));
+        assert(token_col(x) == token_col(y));
+        assert(lx.len == ly.len && memcmp(lx.data, ly.data, (size_t)lx.len) == 0);
+    }
+}
+
+/*
+ * inc_apply - replaces removed bytes at offset of *text by ins, rescans
+ * incrementally and checks the list against a full scan of the new text.
+ */
+static void inc_apply(char **text, size_t *len, token_list_t *tokens,
+                      scanner_ctx_t *ctx, size_t offset, size_t removed,
+                      const char *ins, inc_result_t *res) {
+    token_list_t full;
+    inc_edit_t edit;
+    size_t ins_len = strlen(ins);
+    size_t new_len = *len - removed + ins_len;
+    char *next = (char *)malloc(new_len + 1);
+
+    assert(next != NULL);
+    memcpy(next, *text, offset);
+    memcpy(next + offset, ins, ins_len);
+    memcpy(next + offset + ins_len, *text + offset + removed,
+           *len - offset - removed);
+    edit.offset = offset;
+    edit.removed = removed;
+    edit.inserted = ins_len;
+
+    /* The old text stays readable until the rescan returns. */
+    assert(inc_rescan(tokens, next, new_len, &edit, ctx, res) == 0);
+    free(*text);
+    *text = next;
+    *len = new_len;
+    assert(tl_source(tokens) == next);
+
+    inc_full_scan(next, new_len, &full, ctx);
+    inc_assert_same(tokens, &full);
+    tl_free(&full);
+}
+
+/*
+ * test_incremental - edits one line and checks only its tokens are
+ * replaced, then applies pseudo-random edits (newlines, literals,
+ * non-recognized bytes, deletions across lines) to a multi-block token list
+ * and checks every result against a full rescan of the edited text.
+ */
+static void test_incremental(void) {
+    static const char *snippets[] = {
+        "", "\n", "x", "if (a) b = 12;", "\"lit", "\"", "@#", " ", "\n\n",
+        "while\n{ }", "return 0;\n"
+    };
+    scanner_ctx_t ctx;
+    token_list_t tokens;
+    inc_edit_t edit;
+    inc_result_t res;
+    FILE *log;
+    char *text;
+    size_t len = 0;
+    size_t cap = (size_t)TEST_INC_LINES * 32;
+    unsigned seed = 12345;
+    int i;
+
+    printf("  Testing incremental rescan...\n");
+
+    text = (char *)malloc(cap);
+    assert(text != NULL);
+    for (i = 0; i < TEST_INC_LINES; i++) {
+        len += (size_t)snprintf(text + len, cap - len, "int v%d = %d; @\n", i, i);
+    }
+    log = tmpfile();
+    assert(log != NULL);
+    scanner_ctx_init(&ctx, NULL, log);
+    inc_full_scan(text, len, &tokens, &ctx);
+    assert(tl_count(&tokens) > TL_BLOCK_TOKENS * 3);
+
+    /* Bad edits leave the list untouched. */
+    edit.offset = len + 1;
+    edit.removed = 0;
+    edit.inserted = 0;
+    assert(inc_rescan(&tokens, text, len, &edit, &ctx, NULL) != 0);
+
+    /* "v5" -> "v55" on line 6: only that line's 6 tokens are rescanned. */
+    inc_apply(&text, &len, &tokens, &ctx,
+              (size_t)(strstr(text, "v5 ") - text) + 1, 1, "55", &res);
+    assert(res.first == 5 * 6 && res.removed == 6 && res.added == 6);
+    assert(res.first_line == 6 && res.line_delta == 0);
+
+    /* Splitting line 6 adds a line to every later token. */
+    inc_apply(&text, &len, &tokens, &ctx,
+              (size_t)(strstr(text, "v55") - text), 0, "\n", &res);
+    assert(res.line_delta == 1 && token_line(tl_get(&tokens, 36)) == 8);
+
+    for (i = 0; i < TEST_INC_EDITS; i++) {
+        const char *ins;
+        size_t offset;
+        size_t removed;
+
+        seed = seed * 1103515245u + 12345u;
+        ins = snippets[(seed >> 8) % (sizeof(snippets) / sizeof(snippets[0]))];
+        offset = (size_t)(seed >> 4) % (len + 1);
+        seed = seed * 1103515245u + 12345u;
+        removed = (size_t)(seed >> 8) % 40;
+        if (removed > len - offset) {
+            removed = len - offset;
+        }
+        inc_apply(&text, &len, &tokens, &ctx, offset, removed, ins, &res);
+    }
+
+    /* Deleting everything leaves no token. */
+    inc_apply(&text, &len, &tokens, &ctx, 0, len, "", &res);
+    assert(tl_count(&tokens) == 0);
+
+    tl_free(&tokens);
+    free(text);
+    fclose(log);
+
+    printf("  incremental rescan tests PASSED\n");
+}
+
+/* ---- Test: binary token file ---- */
+
+/*
+ * test_token_io - writes a multi-block token list (with blank lines) and a
+ * list of copied lexemes to .ctok, maps them back and compares tokens and
+ * line index; views must refuse edits and damaged files must not open.
+ */
+static void test_token_io(void) {
+    scanner_ctx_t ctx;
+    token_list_t tokens;
+    token_list_t copied;
+    tio_file_t f;
+    char name[32];
+    FILE *log;
+    FILE *fp;
+    char *text;
+    char *data;
+    long data_len;
+    size_t len = 0;
+    size_t cap = (size_t)TEST_INC_LINES * 32;
+    int count;
+    int first;
+    int line;
+    int i;
+
+    printf("  Testing binary token file...\n");
+
+    tio_build_filename("example.c", name, (int)sizeof(name));
+    assert(strcmp(name, "example.ctok") == 0);
+
+    text = (char *)malloc(cap);
+    assert(text != NULL);
+    for (i = 0; i < TEST_INC_LINES; i++) {
+        if (i % TEST_CTOK_BLANK == 0) {
+            text[len++] = '\n';
+        } else {
+            len += (size_t)snprintf(text + len, cap - len,
+                                    "int v%d = \"%d\"; @\n", i, i);
+        }
+    }
+    log = tmpfile();
+    assert(log != NULL);
+    scanner_ctx_init(&ctx, NULL, log);
+    inc_full_scan(text, len, &tokens, &ctx);
+    assert(tl_count(&tokens) > TL_BLOCK_TOKENS * 3);
+
+    /* Round trip: same tokens, served from the mapping. */
+    assert(tio_write(&tokens, TEST_CTOK_PATH) == 0);
+    assert(tio_open(&f, TEST_CTOK_PATH, TIO_OPEN_VERIFY) == 0);
+    inc_assert_same(&f.tokens, &tokens);
+    assert(f.lines == TEST_INC_LINES);
+
+    /* Line index: every token of line l, and none on blank lines. */
+    for (line = 1; line <= f.lines; line++) {
+        first = tio_line_tokens(&f, line, &count);
+        assert(count == ((line - 1) % TEST_CTOK_BLANK == 0 ? 0 : 6));
+        for (i = first; i < first + count; i++) {
+            assert(token_line(tl_get(&f.tokens, i)) == line);
+        }
+    }
+    first = tio_line_tokens(&f, f.lines + 1, &count);
+    assert(first == tl_count(&f.tokens) && count == 0);
+
+    /* The view is read-only. */
+    count = tl_count(&f.tokens);
+    tl_add_lexeme(&f.tokens, "x", 1, CAT_IDENTIFIER, 1, 1);
+    assert(tl_splice(&f.tokens, 0, 1, &tokens) != 0);
+    assert(tl_count(&f.tokens) == count);
+    tio_close(&f);
+
+    /* Copied lexemes are written as spans of the file's blob too. */
+    tl_init(&copied);
+    tl_add_lexeme(&copied, "while", 5, CAT_KEYWORD, 1, 1);
+    tl_add_lexeme(&copied, "42", 2, CAT_NUMBER, 3, 7);
+    assert(tio_write(&copied, TEST_CTOK_PATH) == 0);
+    assert(tio_open(&f, TEST_CTOK_PATH, TIO_OPEN_VERIFY) == 0);
+    inc_assert_same(&f.tokens, &copied);
+    first = tio_line_tokens(&f, 2, &count);
+    assert(first == 1 && count == 0);
+    tio_close(&f);
+    tl_free(&copied);
+
+    /* Damaged files do not open. */
+    data = read_whole_file(TEST_CTOK_PATH, &data_len);
+    fp = fopen(TEST_CTOK_PATH, "wb");
+    assert(fp != NULL);
+    fwrite(data, 1, (size_t)data_len - 1, fp);
+    fclose(fp);
+    assert(tio_open(&f, TEST_CTOK_PATH, TIO_OPEN_TRUSTED) != 0);
+    data[0] = 'X';
+    fp = fopen(TEST_CTOK_PATH, "wb");
+    assert(fp != NULL);
+    fwrite(data, 1, (size_t)data_len, fp);
+    fclose(fp);
+    assert(tio_open(&f, TEST_CTOK_PATH, TIO_OPEN_TRUSTED) != 0);
+    free(data);
+    remove(TEST_CTOK_PATH);
+    assert(tio_open(&f, TEST_CTOK_PATH, TIO_OPEN_TRUSTED) != 0);
+
+    tl_free(&tokens);
+    free(text);
+    fclose(log);
+
+    printf("  binary token file tests PASSED\n");
+}
+
+/* ---- Test: arena allocator ---- */
+
+/*
+ * test_arena - checks alignment, block chaining and reset reuse, then fills
+ * an arena-backed token list past several lexeme chunks and verifies that
+ * early lexeme views stay valid.
+ */
+static void test_arena(void) {
+    arena_t arena;
+    token_list_t list;
+    char *a;
+    char *b;
+    char *big;
+    const char *first;
+    char lex[16];
+    int i;
+
+    printf("  Testing arena allocator...\n");
+
+    arena_init(&arena, TEST_ARENA_BLOCK);
+    a = (char *)arena_alloc(&arena, 3);
+    b = (char *)arena_alloc(&arena, 5);
+    assert(a != NULL && b != NULL && a != b);
+    assert(((size_t)a % ARENA_ALIGN) == 0 && ((size_t)b % ARENA_ALIGN) == 0);
+    big = (char *)arena_alloc(&arena, TEST_ARENA_BLOCK * 4);
+    assert(big != NULL && ((size_t)big % ARENA_ALIGN) == 0);
+    memset(big, 'x', TEST_ARENA_BLOCK * 4);
+    assert(arena_used(&arena) >= TEST_ARENA_BLOCK * 4 + 8);
+
+    arena_reset(&arena);
+    assert(arena_used(&arena) == 0);
+    assert((char *)arena_alloc(&arena, 3) == a);
+
+    arena_reset(&arena);
+    tl_init_arena(&list, &arena);
+    for (i = 0; i < TEST_ARENA_LEXEMES; i++) {
+        int len = snprintf(lex, sizeof(lex), "id%d", i);
+        tl_add_lexeme(&list, lex, len, CAT_IDENTIFIER, i + 1, 1);
+    }
+    assert(tl_count(&list) == TEST_ARENA_LEXEMES);
+    assert(list.lex_nchunks > 1);
+    first = tl_lexeme(&list, tl_get(&list, 0)).data;
+    for (i = 0; i < TEST_ARENA_LEXEMES; i++) {
+        char expect[16];
+        int len = snprintf(expect, sizeof(expect), "id%d", i);
+        lexeme_view_t v = tl_lexeme(&list, tl_get(&list, i));
+        assert(v.len == len && memcmp(v.data, expect, (size_t)len) == 0);
+        assert(v.data[len] == '\0');
+    }
+    assert(strcmp(first, "id0") == 0);
+    assert(token_line(tl_get(&list, TEST_ARENA_LEXEMES - 1)) == TEST_ARENA_LEXEMES);
+    tl_free(&list);
+    arena_free(&arena);
+
+    printf("  arena allocator tests PASSED\n");
+}
+
+/* ---- Test: parallel scan ---- */
+
+#if CS_USE_MMAP
+
+/*
+ * check_chunked_scan - scans TEST_INPUT_FILE sequentially and with
+ * TEST_PAR_THREADS threads (newline split or speculative): same tokens
+ * (line and column included) and same messages in the same order.
+ */
+static void check_chunked_scan(int speculative, scan_engine_t engine) {
+    char_stream_t cs;
+    token_list_t seq_tokens;
+    token_list_t par_tokens;
+    logger_t seq_lg;
+    logger_t par_lg;
+    FILE *seq_log;
+    FILE *par_log;
+    const char *source;
+    size_t source_len;
+    char *seq_text;
+    char *par_text;
+    long seq_len;
+    long par_len;
+    int i;
+
+    seq_log = tmpfile();
+    par_log = tmpfile();
+    assert(seq_log != NULL && par_log != NULL);
+    logger_init_dest(&seq_lg, seq_log);
+    logger_init_dest(&par_lg, par_log);
+    tl_init(&seq_tokens);
+    tl_init(&par_tokens);
+
+    assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+    source = cs_data(&cs, &source_len);
+    tl_set_source(&seq_tokens, source, source_len);
+    tl_set_source(&par_tokens, source, source_len);
+    if (speculative) {
+        assert(automata_scan_speculative(&cs, &par_tokens, &par_lg, NULL,
+                                         engine, TEST_PAR_THREADS) == 0);
+    } else {
+        assert(automata_scan_parallel(&cs, &par_tokens, &par_lg, NULL,
+                                      engine, TEST_PAR_THREADS) == 0);
+    }
+    assert(automata_scan_engine(&cs, &seq_tokens, &seq_lg, NULL, engine) == 0);
+
+    assert(tl_count(&seq_tokens) > 0);
+    assert(tl_count(&seq_tokens) == tl_count(&par_tokens));
+    for (i = 0; i < tl_count(&seq_tokens); i++) {
+        const token_t *a = tl_get(&seq_tokens, i);
+        const token_t *b = tl_get(&par_tokens, i);
+        assert(memcmp(a, b, sizeof(token_t)) == 0);
+    }
+
+    seq_text = read_capture(seq_log, &seq_len);
+    par_text = read_capture(par_log, &par_len);
+    assert(seq_len > 0 && seq_len == par_len);
+    assert(memcmp(seq_text, par_text, (size_t)seq_len) == 0);
+
+    free(seq_text);
+    free(par_text);
+    fclose(seq_log);
+    fclose(par_log);
+    tl_free(&seq_tokens);
+    tl_free(&par_tokens);
+    cs_close(&cs);
+}
+
+/*
+ * test_parallel_scan - newline-split parallel scan of a multi-chunk input.
+ */
+static void test_parallel_scan(void) {
+    FILE *fp;
+    int i;
+
+    printf("  Testing parallel scan...\n");
+
+    fp = fopen(TEST_INPUT_FILE, "w");
+    assert(fp != NULL);
+    for (i = 0; i < TEST_PAR_LINES; i++) {
+        fprintf(fp, "while(x%d > 3) { y = \"s%d\" + 12; }\n", i, i);
+        if (i % 997 == 0) {
+            fprintf(fp, "  @@ \"open literal %d\n", i);
+        }
+    }
+    fprintf(fp, "return 0;");
+    fclose(fp);
+
+    check_chunked_scan(0, SCAN_ENGINE_MATRIX);
+
+    printf("  parallel scan tests PASSED\n");
+}
+
+/*
+ * test_speculative_scan - speculative chunked scan of input whose chunk
+ * cuts fall inside long literals, identifiers, numbers and error groups,
+ * on a line much longer than one chunk; checked for every engine.
+ */
+static void test_speculative_scan(void) {
+    FILE *fp;
+    long i;
+
+    printf("  Testing speculative chunked scan...\n");
+
+    fp = fopen(TEST_INPUT_FILE, "w");
+    assert(fp != NULL);
+    for (i = 0; i < TEST_PAR_LINES; i++) {
+        fprintf(fp, "if(v%ld) { x = \"t %ld\" * 7; } @%ld\n", i, i, i);
+    }
+    /* One long line: every construct crosses several chunk cuts. */
+    fputc('"', fp);
+    for (i = 0; i < TEST_SPEC_RUN; i++) {
+        fputc('l', fp);
+    }
+    fputs("\" ", fp);
+    for (i = 0; i < TEST_SPEC_RUN; i++) {
+        fputc('a' + (int)(i % 26), fp);
+    }
+    fputc(' ', fp);
+    for (i = 0; i < TEST_SPEC_RUN; i++) {
+        fputc('0' + (int)(i % 10), fp);
+    }
+    fputc(' ', fp);
+    for (i = 0; i < TEST_SPEC_RUN; i++) {
+        fputc('#', fp);
+    }
+    for (i = 0; i < TEST_PAR_LINES; i++) {
+        fprintf(fp, " while(q) + \"w\" else");
+    }
+    fputs("\n\"unterminated at end", fp);
+    fclose(fp);
+
+    check_chunked_scan(1, SCAN_ENGINE_MATRIX);
+    check_chunked_scan(1, SCAN_ENGINE_FUSED);
+    check_chunked_scan(1, SCAN_ENGINE_TRIE);
+
+    printf("  speculative chunked scan tests PASSED\n");
+}
+#endif
+
+#if CS_HAVE_POSIX_IO
+
+/* ---- Test: batch mode ---- */
+
+/*
+ * test_batch_job - records that job ran and reports its index.
+ */
+static char* test_batch_job(void *ctx, int worker, int job, size_t *len) {
+    int *runs = (int *)ctx;
+    char *text = (char *)malloc(16);
+
+    assert(worker >= 0 && worker < TEST_BATCH_THREADS);
+    assert(text != NULL);
+    runs[job]++;
+    *len = (size_t)snprintf(text, 16, "job %d\n", job);
+    return text;
+}
+
+/*
+ * test_batch - expands a directory tree and a file list in order, then runs
+ * more jobs than workers and checks each ran once with reports in job order.
+ */
+static void test_batch(void) {
+    batch_inputs_t in;
+    FILE *fp;
+    FILE *out;
+    char *text;
+    char expect[16];
+    long len;
+    long pos = 0;
+    int runs[TEST_BATCH_JOBS];
+    int i;
+
+    printf("  Testing batch mode...\n");
+
+    mkdir(TEST_BATCH_DIR, 0700);
+    mkdir(TEST_BATCH_DIR "/sub", 0700);
+    fp = fopen(TEST_BATCH_DIR "/b.c", "w");
+    assert(fp != NULL);
+    fclose(fp);
+    fp = fopen(TEST_BATCH_DIR "/a.c", "w");
+    assert(fp != NULL);
+    fclose(fp);
+    fp = fopen(TEST_BATCH_DIR "/notes.txt", "w");
+    assert(fp != NULL);
+    fclose(fp);
+    fp = fopen(TEST_BATCH_DIR "/sub/c.c", "w");
+    assert(fp != NULL);
+    fclose(fp);
+    fp = fopen(TEST_BATCH_DIR "/list", "w");
+    assert(fp != NULL);
+    fputs("# inputs\n" TEST_BATCH_DIR "/sub\n\nmissing.c \n", fp);
+    fclose(fp);
+
+    batch_inputs_init(&in);
+    assert(batch_is_collection(TEST_BATCH_DIR));
+    assert(batch_is_collection("@" TEST_BATCH_DIR "/list"));
+    assert(!batch_is_collection(TEST_BATCH_DIR "/a.c"));
+    assert(batch_collect(&in, TEST_BATCH_DIR) == 0);
+    assert(batch_collect(&in, "@" TEST_BATCH_DIR "/list") == 0);
+    assert(batch_collect(&in, "@" TEST_BATCH_DIR "/nolist") != 0);
+    assert(in.count == 5);
+    assert(strcmp(in.paths[0], TEST_BATCH_DIR "/a.c") == 0);
+    assert(strcmp(in.paths[1], TEST_BATCH_DIR "/b.c") == 0);
+    assert(strcmp(in.paths[2], TEST_BATCH_DIR "/sub/c.c") == 0);
+    assert(strcmp(in.paths[3], TEST_BATCH_DIR "/sub/c.c") == 0);
+    assert(strcmp(in.paths[4], "missing.c") == 0);
+    batch_inputs_free(&in);
+    assert(in.count == 0);
+
+    assert(batch_thread_count(TEST_BATCH_THREADS, 2) == 2);
+    assert(batch_thread_count(TEST_BATCH_THREADS, TEST_BATCH_JOBS) ==
+           TEST_BATCH_THREADS);
+
+    memset(runs, 0, sizeof(runs));
+    out = tmpfile();
+    assert(out != NULL);
+    assert(batch_run(TEST_BATCH_JOBS, TEST_BATCH_THREADS, test_batch_job,
+                     runs, out) == 0);
+    text = read_capture(out, &len);
+    for (i = 0; i < TEST_BATCH_JOBS; i++) {
+        int n = snprintf(expect, sizeof(expect), "job %d\n", i);
+
+        assert(runs[i] == 1);
+        assert(pos + n <= len && memcmp(text + pos, expect, (size_t)n) == 0);
+        pos += n;
+    }
+    assert(pos == len);
+    free(text);
+    fclose(out);
+
+    remove(TEST_BATCH_DIR "/sub/c.c");
+    remove(TEST_BATCH_DIR "/sub");
+    remove(TEST_BATCH_DIR "/a.c");
+    remove(TEST_BATCH_DIR "/b.c");
+    remove(TEST_BATCH_DIR "/notes.txt");
+    remove(TEST_BATCH_DIR "/list");
+    remove(TEST_BATCH_DIR);
+
+    printf("  batch mode tests PASSED\n");
+}
+
+#if DAEMON_SUPPORTED
+
+/* ---- Test: daemon mode ---- */
+
+/* Server thread argument and result. */
+typedef struct {
+    scanner_config_t cfg;
+    int result;
+} test_daemon_t;
+
+/*
+ * test_daemon_main - runs the server until SHUTDOWN.
+ */
+static void* test_daemon_main(void *arg) {
+    test_daemon_t *d = (test_daemon_t *)arg;
+
+    d->result = daemon_serve(TEST_DAEMON_SOCKET, &d->cfg);
+    return NULL;
+}
+
+/*
+ * daemon_request - sends request (plus payload) and reads one reply:
+ * returns the token count, or -1 for ERR; *msg and *out are malloc'd.
+ */
+static int daemon_request(int fd, FILE *in, const char *request,
+                          const char *payload, size_t payload_len,
+                          char **msg, unsigned long *msg_len, char **out,
+                          unsigned long *out_len) {
+    char line[256];
+    int tokens;
+
+    assert(write(fd, request, strlen(request)) == (ssize_t)strlen(request));
+    if (payload_len > 0) {
+        assert(write(fd, payload, payload_len) == (ssize_t)payload_len);
+    }
+    assert(fgets(line, sizeof(line), in) != NULL);
+    if (strncmp(line, "ERR ", 4) == 0) {
+        return -1;
+    }
+    assert(sscanf(line, "OK %d %lu %lu", &tokens, msg_len, out_len) == 3);
+    *msg = (char *)malloc(*msg_len + 1);
+    *out = (char *)malloc(*out_len + 1);
+    assert(*msg != NULL && *out != NULL);
+    assert(fread(*msg, 1, *msg_len, in) == *msg_len);
+    assert(fread(*out, 1, *out_len, in) == *out_len);
+    (*msg)[*msg_len] = '\0';
+    (*out)[*out_len] = '\0';
+    return tokens;
+}
+
+/*
+ * make_long_path - creates TEST_LONG_DEPTH nested directories under
+ * TEST_LONG_DIR and returns "<dirs>/in.c" in path (TEST_LONG_BUF bytes).
+ */
+static void make_long_path(char *path) {
+    size_t len;
+    int i;
+
+    strcpy(path, TEST_LONG_DIR);
+    mkdir(path, 0777);
+    for (i = 0; i < TEST_LONG_DEPTH; i++) {
+        len = strlen(path);
+        path[len] = '/';
+        memset(path + len + 1, 'a' + i, TEST_LONG_NAME);
+        path[len + 1 + TEST_LONG_NAME] = '\0';
+        assert(mkdir(path, 0777) == 0 || errno == EEXIST);
+    }
+    strcat(path, "/in.c");
+}
+
+/*
+ * remove_long_path - removes the file, its .cscn and the directories of
+ * make_long_path.
+ */
+static void remove_long_path(char *path) {
+    char *slash;
+
+    strcat(path, SCN_SUFFIX);
+    remove(path);
+    path[strlen(path) - strlen(SCN_SUFFIX)] = '\0';
+    remove(path);
+    while ((slash = strrchr(path, '/')) != NULL &&
+           strcmp(path, TEST_LONG_DIR) != 0) {
+        *slash = '\0';
+        remove(path);
+    }
+}
+
+/*
+ * test_daemon - serves TOKENS, INLINE and SCAN requests over the socket and
+ * checks the token streams and files against the direct writer; an idle
+ * connection or a partial request does not hold back other clients, and
+ * the socket path only replaces a stale socket.
+ */
+static void test_daemon(void) {
+    test_daemon_t d;
+    pthread_t server;
+    struct sockaddr_un addr;
+    struct stat st;
+    char_stream_t cs;
+    token_list_t tokens;
+    logger_t lg;
+    struct timeval timeout;
+    FILE *fp;
+    FILE *in;
+    FILE *in2;
+    char *expect;
+    char *written;
+    char *source;
+    char *msg;
+    char *out;
+    char request[128];
+    char long_path[TEST_LONG_BUF];
+    char long_request[TEST_LONG_BUF + 16];
+    long expect_len;
+    long written_len;
+    long source_len;
+    unsigned long msg_len;
+    unsigned long out_len;
+    int fd;
+    int fd2;
+    int i;
+
+    printf("  Testing daemon mode...\n");
+
+    write_test_file();
+    logger_init(&lg, stdout);
+    tl_init(&tokens);
+    assert(cs_open(&cs, TEST_INPUT_FILE) == 0);
+    automata_scan(&cs, &tokens, &lg, NULL);
+    cs_close(&cs);
+    assert(ow_write_token_file(&tokens, TEST_OUTPUT_FILE) == 0);
+    tl_free(&tokens);
+    expect = read_whole_file(TEST_OUTPUT_FILE, &expect_len);
+    source = read_whole_file(TEST_INPUT_FILE, &source_len);
+    remove(TEST_OUTPUT_FILE);
+
+    scanner_config_default(&d.cfg);
+    d.cfg.debug = DEBUG_OFF;
+    d.result = -1;
+
+    /* A regular file at the socket path is never replaced. */
+    remove(TEST_DAEMON_SOCKET);
+    fp = fopen(TEST_DAEMON_SOCKET, "w");
+    assert(fp != NULL);
+    fclose(fp);
+    assert(daemon_serve(TEST_DAEMON_SOCKET, &d.cfg) == -1);
+    assert(stat(TEST_DAEMON_SOCKET, &st) == 0 && S_ISREG(st.st_mode));
+    remove(TEST_DAEMON_SOCKET);
+
+    /* Paths that do not fit sun_path are rejected, not truncated. */
+    memset(request, 'x', sizeof(request) - 1);
+    request[0] = '/';
+    request[sizeof(request) - 1] = '\0';
+    assert(daemon_serve(request, &d.cfg) == -1);
+
+    /* The socket of a server that is gone is replaced. */
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, TEST_DAEMON_SOCKET, sizeof(addr.sun_path) - 1);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    assert(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    close(fd);
+
+    assert(pthread_create(&server, NULL, test_daemon_main, &d) == 0);
+    fd = -1;
+    for (i = 0; i < TEST_DAEMON_ATTEMPTS && fd < 0; i++) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        assert(fd >= 0);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            fd = -1;
+            usleep(10000);
+        }
+    }
+    assert(fd >= 0);
+    in = fdopen(dup(fd), "r");
+    assert(in != NULL);
+
+    /* A running server's socket is not taken over. */
+    assert(daemon_serve(TEST_DAEMON_SOCKET, &d.cfg) == -1);
+
+    /* TOKENS: same stream as the .cscn writer, no messages. */
+    snprintf(request, sizeof(request), "TOKENS %s\n", TEST_INPUT_FILE);
+    assert(daemon_request(fd, in, request, NULL, 0, &msg, &msg_len, &out,
+                          &out_len) == TEST_BASIC_EXPECTED_TOKENS);
+    assert(msg_len == 0);
+    assert(out_len == (unsigned long)expect_len);
+    assert(memcmp(out, expect, (size_t)expect_len) == 0);
+    free(msg);
+    free(out);
+
+    /*
+     * A second client is served while the first keeps its connection open
+     * or has sent only part of a request (a receive timeout turns a stall
+     * into a failure).
+     */
+    assert(write(fd, "INLINE 3\n@", 10) == 10);
+    fd2 = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd2 >= 0);
+    assert(connect(fd2, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    timeout.tv_sec = TEST_DAEMON_TIMEOUT;
+    timeout.tv_usec = 0;
+    assert(setsockopt(fd2, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                      sizeof(timeout)) == 0);
+    in2 = fdopen(dup(fd2), "r");
+    assert(in2 != NULL);
+    assert(daemon_request(fd2, in2, "INLINE 3\n", "@@@", 3, &msg, &msg_len,
+                          &out, &out_len) == 1);
+    free(msg);
+    free(out);
+    assert(daemon_request(fd, in, "@@", NULL, 0, &msg, &msg_len, &out,
+                          &out_len) == 1);
+    free(msg);
+    free(out);
+    snprintf(request, sizeof(request), "TOKENS %s", TEST_INPUT_FILE);
+    assert(write(fd, request, strlen(request)) == (ssize_t)strlen(request));
+    /* Two requests in one write are both answered. */
+    snprintf(request, sizeof(request), "INLINE 1\nxINLINE %ld\n",
+             source_len);
+    assert(daemon_request(fd2, in2, request, source, (size_t)source_len,
+                          &msg, &msg_len, &out, &out_len) == 1);
+    free(msg);
+    free(out);
+    assert(fgets(request, sizeof(request), in2) != NULL);
+    assert(sscanf(request, "OK %d %lu %lu", &i, &msg_len, &out_len) == 3);
+    assert(i == TEST_BASIC_EXPECTED_TOKENS);
+    fclose(in2);
+    close(fd2);
+    assert(daemon_request(fd, in, "\n", NULL, 0, &msg, &msg_len, &out,
+                          &out_len) == TEST_BASIC_EXPECTED_TOKENS);
+    assert(out_len == (unsigned long)expect_len);
+    free(msg);
+    free(out);
+
+    /* INLINE: the same bytes sent over the socket. */
+    snprintf(request, sizeof(request), "INLINE %ld\n", source_len);
+    assert(daemon_request(fd, in, request, source, (size_t)source_len, &msg,
+                          &msg_len, &out, &out_len) ==
+           TEST_BASIC_EXPECTED_TOKENS);
+    assert(out_len == (unsigned long)expect_len);
+    assert(memcmp(out, expect, (size_t)expect_len) == 0);
+    free(msg);
+    free(out);
+
+    /* Scanner messages come back in their own section. */
+    assert(daemon_request(fd, in, "INLINE 3\n", "@@@", 3, &msg, &msg_len,
+                          &out, &out_len) == 1);
+    assert(strstr(msg, ERR_MSG_NONRECOGNIZED) != NULL);
+    free(msg);
+    free(out);
+
+    /* SCAN: writes the .cscn file; errors are reported, not fatal. */
+    assert(daemon_request(fd, in, "SCAN /nonexistent/in.c\n", NULL, 0, &msg,
+                          &msg_len, &out, &out_len) == -1);
+    /* A failed read is an error, not a short token stream or file. */
+    mkdir(TEST_DAEMON_READ_DIR, 0777);
+    assert(daemon_request(fd, in, "TOKENS " TEST_DAEMON_READ_DIR "\n", NULL,
+                          0, &msg, &msg_len, &out, &out_len) == -1);
+    assert(daemon_request(fd, in, "SCAN " TEST_DAEMON_READ_DIR "\n", NULL,
+                          0, &msg, &msg_len, &out, &out_len) == -1);
+    assert(access(TEST_DAEMON_READ_DIR SCN_SUFFIX, F_OK) != 0);
+    remove(TEST_DAEMON_READ_DIR);
+    snprintf(request, sizeof(request), "SCAN %s\n", TEST_INPUT_FILE);
+    assert(daemon_request(fd, in, request, NULL, 0, &msg, &msg_len, &out,
+                          &out_len) == TEST_BASIC_EXPECTED_TOKENS);
+    assert(strstr(out, TEST_OUTPUT_FILE) != NULL);
+    free(msg);
+    free(out);
+    written = read_whole_file(TEST_OUTPUT_FILE, &written_len);
+    assert(written_len == expect_len);
+    assert(memcmp(written, expect, (size_t)expect_len) == 0);
+    free(written);
+
+    /*
+     * SCAN of a path longer than the driver's name buffer writes
+     * <path>scn in full; the input itself is left untouched.
+     */
+    make_long_path(long_path);
+    fp = fopen(long_path, "wb");
+    assert(fp != NULL);
+    fwrite(source, 1, (size_t)source_len, fp);
+    fclose(fp);
+    snprintf(long_request, sizeof(long_request), "SCAN %s\n", long_path);
+    assert(daemon_request(fd, in, long_request, NULL, 0, &msg, &msg_len,
+                          &out, &out_len) == TEST_BASIC_EXPECTED_TOKENS);
+    free(msg);
+    free(out);
+    written = read_whole_file(long_path, &written_len);
+    assert(written_len == source_len);
+    assert(memcmp(written, source, (size_t)source_len) == 0);
+    free(written);
+    strcat(long_path, SCN_SUFFIX);
+    written = read_whole_file(long_path, &written_len);
+    assert(written_len == expect_len);
+    assert(memcmp(written, expect, (size_t)expect_len) == 0);
+    free(written);
+    long_path[strlen(long_path) - strlen(SCN_SUFFIX)] = '\0';
+    remove_long_path(long_path);
+
+    assert(daemon_request(fd, in, "SHUTDOWN\n", NULL, 0, &msg, &msg_len,
+                          &out, &out_len) == 0);
+    free(msg);
+    free(out);
+    fclose(in);
+    close(fd);
+    pthread_join(server, NULL);
+    assert(d.result == 0);
+    assert(access(TEST_DAEMON_SOCKET, F_OK) != 0);
+
+    free(expect);
+    free(source);
+    printf("  daemon mode tests PASSED\n");
+}
+#endif
+#endif
+
 /* ---- Main ---- */
 
 int main(void) {
     printf("Running scanner tests...\n");
 
     test_lang_spec();
+    test_keyword_hash();
     test_token_list();
+    test_token_list_blocks();
     test_scanner_scan();
     test_output_filename();
     test_output_writer();
@@ -537,6 +2801,34 @@ int main(void) {
     test_output_filenames_extended();
     test_countio();
     test_null_counter_pointer();
+    test_char_stream_mmap();
+    test_classify_table();
+    test_fused_engine();
+    test_trie_engine();
+    test_span_lexemes();
+    test_arena();
+    test_pull_scanner();
+    test_pipeline();
+    test_output_buffer();
+    test_output_parallel();
+    test_stream_output();
+    test_output_session();
+    test_output_unchanged();
+    test_scanner_ctx();
+    test_token_cache();
+    test_incremental();
+    test_token_io();
+#if CS_USE_MMAP
+    test_parallel_scan();
+    test_speculative_scan();
+#endif
+#if CS_HAVE_POSIX_IO
+    test_char_stream_buffered();
+    test_batch();
+#if DAEMON_SUPPORTED
+    test_daemon();
+#endif
+#endif
 
     printf("All scanner tests PASSED!\n");
     return 0;
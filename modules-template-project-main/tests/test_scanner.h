@@ -13,19 +13,39 @@
 #define TEST_SCANNER_H
 
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../src/lang_spec/lang_spec.h"
+#include "../src/arena/arena.h"
 #include "../src/char_stream/char_stream.h"
 #include "../src/token/token.h"
 #include "../src/token_list/token_list.h"
 #include "../src/automata/automata.h"
 #include "../src/out_writer/out_writer.h"
+#include "../src/pipeline/pipeline.h"
+#include "../src/batch/batch.h"
+#include "../src/token_cache/token_cache.h"
+#include "../src/incremental/incremental.h"
+#include "../src/token_io/token_io.h"
+#include "../src/daemon/daemon.h"
 #include "../src/error_mod/error_mod.h"
 #include "../src/logger/logger.h"
 #include "../src/counter/counter.h"
 
+#if CS_HAVE_POSIX_IO
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
 /* Test input file path */
 #define TEST_INPUT_FILE "/tmp/scanner_test_input.c"
 
@@ -35,6 +55,93 @@
 /* Number of expected tokens for the basic test input */
 #define TEST_BASIC_EXPECTED_TOKENS 17
 
+/* Bytes streamed through a pipe (> CS_BUF_SIZE to force refills) */
+#define TEST_PIPE_BYTES 600000L
+
+/* Buffered reader input whose read() fails (a directory) */
+#define TEST_READ_ERROR_DIR "/tmp"
+
+/* Tokens appended to span several token blocks */
+#define TEST_BLOCK_TOKENS (TL_BLOCK_TOKENS * 3 + 7)
+
+/* Arena block size and lexemes appended (enough for several blocks/chunks) */
+#define TEST_ARENA_BLOCK 1024
+#define TEST_ARENA_LEXEMES 20000
+
+/* Parallel scan: threads and input lines (> SCAN_PAR_MIN_CHUNK per thread) */
+#define TEST_PAR_THREADS 4
+#define TEST_PAR_LINES   40000
+
+/* Speculative scan: length of each construct forced across chunk cuts */
+#define TEST_SPEC_RUN 300000L
+
+/* Pipeline: output file and input lines (many times SPSC_RING_SIZE tokens) */
+#define TEST_PIPE_OUTPUT_FILE "/tmp/scanner_test_pipe.cscn"
+#define TEST_PIPE_LINES 5000
+
+/* Batch: scratch directory, pool threads and job count (many steals) */
+#define TEST_BATCH_DIR     "/tmp/scanner_test_batch"
+#define TEST_BATCH_THREADS 4
+#define TEST_BATCH_JOBS    1000
+
+/* Reentrant contexts: per-config output files, concurrent runs */
+#define TEST_CTX_OUTPUT_FMT "/tmp/scanner_test_ctx%d_%s.cscn"
+#define TEST_CTX_RUNS 2
+
+/* Buffered formatter: token lines written (output spans many buffers) */
+#define TEST_FMT_LINES 20000
+
+/* Parallel writer: threads, token lines, output files */
+#define TEST_PAR_OUT_THREADS 4
+#define TEST_PAR_OUT_LINES   40000
+#define TEST_PAR_OUT_SEQ     "/tmp/scanner_test_par_seq.cscn"
+#define TEST_PAR_OUT_PAR     "/tmp/scanner_test_par_par.cscn"
+
+/* Streaming output: input lines, tokens of the one long line, output */
+#define TEST_STREAM_LINES      5000
+#define TEST_STREAM_LONG_LINE  (TL_BLOCK_TOKENS * 3)
+#define TEST_STREAM_OUTPUT     "/tmp/scanner_test_stream.cscn"
+
+/* Output session: messages written before the tokens, output file */
+#define TEST_SESSION_MESSAGES 3000
+#define TEST_SESSION_OUTPUT   "/tmp/scanner_test_session.cscn"
+
+/*
+ * Write-if-changed: output file, its directory and the name prefix of its
+ * temporary files, and concurrent writers with their writes each
+ */
+#define TEST_KEEP_OUTPUT     "/tmp/scanner_test_keep.cscn"
+#define TEST_KEEP_DIR        "/tmp"
+#define TEST_KEEP_TMP_PREFIX "scanner_test_keep.cscn."
+#define TEST_KEEP_WRITERS    2
+#define TEST_KEEP_ROUNDS     6
+
+/* Token cache: scratch cache directory */
+#define TEST_CACHE_DIR "/tmp/scanner_test_cache"
+
+/* Incremental rescan: input lines and random edits checked */
+#define TEST_INC_LINES 3000
+#define TEST_INC_EDITS 200
+
+/* Binary token file: scratch .ctok path, blank line period of the input */
+#define TEST_CTOK_PATH  "/tmp/scanner_test.ctok"
+#define TEST_CTOK_BLANK 100
+
+/* Daemon: socket path, connect attempts (10 ms apart), reply timeout (s) */
+#define TEST_DAEMON_SOCKET   "/tmp/scanner_test_daemon.sock"
+#define TEST_DAEMON_ATTEMPTS 500
+#define TEST_DAEMON_TIMEOUT  5
+
+/* Daemon: a directory, which opens but cannot be read as a file */
+#define TEST_DAEMON_READ_DIR "/tmp/scanner_test_daemon_dir"
+
+/* Long input path: base directory, nested directories of the given name
+   length (the path exceeds 512 bytes), path buffer size */
+#define TEST_LONG_DIR   "/tmp/scanner_test_long"
+#define TEST_LONG_DEPTH 3
+#define TEST_LONG_NAME  200
+#define TEST_LONG_BUF   1024
+
 /* Test keyword count */
 #define TEST_NUM_KEYWORDS 7
 